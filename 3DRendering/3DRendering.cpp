@@ -14,13 +14,30 @@
 #include "glm/gtc/matrix_transform.hpp"
 #include "glm/gtx/rotate_vector.hpp"
 #include "imgui_internal.h"
+#include <algorithm>
 #include <cmath>
+#include <cstring>
 #include "stb_image.h"
 
 #include "Asset.h"
 #include "Input.h"
 #include "glm/gtx/quaternion.hpp"
 
+#include "CascadedShadows.h"
+#include "DeferredResize.h"
+#include "DynamicResolution.h"
+#include "FixedTimestep.h"
+#include "FrameGraph.h"
+#include "HotReload.h"
+#include "IndirectDraws.h"
+#include "ClusteredLighting.h"
+#include "JobSystem.h"
+#include "LightmapBaker.h"
+#include "MemoryTracking.h"
+#include "RenderCapture.h"
+#include "SimdMath.h"
+#include "TextureStreaming.h"
+
 using namespace std;
 
 constexpr double PI = 3.14159265;
@@ -54,6 +71,171 @@ SwapChain CreateSwap(Window* Wnd, Surface Surf)
     return GRenderAPI->CreateSwapChain(Surf, Width, Height);
 }
 
+// Render API handles are opaque, captures tell them apart by their bits
+template<typename HandleType>
+uint64_t GetCaptureKey(const HandleType& Handle)
+{
+    static_assert(std::is_trivially_copyable_v<HandleType> && sizeof(HandleType) <= sizeof(uint64_t));
+    uint64_t Key = 0;
+    std::memcpy(&Key, &Handle, sizeof(HandleType));
+    return Key;
+}
+
+template<typename HandleType>
+HandleType FromCaptureKey(uint64_t Key)
+{
+    HandleType Handle{};
+    std::memcpy(&Handle, &Key, sizeof(HandleType));
+    return Handle;
+}
+
+// Replays find this session's counterparts of captured objects by these names
+template<typename HandleType>
+void NameCaptureObject(CaptureObjectKind Kind, const HandleType& Handle, std::string Label)
+{
+    gCapture.NameObject(Kind, GetCaptureKey(Handle), std::move(Label));
+}
+
+// Creation calls hand back a null handle when they fail, shader compile errors included
+template<typename HandleType>
+bool IsValidHandle(const HandleType& Handle)
+{
+    HandleType Null{};
+    return std::memcmp(&Handle, &Null, sizeof(HandleType)) != 0;
+}
+
+template<typename ValueType>
+std::span<const uint8_t> GetCaptureBytes(const ValueType& Value)
+{
+    static_assert(std::is_trivially_copyable_v<ValueType>);
+    return { reinterpret_cast<const uint8_t*>(&Value), sizeof(ValueType) };
+}
+
+// The calls a frame makes into the render API. They're forwarded as is, and recorded into gCapture while a capture
+// is running.
+struct CapturedRenderAPI
+{
+    void BeginFrame(SwapChain Swap, Surface Surf, uint32_t Width, uint32_t Height)
+    {
+        if (gCapture.IsActive())
+            gCapture.Record(CaptureCall::BeginFrame, { GetCaptureKey(Swap) }, { Width, Height });
+        GRenderAPI->BeginFrame(Swap, Surf, Width, Height);
+    }
+
+    void EndFrame(SwapChain Swap, Surface Surf, uint32_t Width, uint32_t Height)
+    {
+        if (gCapture.IsActive())
+            gCapture.Record(CaptureCall::EndFrame, { GetCaptureKey(Swap) }, { Width, Height });
+        GRenderAPI->EndFrame(Swap, Surf, Width, Height);
+    }
+
+    void Reset(CommandBuffer Cmd)
+    {
+        if (gCapture.IsActive())
+            gCapture.Record(CaptureCall::ResetCommandBuffer, { GetCaptureKey(Cmd) });
+        GRenderAPI->Reset(Cmd);
+    }
+
+    void Begin(CommandBuffer Cmd)
+    {
+        if (gCapture.IsActive())
+            gCapture.Record(CaptureCall::BeginCommandBuffer, { GetCaptureKey(Cmd) });
+        GRenderAPI->Begin(Cmd);
+    }
+
+    void End(CommandBuffer Cmd)
+    {
+        if (gCapture.IsActive())
+            gCapture.Record(CaptureCall::EndCommandBuffer, { GetCaptureKey(Cmd) });
+        GRenderAPI->End(Cmd);
+    }
+
+    void SubmitSwapCommandBuffer(SwapChain Swap, CommandBuffer Cmd)
+    {
+        if (gCapture.IsActive())
+            gCapture.Record(CaptureCall::SubmitCommandBuffer, { GetCaptureKey(Swap), GetCaptureKey(Cmd) });
+        GRenderAPI->SubmitSwapCommandBuffer(Swap, Cmd);
+    }
+
+    void BeginRenderGraph(CommandBuffer Cmd, RenderGraph Graph, FrameBuffer Target, RenderGraphInfo Info)
+    {
+        if (gCapture.IsActive())
+            gCapture.Record(CaptureCall::BeginRenderGraph, { GetCaptureKey(Cmd), GetCaptureKey(Graph), GetCaptureKey(Target) }, {}, GetCaptureBytes(Info));
+        GRenderAPI->BeginRenderGraph(Cmd, Graph, Target, Info);
+    }
+
+    void BeginRenderGraph(CommandBuffer Cmd, SwapChain Swap, RenderGraphInfo Info)
+    {
+        if (gCapture.IsActive())
+            gCapture.Record(CaptureCall::BeginSwapChainRenderGraph, { GetCaptureKey(Cmd), GetCaptureKey(Swap) }, {}, GetCaptureBytes(Info));
+        GRenderAPI->BeginRenderGraph(Cmd, Swap, Info);
+    }
+
+    void EndRenderGraph(CommandBuffer Cmd)
+    {
+        if (gCapture.IsActive())
+            gCapture.Record(CaptureCall::EndRenderGraph, { GetCaptureKey(Cmd) });
+        GRenderAPI->EndRenderGraph(Cmd);
+    }
+
+    void BindPipeline(CommandBuffer Cmd, Pipeline Pipe)
+    {
+        if (gCapture.IsActive())
+            gCapture.Record(CaptureCall::BindPipeline, { GetCaptureKey(Cmd), GetCaptureKey(Pipe) });
+        GRenderAPI->BindPipeline(Cmd, Pipe);
+    }
+
+    void BindResources(CommandBuffer Cmd, ResourceSet Resources)
+    {
+        if (gCapture.IsActive())
+            gCapture.Record(CaptureCall::BindResources, { GetCaptureKey(Cmd), GetCaptureKey(Resources) });
+        GRenderAPI->BindResources(Cmd, Resources);
+    }
+
+    void SetViewport(CommandBuffer Cmd, uint32_t X, uint32_t Y, uint32_t Width, uint32_t Height)
+    {
+        if (gCapture.IsActive())
+            gCapture.Record(CaptureCall::SetViewport, { GetCaptureKey(Cmd) }, { X, Y, Width, Height });
+        GRenderAPI->SetViewport(Cmd, X, Y, Width, Height);
+    }
+
+    void SetScissor(CommandBuffer Cmd, uint32_t X, uint32_t Y, uint32_t Width, uint32_t Height)
+    {
+        if (gCapture.IsActive())
+            gCapture.Record(CaptureCall::SetScissor, { GetCaptureKey(Cmd) }, { X, Y, Width, Height });
+        GRenderAPI->SetScissor(Cmd, X, Y, Width, Height);
+    }
+
+    void UpdateUniformBuffer(ResourceSet Resources, SwapChain Swap, uint32_t Binding, void* Data, size_t Size)
+    {
+        if (gCapture.IsActive())
+            gCapture.Record(CaptureCall::UpdateUniformBuffer, { GetCaptureKey(Resources), GetCaptureKey(Swap) }, { Binding }, { static_cast<const uint8_t*>(Data), Size });
+        GRenderAPI->UpdateUniformBuffer(Resources, Swap, Binding, Data, Size);
+    }
+
+    void UpdateAttachmentResource(ResourceSet Resources, SwapChain Swap, FrameBuffer Source, uint32_t Attachment, uint32_t Binding)
+    {
+        if (gCapture.IsActive())
+            gCapture.Record(CaptureCall::UpdateAttachmentResource, { GetCaptureKey(Resources), GetCaptureKey(Swap), GetCaptureKey(Source) }, { Attachment, Binding });
+        GRenderAPI->UpdateAttachmentResource(Resources, Swap, Source, Attachment, Binding);
+    }
+
+    void TransitionFrameBufferColorAttachment(CommandBuffer Cmd, FrameBuffer Target, uint32_t Attachment, AttachmentUsage Before, AttachmentUsage After)
+    {
+        if (gCapture.IsActive())
+            gCapture.Record(CaptureCall::TransitionAttachment, { GetCaptureKey(Cmd), GetCaptureKey(Target) }, { Attachment, static_cast<uint32_t>(Before), static_cast<uint32_t>(After) });
+        GRenderAPI->TransitionFrameBufferColorAttachment(Cmd, Target, Attachment, Before, After);
+    }
+
+    void DrawVertexBufferIndexed(CommandBuffer Cmd, VertexBuffer Buffer, uint32_t IndexCount)
+    {
+        if (gCapture.IsActive())
+            gCapture.Record(CaptureCall::DrawVertexBufferIndexed, { GetCaptureKey(Cmd), GetCaptureKey(Buffer) }, { IndexCount });
+        GRenderAPI->DrawVertexBufferIndexed(Cmd, Buffer, IndexCount);
+    }
+
+} gCapturedAPI;
+
 struct FinalPassVertex
 {
     glm::vec2 mPosition;
@@ -75,12 +257,21 @@ struct SceneFragmentUniforms
 {
     alignas(16) glm::vec3 mEye;
     alignas(16) DirectionalLight mDir;
+    alignas(16) ClusterShadingParams mClusters;
+    alignas(16) glm::mat4 mCascadeViewProjection[SHADOW_CASCADE_COUNT];
+    alignas(16) glm::vec4 mCascadeSplits;
 };
 
+static_assert(SHADOW_CASCADE_COUNT == 4, "Cascade splits are packed into a vec4");
+
 struct MeshVertex
 {
     glm::vec3 mPosition;
     glm::vec3 mNormal;
+
+    // Bounced light and sky from the scene's lightmap in rgb and ambient occlusion in a, resolved to the vertex when the
+    // scene is imported
+    glm::vec4 mBakedLight{0.0f, 0.0f, 0.0f, 1.0f};
 };
 
 struct Material
@@ -88,7 +279,7 @@ struct Material
     bool bUsesAlbedoTexture = false;
 
     glm::vec3 AlbedoColor;
-	Texture AlbedoTexture;
+	StreamedTextureId AlbedoTexture = INVALID_STREAMED_TEXTURE;
 };
 
 struct Mesh
@@ -96,12 +287,20 @@ struct Mesh
     VertexBuffer mBuffer;
     uint32_t mVertexCount;
     uint32_t mIndexCount;
+    uint32_t mMaterialIndex;
+
+    // World space, after the forward vertex shader's y/z swap
+    glm::vec3 mBoundsMin{};
+    glm::vec3 mBoundsMax{};
 };
 
 struct Scene
 {
-    std::vector<Mesh> mMeshes;
-    std::vector<Material> mMaterials;
+    TrackedVector<Mesh, MemoryCategory::Scene> mMeshes;
+    TrackedVector<Material, MemoryCategory::Scene> mMaterials;
+
+    // One per mesh, in the same order
+    TrackedVector<DrawSource, MemoryCategory::Scene> mDrawSources;
 };
 
 struct Camera
@@ -126,6 +325,11 @@ struct MetricCategory
     double SumTime = 0.0;
     uint32_t NumPublishes = 0;
     uint32_t NumIgnores = 0;
+
+    // Window of the most recent times, for percentiles
+    std::array<double, 256> Recent{};
+    uint32_t RecentCount = 0;
+    uint32_t RecentHead = 0;
 };
 
 struct Metrics
@@ -157,6 +361,10 @@ struct Metrics
     	Met.SumTime += Time;
         Met.NumPublishes++;
         Met.AvgTime = Met.SumTime / Met.NumPublishes;
+
+        Met.Recent[Met.RecentHead] = Time;
+        Met.RecentHead = (Met.RecentHead + 1) % Met.Recent.size();
+        Met.RecentCount = std::min(Met.RecentCount + 1, static_cast<uint32_t>(Met.Recent.size()));
     }
 
     double GetLastTime(std::string Category)
@@ -179,6 +387,32 @@ struct Metrics
         return mMetrics[Category].MaxTime * 1000.0;
     }
 
+    // Percentile in [0, 1] over the recent window
+    double GetPercentileTime(std::string Category, double Percentile)
+    {
+        MetricCategory& Met = mMetrics[Category];
+        if (Met.RecentCount == 0)
+            return 0.0;
+
+        std::array<double, 256> Sorted = Met.Recent;
+        auto Nth = Sorted.begin() + std::min(static_cast<uint32_t>(Percentile * Met.RecentCount), Met.RecentCount - 1);
+        std::nth_element(Sorted.begin(), Nth, Sorted.begin() + Met.RecentCount);
+
+        return *Nth * 1000.0;
+    }
+
+    uint32_t GetRecentCount(std::string Category)
+    {
+        return mMetrics[Category].RecentCount;
+    }
+
+    // Starts a new percentile window, for instance after something changed that invalidates older times
+    void ResetRecent(std::string Category)
+    {
+        mMetrics[Category].RecentCount = 0;
+        mMetrics[Category].RecentHead = 0;
+    }
+
 } gMetrics;
 
 struct Profiler
@@ -219,6 +453,8 @@ Mesh CreateScreenSpaceMesh(VertexType DefaultVal)
     VBOCreate.VertexBufferSize = sizeof(VertexType) * 4;
     VBOCreate.IndexBufferSize = sizeof(uint32_t) * 6;
     NewMesh.mBuffer = GRenderAPI->CreateVertexBuffer(&VBOCreate);
+    gMemory.TrackGpuAllocation(GpuResourceKind::VertexBuffer, "Screen space quad", VBOCreate.VertexBufferSize);
+    gMemory.TrackGpuAllocation(GpuResourceKind::IndexBuffer, "Screen space quad", VBOCreate.IndexBufferSize);
 
     VertexType ScreenSpace[4] = { DefaultVal, DefaultVal, DefaultVal, DefaultVal };
     uint32_t IndexBuffer[] = {
@@ -250,6 +486,8 @@ Mesh CreateScreenSpaceMesh(VertexType DefaultVal)
 
     GRenderAPI->UploadVertexBufferData(NewMesh.mBuffer, ScreenSpace, sizeof(ScreenSpace));
     GRenderAPI->UploadIndexBufferData(NewMesh.mBuffer, IndexBuffer, sizeof(IndexBuffer));
+    gCapture.SetBufferContents(GetCaptureKey(NewMesh.mBuffer), GetCaptureBytes(ScreenSpace), GetCaptureBytes(IndexBuffer));
+    NameCaptureObject(CaptureObjectKind::VertexBuffer, NewMesh.mBuffer, "Screen space quad");
 
     NewMesh.mVertexCount = 4;
     NewMesh.mIndexCount = 6;
@@ -257,6 +495,29 @@ Mesh CreateScreenSpaceMesh(VertexType DefaultVal)
     return NewMesh;
 }
 
+// Compiles the shaders and builds the pipeline into Target. On failure Target is left alone, so a shader edit that
+// doesn't compile keeps the last working pipeline instead of breaking the frame.
+bool CreatePipelineOrKeep(const char* Name, ShaderCreateInfo& Shaders, PipelineCreateInfo& CreateInfo, Pipeline& Target)
+{
+    CreateInfo.Shader = GRenderAPI->CreateShader(&Shaders);
+    if (!IsValidHandle(CreateInfo.Shader))
+    {
+        GLog->error("{} shaders failed to compile, keeping the previous pipeline", Name);
+        return false;
+    }
+
+    Pipeline NewPipeline = GRenderAPI->CreatePipeline(&CreateInfo);
+    if (!IsValidHandle(NewPipeline))
+    {
+        GLog->error("Failed to create the {} pipeline, keeping the previous one", Name);
+        return false;
+    }
+
+    Target = NewPipeline;
+    NameCaptureObject(CaptureObjectKind::Pipeline, Target, Name);
+    return true;
+}
+
 struct SceneRenderResources
 {
     SceneVertexUniforms mVertexUniforms;
@@ -264,15 +525,18 @@ struct SceneRenderResources
 	ResourceSet mForwardResources;
     ResourceLayout mForwardResourceLayout;
     Pipeline mForwardPipe;
-    FrameBuffer mForwardFramebuffer;
     RenderGraph mForwardRenderGraph;
 
     Camera mSceneCamera;
 
+    std::vector<LocalLight> mLights;
+    LightClusterBuilder mLightClusters;
+
     void CreateForwardRenderGraph(SwapChain Swap)
     {
+        // The frame graph transitions the color target for whichever pass reads it next
         RenderGraphAttachmentDescription ColorDesc[] = {
-            {AttachmentUsage::ColorAttachment, AttachmentUsage::ShaderRead, AttachmentFormat::B8G8R8A8_SRGB}
+            {AttachmentUsage::ColorAttachment, AttachmentUsage::ColorAttachment, AttachmentFormat::B8G8R8A8_SRGB}
         };
 
         int32_t OutColor[] = {0};
@@ -289,27 +553,7 @@ struct SceneRenderResources
         CreateInfo.Passes = Passes;
 
         mForwardRenderGraph = GRenderAPI->CreateRenderGraph(&CreateInfo);
-    }
-
-    void CreateForwardFramebuffer(SwapChain Swap)
-    {
-        uint32_t SwapWidth, SwapHeight;
-        GRenderAPI->GetSwapChainSize(Swap, SwapWidth, SwapHeight);
-
-        FramebufferAttachmentDescription ColorAttachments[] = {
-            {AttachmentUsage::ShaderRead, AttachmentFormat::B8G8R8A8_SRGB, FilterType::NEAREST}
-        };
-        FramebufferAttachmentDescription DepthStencil = { AttachmentUsage::DepthStencilAttachment, AttachmentFormat::DepthStencil, FilterType::NEAREST };
-        FrameBufferCreateInfo CreateInfo{};
-    	CreateInfo.ColorAttachmentCount = 1;
-        CreateInfo.ColorAttachmentDescriptions = ColorAttachments;
-        CreateInfo.bHasDepthStencilAttachment = true;
-        CreateInfo.DepthStencilDescription = DepthStencil;
-        CreateInfo.Width = SwapWidth;
-        CreateInfo.Height = SwapHeight;
-        CreateInfo.TargetGraph = mForwardRenderGraph;
-
-        mForwardFramebuffer = GRenderAPI->CreateFrameBuffer(&CreateInfo);
+        NameCaptureObject(CaptureObjectKind::RenderGraph, mForwardRenderGraph, "Forward");
     }
 
     void CreateForwardResources(SwapChain Swap)
@@ -318,32 +562,50 @@ struct SceneRenderResources
         CreateInfo.TargetSwap = Swap;
         CreateInfo.Layout = mForwardResourceLayout;
         mForwardResources = GRenderAPI->CreateResourceSet(&CreateInfo);
+        NameCaptureObject(CaptureObjectKind::ResourceSet, mForwardResources, "Forward");
     }
 
-    void CreateForwardPipeline()
+    void CreateForwardResourceLayout()
     {
         ConstantBufferDescription ConstBuffer[] = {
             {0, 1, ShaderStage::Vertex, sizeof(SceneVertexUniforms)},
-            {1, 1, ShaderStage::Fragment, sizeof(SceneFragmentUniforms)}
+            {1, 1, ShaderStage::Fragment, sizeof(SceneFragmentUniforms)},
+            {2, 1, ShaderStage::Fragment, sizeof(ClusterLightUniforms)},
+            {3, 1, ShaderStage::Fragment, sizeof(ClusterGridUniforms)},
+            {4, 1, ShaderStage::Fragment, sizeof(ClusterIndexUniforms)}
         };
+        TextureDescription ShadowMaps[] = {
+            {5, ShaderStage::Fragment, 1},
+            {6, ShaderStage::Fragment, 1},
+            {7, ShaderStage::Fragment, 1},
+            {8, ShaderStage::Fragment, 1}
+        };
+        static_assert(std::size(ShadowMaps) == SHADOW_CASCADE_COUNT);
+
         ResourceLayoutCreateInfo RlCreateInfo{};
         RlCreateInfo.ConstantBufferCount = std::size(ConstBuffer);
         RlCreateInfo.ConstantBuffers = ConstBuffer;
+        RlCreateInfo.TextureCount = std::size(ShadowMaps);
+        RlCreateInfo.Textures = ShadowMaps;
         mForwardResourceLayout = GRenderAPI->CreateResourceLayout(&RlCreateInfo);
+    }
 
+    // Also used to hot reload the forward shaders, keeps the current pipeline if the new one fails to build
+    void CreateForwardPipeline()
+    {
         ShaderCreateInfo ShaderCreateInfo{};
         ShaderCreateInfo.VertexShaderVirtual = "/Shaders/Forward.vert";
         ShaderCreateInfo.FragmentShaderVirtual = "/Shaders/Forward.frag";
 
         VertexAttribute Attribs[] = {
             {VertexAttributeFormat::Float3, offsetof(MeshVertex, mPosition)},
-            {VertexAttributeFormat::Float3, offsetof(MeshVertex, mNormal)}
+            {VertexAttributeFormat::Float3, offsetof(MeshVertex, mNormal)},
+            {VertexAttributeFormat::Float4, offsetof(MeshVertex, mBakedLight)}
         };
         PipelineCreateInfo CreateInfo{};
         CreateInfo.VertexAttributeCount = std::size(Attribs);
         CreateInfo.VertexAttributes = Attribs;
         CreateInfo.VertexBufferStride = sizeof(MeshVertex);
-        CreateInfo.Shader = GRenderAPI->CreateShader(&ShaderCreateInfo);
         CreateInfo.CompatibleGraph = mForwardRenderGraph;
         CreateInfo.Layout = mForwardResourceLayout;
         CreateInfo.DepthStencil.bEnableDepthTest = true;
@@ -353,7 +615,7 @@ struct SceneRenderResources
         CreateInfo.BlendSettingCount = 1;
         CreateInfo.BlendSettings = &BlendSettings;
 
-        mForwardPipe = GRenderAPI->CreatePipeline(&CreateInfo);
+        CreatePipelineOrKeep("Forward", ShaderCreateInfo, CreateInfo, mForwardPipe);
     }
 
     void UpdateCamera()
@@ -368,9 +630,12 @@ struct SceneRenderResources
         mSceneCamera.FarClip = 5000.0f;
     }
 
-    void Resize(uint32_t NewWidth, uint32_t NewHeight)
+    void UpdateLightClusters(const glm::mat4& View)
     {
-        GRenderAPI->ResizeFrameBuffer(mForwardFramebuffer, NewWidth, NewHeight);
+        ClusterFrustum Frustum{ mSceneCamera.FieldOfView, mSceneCamera.Aspect, mSceneCamera.NearClip, mSceneCamera.FarClip };
+        mLightClusters.Build(mLights, View, Frustum, gJobs);
+
+        mFragmentUniforms.mClusters = mLightClusters.mParams;
     }
 
     void Init(SwapChain Swap)
@@ -378,8 +643,8 @@ struct SceneRenderResources
         UpdateCamera();
 
         CreateForwardRenderGraph(Swap);
-        CreateForwardFramebuffer(Swap);
 
+        CreateForwardResourceLayout();
     	CreateForwardPipeline();
         CreateForwardResources(Swap);
 
@@ -394,24 +659,13 @@ glm::mat4 CreateCameraProjection(Camera& Cam)
     return glm::perspective(Cam.FieldOfView, Cam.Aspect, Cam.NearClip, Cam.FarClip);
 }
 
-glm::mat4 CreateCamTransform(Camera& Cam)
-{
-    glm::mat4 Translation = glm::translate(glm::mat4(1.0f), Cam.Position);
-    glm::mat4 Rotation = glm::toMat4(Cam.Rotation);
-//    glm::mat4 RotX = glm::rotate(glm::mat4(1.0f), Cam.Rotation.x, glm::vec3(1.0f, 0.0f, 0.0f));
-//    glm::mat4 RotY = glm::rotate(glm::mat4(1.0f), Cam.Rotation.y, glm::vec3(0.0f, 1.0f, 0.0f));
-//    glm::mat4 RotZ = glm::rotate(glm::mat4(1.0f), Cam.Rotation.z, glm::vec3(0.0f, 0.0f, 1.0f));
-
-    return Translation * Rotation;
-}
-
-glm::mat4 CreateViewMatrix(Camera& Cam)
+// Camera to world, and the view matrix that undoes it. Translation * rotation is the rotation with the position as
+// its last column, and inverting that only needs the affine inverse.
+void CreateCameraMatrices(const Camera& Cam, glm::mat4& OutTransform, glm::mat4& OutView)
 {
-    glm::mat4 Translation = glm::translate(glm::mat4(1.0f), Cam.Position);
-    glm::mat4 Rotation = glm::toMat4(Cam.Rotation);
-    glm::mat4 Transform = Translation * Rotation;
-
-    return glm::inverse(Transform);
+    OutTransform = glm::toMat4(Cam.Rotation);
+    OutTransform[3] = glm::vec4(Cam.Position, 1.0f);
+    OutView = InverseAffine(OutTransform);
 }
 
 Pipeline CreateForwardPipeline()
@@ -443,6 +697,13 @@ Pipeline CreateForwardPipeline()
     return GRenderAPI->CreatePipeline(&CreateInfo);
 }
 
+// Must match FinalPass.frag.hlsl
+struct FinalPassUniforms
+{
+    // Fraction of the source texture that holds the rendered image
+    glm::vec2 mSourceScale;
+};
+
 struct FinalPassResources
 {
     Pipeline mFinalPassPipeline;
@@ -455,7 +716,12 @@ struct FinalPassResources
         TextureDescription Tex[] = {
             {0, ShaderStage::Fragment, 1}
         };
+        ConstantBufferDescription ConstBuffer[] = {
+            {1, 1, ShaderStage::Fragment, sizeof(FinalPassUniforms)}
+        };
         ResourceLayoutCreateInfo RlCreateInfo{};
+        RlCreateInfo.ConstantBufferCount = std::size(ConstBuffer);
+        RlCreateInfo.ConstantBuffers = ConstBuffer;
         RlCreateInfo.TextureCount = std::size(Tex);
         RlCreateInfo.Textures = Tex;
 
@@ -468,8 +734,10 @@ struct FinalPassResources
         CreateInfo.Layout = mFinalPassResourceLayout;
         CreateInfo.TargetSwap = Swap;
         mFinalPassResourceSet = GRenderAPI->CreateResourceSet(&CreateInfo);
+        NameCaptureObject(CaptureObjectKind::ResourceSet, mFinalPassResourceSet, "FinalPass");
     }
 
+    // Also used to hot reload the final pass shaders, keeps the current pipeline if the new one fails to build
     void CreateFinalPassPipeline()
     {
         ShaderCreateInfo ShaderCreateInfo{};
@@ -485,7 +753,6 @@ struct FinalPassResources
         CreateInfo.VertexAttributeCount = std::size(Attribs);
         CreateInfo.VertexAttributes = Attribs;
         CreateInfo.VertexBufferStride = sizeof(FinalPassVertex);
-        CreateInfo.Shader = GRenderAPI->CreateShader(&ShaderCreateInfo);
         CreateInfo.CompatibleSwapChain = Globals.mSwap;
         CreateInfo.Layout = mFinalPassResourceLayout;
 
@@ -494,7 +761,7 @@ struct FinalPassResources
         CreateInfo.BlendSettingCount = 1;
         CreateInfo.BlendSettings = &BlendSettings;
 
-        mFinalPassPipeline = GRenderAPI->CreatePipeline(&CreateInfo);
+        CreatePipelineOrKeep("FinalPass", ShaderCreateInfo, CreateInfo, mFinalPassPipeline);
     }
 
     void CreateMesh()
@@ -510,208 +777,834 @@ struct FinalPassResources
         CreateMesh();
     }
 
-    void Composite(CommandBuffer Buf, FrameBuffer Src, uint32_t ColorAttachment, uint32_t SwapWidth, uint32_t SwapHeight)
+    // Upscales the SourceScale portion of Src to the whole swapchain
+    void Composite(CommandBuffer Buf, FrameBuffer Src, uint32_t ColorAttachment, glm::vec2 SourceScale, uint32_t SwapWidth, uint32_t SwapHeight)
     {
+        FinalPassUniforms Uniforms{ SourceScale };
+
         // Composite
         RenderGraphInfo RenderGraphInfo = {
 1,
 ClearValue{ClearType::Float, glm::vec4(0.0f, 0.0f, 0.0f, 1.0f)}
         };
-        GRenderAPI->BeginRenderGraph(Buf, Globals.mSwap, RenderGraphInfo);
+        gCapturedAPI.BeginRenderGraph(Buf, Globals.mSwap, RenderGraphInfo);
         {
-            GRenderAPI->UpdateAttachmentResource(mFinalPassResourceSet, Globals.mSwap, Src, ColorAttachment, 0);
+            gCapturedAPI.UpdateAttachmentResource(mFinalPassResourceSet, Globals.mSwap, Src, ColorAttachment, 0);
+            gCapturedAPI.UpdateUniformBuffer(mFinalPassResourceSet, Globals.mSwap, 1, &Uniforms, sizeof(Uniforms));
 
-        	GRenderAPI->BindPipeline(Buf, mFinalPassPipeline);
-        	GRenderAPI->BindResources(Buf, mFinalPassResourceSet);
-            GRenderAPI->SetViewport(Buf, 0, 0, static_cast<uint32_t>(SwapWidth), static_cast<uint32_t>(SwapHeight));
-            GRenderAPI->SetScissor(Buf, 0, 0, static_cast<uint32_t>(SwapWidth), static_cast<uint32_t>(SwapHeight));
+        	gCapturedAPI.BindPipeline(Buf, mFinalPassPipeline);
+        	gCapturedAPI.BindResources(Buf, mFinalPassResourceSet);
+            gCapturedAPI.SetViewport(Buf, 0, 0, static_cast<uint32_t>(SwapWidth), static_cast<uint32_t>(SwapHeight));
+            gCapturedAPI.SetScissor(Buf, 0, 0, static_cast<uint32_t>(SwapWidth), static_cast<uint32_t>(SwapHeight));
 
-            GRenderAPI->DrawVertexBufferIndexed(Buf, mScreenSpaceMesh.mBuffer, mScreenSpaceMesh.mIndexCount);
+            gCapturedAPI.DrawVertexBufferIndexed(Buf, mScreenSpaceMesh.mBuffer, mScreenSpaceMesh.mIndexCount);
         }
-        GRenderAPI->EndRenderGraph(Buf);
+        gCapturedAPI.EndRenderGraph(Buf);
 
     }
 
 } gFinalPass;
 
-struct SceneResourceInit
+DynamicResolutionController gDynamicResolution;
+DeferredDeletionQueue gDeferredDeletes;
+ResizeCoalescer gResize;
+
+TextureStreamer gTextureStreamer;
+HotReloader gHotReload;
+
+// Forward draws that survived culling this frame, grouped by FORWARD_PIPELINE_*
+constexpr uint32_t FORWARD_PIPELINE_OPAQUE = 0;
+constexpr uint32_t FORWARD_PIPELINE_COUNT = 1;
+IndirectDrawBuilder gForwardDraws;
+
+// Meshes covering fewer pixels than this aren't drawn
+float gMinDrawScreenSize = 1.0f;
+
+// Created and destroyed as the streamer decides, but nothing binds them until resource sets can hold sampled
+// textures
+struct StreamedTextureAllocation
 {
-    SceneResourceInit()
-    {
-	    
-    }
+    Texture Resource;
+    std::string Asset;
+    uint64_t Bytes;
 };
+std::unordered_map<uint64_t, StreamedTextureAllocation> gStreamedTextures;
 
-void RenderScene(CommandBuffer Dst, Scene Render, uint32_t SwapWidth, uint32_t SwapHeight)
+void InitTextureStreaming()
 {
+    gTextureStreamer.mCreateTexture = [](const std::string& Path, uint32_t Width, uint32_t Height, const uint8_t* Pixels)
+    {
+        static uint64_t NextHandle = 1;
 
-    ClearValue DepthClear{};
-    DepthClear.Depth = 1.0f;
-    DepthClear.Clear = ClearType::DepthStencil;
-    RenderGraphInfo RenderSceneInfo = {
-    2,
-    ClearValue{ClearType::Float, glm::vec4(0.0f, 0.0f, 0.0f, 1.0f)},
-        DepthClear
+        uint64_t Handle = NextHandle++;
+        uint64_t Bytes = static_cast<uint64_t>(Width) * Height * 4;
+        gStreamedTextures[Handle] = { GRenderAPI->CreateTexture(Width * Height * 4, TextureFormat::UINT32_R8G8B8A8, Width, Height, const_cast<uint8_t*>(Pixels)), Path, Bytes };
+        gMemory.TrackGpuAllocation(GpuResourceKind::Texture, Path, Bytes);
+        return Handle;
     };
 
-    GRenderAPI->TransitionFrameBufferColorAttachment(Dst, SceneRes.mForwardFramebuffer, 0, AttachmentUsage::ShaderRead, AttachmentUsage::ColorAttachment);
-    GRenderAPI->BeginRenderGraph(Dst, SceneRes.mForwardRenderGraph, SceneRes.mForwardFramebuffer, RenderSceneInfo);
+    gTextureStreamer.mReleaseTexture = [](uint64_t Handle)
     {
-        GRenderAPI->UpdateUniformBuffer(SceneRes.mForwardResources, Globals.mSwap, 0, &SceneRes.mVertexUniforms, sizeof(SceneRes.mVertexUniforms));
-        GRenderAPI->UpdateUniformBuffer(SceneRes.mForwardResources, Globals.mSwap, 1, &SceneRes.mFragmentUniforms, sizeof(SceneRes.mFragmentUniforms));
+        StreamedTextureAllocation Allocation = gStreamedTextures[Handle];
+        gStreamedTextures.erase(Handle);
 
-    	GRenderAPI->BindPipeline(Dst, SceneRes.mForwardPipe);
-        GRenderAPI->BindResources(Dst, SceneRes.mForwardResources);
-    	GRenderAPI->SetViewport(Dst, 0, 0, static_cast<uint32_t>(SwapWidth), static_cast<uint32_t>(SwapHeight));
-        GRenderAPI->SetScissor(Dst, 0, 0, static_cast<uint32_t>(SwapWidth), static_cast<uint32_t>(SwapHeight));
+        Texture Released = Allocation.Resource;
+        gMemory.TrackGpuRelease(GpuResourceKind::Texture, Allocation.Asset, Allocation.Bytes);
 
-        for (auto Mesh : Render.mMeshes)
+        gDeferredDeletes.Enqueue([Released]()
         {
-            GRenderAPI->DrawVertexBufferIndexed(Dst, Mesh.mBuffer, Mesh.mIndexCount);
-        }
-    }
-    GRenderAPI->EndRenderGraph(Dst);
+            GRenderAPI->DestroyTexture(Released);
+        });
+    };
 
+    gTextureStreamer.Start();
 }
 
-void ProcessNode(const aiScene* Scene, aiNode* Node)
+struct ShadowVertexUniforms
 {
+    glm::mat4 LightViewProjection;
+};
 
-}
-
-static glm::vec3 Bl, Tr;
-
-aiColor3D GetAlbedo(const aiMaterial* AIMat)
+struct ShadowPassResources
 {
-    aiColor3D AIAlbedo{1.0f, 1.0f, 1.0f};
-    if (AIMat->Get(AI_MATKEY_BASE_COLOR, AIAlbedo) == aiReturn_SUCCESS)
-        return AIAlbedo;
-    if (AIMat->Get(AI_MATKEY_COLOR_DIFFUSE, AIAlbedo) == aiReturn_SUCCESS)
-        return AIAlbedo;
-    return AIAlbedo;
-}
+    RenderGraph mShadowRenderGraph;
+    ResourceLayout mShadowResourceLayout;
+    Pipeline mShadowPipeline;
+    std::array<FrameBuffer, SHADOW_CASCADE_COUNT> mCascadeFramebuffers;
+    std::array<ResourceSet, SHADOW_CASCADE_COUNT> mCascadeResources;
 
-bool GetAlbedoTexture(const aiMaterial* AIMat, aiString& OutPath)
-{
-    aiString AlbedoPath{};
-    if (AIMat->GetTexture(aiTextureType_BASE_COLOR, 0, &AlbedoPath) == aiReturn_SUCCESS)
-    {
-        OutPath = AlbedoPath;
-        return true;
-    }
-    if (AIMat->GetTexture(aiTextureType_DIFFUSE, 0, &AlbedoPath) == aiReturn_SUCCESS)
+    CascadedShadowMap mCascades;
+    std::vector<ShadowCaster> mCasters;
+    uint64_t mSceneVersion = 0;
+
+    void CreateShadowRenderGraph()
     {
-        OutPath = AlbedoPath;
-        return true;
-    }
+        RenderPassInfo Passes[] = {
+            {0, nullptr, true}
+        };
 
-    return false;
-}
+        // The forward pass samples the depth, so it enters and leaves the graph readable
+        RenderGraphCreateInfo CreateInfo{};
+        CreateInfo.ColorAttachmentCount = 0;
+        CreateInfo.bHasDepthStencilAttachment = true;
+        CreateInfo.DepthStencilAttachmentDescription = { AttachmentUsage::ShaderRead, AttachmentUsage::ShaderRead, AttachmentFormat::DepthStencil };
+        CreateInfo.PassCount = 1;
+        CreateInfo.Passes = Passes;
 
-Texture LoadTexture(const aiString& TexturePath, std::string ParentPath)
-{
-    Texture Result{};
-    std::filesystem::path FullTexturePath = TexturePath.C_Str();
-    if(FullTexturePath.is_relative())
-    {
-        FullTexturePath = std::filesystem::canonical(ParentPath / FullTexturePath);
+        mShadowRenderGraph = GRenderAPI->CreateRenderGraph(&CreateInfo);
+        NameCaptureObject(CaptureObjectKind::RenderGraph, mShadowRenderGraph, "Shadow");
     }
 
-    int32_t Width, Height, NumChannels;
-    if (stbi_uc* Ret = stbi_load(FullTexturePath.string().c_str(), &Width, &Height, &NumChannels, 4))
+    void CreateCascadeFramebuffers()
     {
-        uint8_t* TexData = new uint8_t[Width * Height * 4];
-
-        // Copy over image data
-        for (uint32_t Row = 0; Row < static_cast<uint32_t>(Height); Row++)
+        FramebufferAttachmentDescription DepthStencil = { AttachmentUsage::ShaderRead, AttachmentFormat::DepthStencil, FilterType::NEAREST };
+        for (uint32_t CascadeIndex = 0; CascadeIndex < SHADOW_CASCADE_COUNT; CascadeIndex++)
         {
-            for (uint32_t Col = 0; Col < static_cast<uint32_t>(Width); Col++)
-            {
-                uint32_t BaseIndex = Row * Width + Col;
-                TexData[BaseIndex + 0] = Ret[BaseIndex + 0];
-                TexData[BaseIndex + 1] = Ret[BaseIndex + 1];
-                TexData[BaseIndex + 2] = Ret[BaseIndex + 2];
-                TexData[BaseIndex + 3] = Ret[BaseIndex + 3];
-            }
+            FrameBuffer& Cascade = mCascadeFramebuffers[CascadeIndex];
+
+            FrameBufferCreateInfo CreateInfo{};
+            CreateInfo.ColorAttachmentCount = 0;
+            CreateInfo.bHasDepthStencilAttachment = true;
+            CreateInfo.DepthStencilDescription = DepthStencil;
+            CreateInfo.Width = mCascades.mSettings.Resolution;
+            CreateInfo.Height = mCascades.mSettings.Resolution;
+            CreateInfo.TargetGraph = mShadowRenderGraph;
+
+            Cascade = GRenderAPI->CreateFrameBuffer(&CreateInfo);
+            gMemory.TrackGpuAllocation(GpuResourceKind::RenderTarget, "Shadow cascades", static_cast<uint64_t>(CreateInfo.Width) * CreateInfo.Height * 4);
+            NameCaptureObject(CaptureObjectKind::FrameBuffer, Cascade, "ShadowCascade" + std::to_string(CascadeIndex));
         }
+    }
 
-        Result = GRenderAPI->CreateTexture(Width * Height * 4, TextureFormat::UINT32_R8G8B8A8, Width, Height, TexData);
+    void CreateShadowResourceLayout()
+    {
+        ConstantBufferDescription ConstBuffer[] = {
+            {0, 1, ShaderStage::Vertex, sizeof(ShadowVertexUniforms)}
+        };
+        ResourceLayoutCreateInfo RlCreateInfo{};
+        RlCreateInfo.ConstantBufferCount = std::size(ConstBuffer);
+        RlCreateInfo.ConstantBuffers = ConstBuffer;
+        mShadowResourceLayout = GRenderAPI->CreateResourceLayout(&RlCreateInfo);
+    }
+
+    // Also used to hot reload the shadow shaders, keeps the current pipeline if the new one fails to build
+    void CreateShadowPipeline()
+    {
+        ShaderCreateInfo ShaderCreateInfo{};
+        ShaderCreateInfo.VertexShaderVirtual = "/Shaders/Shadow.vert";
+        ShaderCreateInfo.FragmentShaderVirtual = "/Shaders/Shadow.frag";
 
-        delete[] TexData;
+        VertexAttribute Attribs[] = {
+            {VertexAttributeFormat::Float3, offsetof(MeshVertex, mPosition)},
+            {VertexAttributeFormat::Float3, offsetof(MeshVertex, mNormal)}
+        };
+        PipelineCreateInfo CreateInfo{};
+        CreateInfo.VertexAttributeCount = std::size(Attribs);
+        CreateInfo.VertexAttributes = Attribs;
+        CreateInfo.VertexBufferStride = sizeof(MeshVertex);
+        CreateInfo.CompatibleGraph = mShadowRenderGraph;
+        CreateInfo.Layout = mShadowResourceLayout;
+        CreateInfo.DepthStencil.bEnableDepthTest = true;
+        CreateInfo.BlendSettingCount = 0;
 
-        stbi_image_free(Ret);
+        CreatePipelineOrKeep("Shadow", ShaderCreateInfo, CreateInfo, mShadowPipeline);
     }
 
-    // Always only a single result with textures
-	return Result;
-}
+    void CreateCascadeResources(SwapChain Swap)
+    {
+        // One set per cascade, since all cascades are recorded into the same command buffer
+        for (uint32_t CascadeIndex = 0; CascadeIndex < SHADOW_CASCADE_COUNT; CascadeIndex++)
+        {
+            ResourceSetCreateInfo CreateInfo{};
+            CreateInfo.TargetSwap = Swap;
+            CreateInfo.Layout = mShadowResourceLayout;
+            mCascadeResources[CascadeIndex] = GRenderAPI->CreateResourceSet(&CreateInfo);
+            NameCaptureObject(CaptureObjectKind::ResourceSet, mCascadeResources[CascadeIndex], "ShadowCascade" + std::to_string(CascadeIndex));
+        }
+    }
 
-Material BuildMaterial(const aiMaterial* AIMat, std::string ParentPath)
-{
-    Material NewMat;
+    void SetCasters(const Scene& Casters)
+    {
+        mCasters.clear();
+        for (const Mesh& Caster : Casters.mMeshes)
+        {
+            mCasters.push_back({ Caster.mBoundsMin, Caster.mBoundsMax });
+        }
 
-    aiColor3D AIAlbedo = GetAlbedo(AIMat);
-    NewMat.AlbedoColor = glm::vec3{AIAlbedo.r, AIAlbedo.g, AIAlbedo.b};
+        mSceneVersion++;
+    }
 
-    aiString AlbedoTex;
-    if(GetAlbedoTexture(AIMat, AlbedoTex))
+    void Update(const Camera& Cam, const glm::mat4& CamTransform, glm::vec3 LightDirection)
     {
-        NewMat.bUsesAlbedoTexture = true;
-        NewMat.AlbedoTexture = LoadTexture(AlbedoTex, ParentPath);
+        mCascades.Update(CamTransform, Cam.FieldOfView, Cam.Aspect, Cam.NearClip, Cam.FarClip, LightDirection, mCasters, mSceneVersion);
     }
 
-    return NewMat;
-}
+    void Render(CommandBuffer Buf, const Scene& Render)
+    {
+        ClearValue DepthClear{};
+        DepthClear.Depth = 1.0f;
+        DepthClear.Clear = ClearType::DepthStencil;
+        RenderGraphInfo ShadowInfo = {
+            1,
+            DepthClear
+        };
 
-Mesh BuildMesh(const aiMesh* AIMesh)
-{
-    Mesh NewMesh;
+        uint32_t Resolution = mCascades.mSettings.Resolution;
+        for (uint32_t CascadeIndex = 0; CascadeIndex < SHADOW_CASCADE_COUNT; CascadeIndex++)
+        {
+            const ShadowCascade& Cascade = mCascades.mCascades[CascadeIndex];
 
-    std::vector<MeshVertex> Verts;
-    for(uint32_t VertIndex = 0; VertIndex < AIMesh->mNumVertices; VertIndex++)
-    {
-        aiVector3D Pos = AIMesh->mVertices[VertIndex];
-        aiVector3D Norm = AIMesh->mNormals[VertIndex];
+            // Nothing this cascade sees changed, last frame's depth is still valid
+            if (!Cascade.bNeedsRedraw)
+                continue;
 
-        MeshVertex Vert;
-        Vert.mPosition = {Pos.x, Pos.y, Pos.z};
-        Vert.mNormal = {Norm.x, Norm.y, Norm.z};
-        Verts.push_back(Vert);
+            ShadowVertexUniforms Uniforms{ glm::transpose(Cascade.ViewProjection) };
 
-        Bl.x = std::min(Bl.x, Vert.mPosition.x);
-        Bl.y = std::min(Bl.y, Vert.mPosition.y);
-        Bl.z = std::min(Bl.z, Vert.mPosition.z);
-        Tr.x = std::max(Tr.x, Vert.mPosition.x);
-        Tr.y = std::max(Tr.y, Vert.mPosition.y);
-        Tr.z = std::max(Tr.z, Vert.mPosition.z);
+            gCapturedAPI.BeginRenderGraph(Buf, mShadowRenderGraph, mCascadeFramebuffers[CascadeIndex], ShadowInfo);
+            {
+                gCapturedAPI.UpdateUniformBuffer(mCascadeResources[CascadeIndex], Globals.mSwap, 0, &Uniforms, sizeof(Uniforms));
+
+                gCapturedAPI.BindPipeline(Buf, mShadowPipeline);
+                gCapturedAPI.BindResources(Buf, mCascadeResources[CascadeIndex]);
+                gCapturedAPI.SetViewport(Buf, 0, 0, Resolution, Resolution);
+                gCapturedAPI.SetScissor(Buf, 0, 0, Resolution, Resolution);
+
+                for (uint32_t CasterIndex : Cascade.Casters)
+                {
+                    const Mesh& Caster = Render.mMeshes[CasterIndex];
+                    gCapturedAPI.DrawVertexBufferIndexed(Buf, Caster.mBuffer, Caster.mIndexCount);
+                }
+            }
+            gCapturedAPI.EndRenderGraph(Buf);
+        }
     }
 
-    std::vector<uint32_t> Indicies;
-    for(uint32_t VertIndex = 0; VertIndex < AIMesh->mNumFaces; VertIndex++)
+    void Init(SwapChain Swap)
     {
-        if(AIMesh->mFaces[VertIndex].mNumIndices == 3)
-        {
-            Indicies.push_back(AIMesh->mFaces[VertIndex].mIndices[0]);
-            Indicies.push_back(AIMesh->mFaces[VertIndex].mIndices[1]);
-            Indicies.push_back(AIMesh->mFaces[VertIndex].mIndices[2]);
-        }
+        CreateShadowRenderGraph();
+        CreateCascadeFramebuffers();
+        CreateShadowResourceLayout();
+        CreateShadowPipeline();
+        CreateCascadeResources(Swap);
+
+        mCascades.Invalidate();
     }
 
-    VertexBufferCreateInfo CreateInfo{};
+} gShadowPass;
+
+struct SceneResourceInit
+{
+    SceneResourceInit()
+    {
+	    
+    }
+};
+
+void RenderScene(CommandBuffer Dst, FrameBuffer Target, const Scene& Render, uint32_t SwapWidth, uint32_t SwapHeight)
+{
+
+    ClearValue DepthClear{};
+    DepthClear.Depth = 1.0f;
+    DepthClear.Clear = ClearType::DepthStencil;
+    RenderGraphInfo RenderSceneInfo = {
+    2,
+    ClearValue{ClearType::Float, glm::vec4(0.0f, 0.0f, 0.0f, 1.0f)},
+        DepthClear
+    };
+
+    gCapturedAPI.BeginRenderGraph(Dst, SceneRes.mForwardRenderGraph, Target, RenderSceneInfo);
+    {
+        gCapturedAPI.UpdateUniformBuffer(SceneRes.mForwardResources, Globals.mSwap, 0, &SceneRes.mVertexUniforms, sizeof(SceneRes.mVertexUniforms));
+        gCapturedAPI.UpdateUniformBuffer(SceneRes.mForwardResources, Globals.mSwap, 1, &SceneRes.mFragmentUniforms, sizeof(SceneRes.mFragmentUniforms));
+        gCapturedAPI.UpdateUniformBuffer(SceneRes.mForwardResources, Globals.mSwap, 2, &SceneRes.mLightClusters.mLightUniforms, sizeof(ClusterLightUniforms));
+        gCapturedAPI.UpdateUniformBuffer(SceneRes.mForwardResources, Globals.mSwap, 3, &SceneRes.mLightClusters.mGridUniforms, sizeof(ClusterGridUniforms));
+        gCapturedAPI.UpdateUniformBuffer(SceneRes.mForwardResources, Globals.mSwap, 4, &SceneRes.mLightClusters.mIndexUniforms, sizeof(ClusterIndexUniforms));
+
+        for (uint32_t CascadeIndex = 0; CascadeIndex < SHADOW_CASCADE_COUNT; CascadeIndex++)
+        {
+            gCapturedAPI.UpdateAttachmentResource(SceneRes.mForwardResources, Globals.mSwap, gShadowPass.mCascadeFramebuffers[CascadeIndex], 0, 5 + CascadeIndex);
+        }
+
+    	gCapturedAPI.SetViewport(Dst, 0, 0, static_cast<uint32_t>(SwapWidth), static_cast<uint32_t>(SwapHeight));
+        gCapturedAPI.SetScissor(Dst, 0, 0, static_cast<uint32_t>(SwapWidth), static_cast<uint32_t>(SwapHeight));
+
+        // The render API has no indirect draws, so the compacted records are issued one by one. They're grouped by
+        // pipeline, which keeps it to one bind per pipeline.
+        Pipeline ForwardPipelines[FORWARD_PIPELINE_COUNT] = { SceneRes.mForwardPipe };
+        for (uint32_t PipelineIndex = 0; PipelineIndex < gForwardDraws.mPipelineFirst.size(); PipelineIndex++)
+        {
+            uint32_t First = gForwardDraws.mPipelineFirst[PipelineIndex];
+            uint32_t Count = gForwardDraws.mPipelineCount[PipelineIndex];
+            if (Count == 0)
+                continue;
+
+            gCapturedAPI.BindPipeline(Dst, ForwardPipelines[PipelineIndex]);
+            gCapturedAPI.BindResources(Dst, SceneRes.mForwardResources);
+
+            for (uint32_t DrawIndex = First; DrawIndex < First + Count; DrawIndex++)
+            {
+                const DrawIndexedIndirectCommand& Command = gForwardDraws.mCommands[DrawIndex];
+                const Mesh& DrawMesh = Render.mMeshes[gForwardDraws.mDrawData[DrawIndex].SourceIndex];
+                gCapturedAPI.DrawVertexBufferIndexed(Dst, DrawMesh.mBuffer, Command.IndexCount);
+            }
+        }
+    }
+    gCapturedAPI.EndRenderGraph(Dst);
+
+}
+
+// Owns the frame's pass layout and the physical attachments behind its transient resources
+struct FrameGraphResources
+{
+    struct PhysicalTarget
+    {
+        std::vector<uint32_t> Slots;
+        FrameBuffer Target;
+        uint32_t Width = 0;
+        uint32_t Height = 0;
+
+        // Enough to create the framebuffer again at another size
+        std::vector<AttachmentFormat> ColorFormats;
+        bool bHasDepth = false;
+        RenderGraph CompatibleGraph;
+
+        // Actual usage of each color attachment, carried across frames since transients start each frame undefined
+        std::vector<AttachmentUsage> ColorUsage;
+
+        // Framebuffers retired from this target once no frame in flight uses them, resized on reuse
+        struct Spare
+        {
+            FrameBuffer Buffer;
+            uint32_t Width;
+            uint32_t Height;
+        };
+        std::vector<Spare> Spares;
+
+        uint64_t GetBytes(uint32_t AtWidth, uint32_t AtHeight) const
+        {
+            return static_cast<uint64_t>(AtWidth) * AtHeight * 4 * (ColorFormats.size() + (bHasDepth ? 1 : 0));
+        }
+    };
+
+    struct AttachmentRef
+    {
+        uint32_t Target = ~0u;
+        uint32_t Attachment = 0;
+    };
+
+    FrameGraph mGraph;
+
+    FrameGraphResource mShadowMaps = INVALID_FRAME_GRAPH_RESOURCE;
+    FrameGraphResource mForwardColor = INVALID_FRAME_GRAPH_RESOURCE;
+    FrameGraphResource mForwardDepth = INVALID_FRAME_GRAPH_RESOURCE;
+    FrameGraphResource mBackBuffer = INVALID_FRAME_GRAPH_RESOURCE;
+
+    // Engine render graph each pass' attachments have to be compatible with, indexed by pass
+    std::vector<RenderGraph> mPassRenderGraphs;
+
+    std::vector<PhysicalTarget> mTargets;
+    std::vector<AttachmentRef> mResourceTargets;
+
+    // Valid while the graph executes
+    CommandBuffer mCmd{};
+    const Scene* mScene = nullptr;
+    uint32_t mSwapWidth = 0;
+    uint32_t mSwapHeight = 0;
+
+    // Region of the forward targets actually rendered, they stay allocated at a bucketed swapchain size
+    uint32_t mRenderWidth = 0;
+    uint32_t mRenderHeight = 0;
+
+    // Allocated size of the swapchain sized transients
+    uint32_t mTargetWidth = 0;
+    uint32_t mTargetHeight = 0;
+    uint32_t mReallocations = 0;
+
+    static FrameGraphTextureDesc CreateAttachmentDesc(uint32_t Width, uint32_t Height, AttachmentFormat Format)
+    {
+        return { Width, Height, static_cast<uint32_t>(Format), 4 };
+    }
+
+    static bool IsDepthFormat(const FrameGraphTextureDesc& Desc)
+    {
+        return Desc.Format == static_cast<uint32_t>(AttachmentFormat::DepthStencil);
+    }
+
+    static AttachmentUsage ToAttachmentUsage(FrameGraphState State)
+    {
+        switch (State)
+        {
+        case FrameGraphState::ColorAttachment:
+            return AttachmentUsage::ColorAttachment;
+        case FrameGraphState::DepthStencilAttachment:
+            return AttachmentUsage::DepthStencilAttachment;
+        default:
+            return AttachmentUsage::ShaderRead;
+        }
+    }
+
+    uint32_t AddPass(std::string Name, RenderGraph CompatibleGraph, std::function<void()> Execute, bool bHasSideEffects = false)
+    {
+        mPassRenderGraphs.push_back(CompatibleGraph);
+        return mGraph.AddPass(std::move(Name), std::move(Execute), bHasSideEffects);
+    }
+
+    FrameBuffer GetFrameBuffer(FrameGraphResource Resource) const
+    {
+        return mTargets[mResourceTargets[Resource].Target].Target;
+    }
+
+    uint32_t GetAttachmentIndex(FrameGraphResource Resource) const
+    {
+        return mResourceTargets[Resource].Attachment;
+    }
+
+    void Init(SwapChain Swap)
+    {
+        uint32_t SwapWidth, SwapHeight;
+        GRenderAPI->GetSwapChainSize(Swap, SwapWidth, SwapHeight);
+        mTargetWidth = ChooseTargetSize(0, SwapWidth);
+        mTargetHeight = ChooseTargetSize(0, SwapHeight);
+
+        // Shadow maps persist across frames so cascades can be cached, their render graph keeps them readable
+        mShadowMaps = mGraph.ImportTexture("ShadowMaps", FrameGraphState::ShaderRead, FrameGraphState::ShaderRead);
+        mBackBuffer = mGraph.ImportTexture("BackBuffer", FrameGraphState::Undefined, FrameGraphState::Undefined);
+        mForwardColor = mGraph.CreateTexture("ForwardColor", CreateAttachmentDesc(mTargetWidth, mTargetHeight, AttachmentFormat::B8G8R8A8_SRGB));
+        mForwardDepth = mGraph.CreateTexture("ForwardDepth", CreateAttachmentDesc(mTargetWidth, mTargetHeight, AttachmentFormat::DepthStencil));
+
+        uint32_t Shadows = AddPass("Shadows", gShadowPass.mShadowRenderGraph, [this]()
+        {
+            gShadowPass.Render(mCmd, *mScene);
+        });
+        mGraph.Write(Shadows, mShadowMaps, FrameGraphState::DepthStencilAttachment);
+
+        uint32_t Forward = AddPass("Forward", SceneRes.mForwardRenderGraph, [this]()
+        {
+            RenderScene(mCmd, GetFrameBuffer(mForwardColor), *mScene, mRenderWidth, mRenderHeight);
+        });
+        mGraph.Read(Forward, mShadowMaps);
+        mGraph.Write(Forward, mForwardColor, FrameGraphState::ColorAttachment);
+        mGraph.Write(Forward, mForwardDepth, FrameGraphState::DepthStencilAttachment);
+
+        uint32_t Composite = AddPass("Composite", {}, [this]()
+        {
+            const FrameGraphTextureDesc& Source = mGraph.GetTextureDesc(mForwardColor);
+            glm::vec2 SourceScale = { static_cast<float>(mRenderWidth) / Source.Width, static_cast<float>(mRenderHeight) / Source.Height };
+            gFinalPass.Composite(mCmd, GetFrameBuffer(mForwardColor), GetAttachmentIndex(mForwardColor), SourceScale, mSwapWidth, mSwapHeight);
+        }, true);
+        mGraph.Read(Composite, mForwardColor);
+        mGraph.Write(Composite, mBackBuffer, FrameGraphState::ColorAttachment);
+
+        uint32_t UI = AddPass("ImGui", {}, [this]()
+        {
+            RecordImGuiDrawCmds(mCmd);
+        }, true);
+        mGraph.Write(UI, mBackBuffer, FrameGraphState::ColorAttachment);
+    }
+
+    // Small size changes stay within the current allocation and don't even recompile the graph
+    void Resize(uint32_t NewWidth, uint32_t NewHeight)
+    {
+        mTargetWidth = ChooseTargetSize(mTargetWidth, NewWidth);
+        mTargetHeight = ChooseTargetSize(mTargetHeight, NewHeight);
+
+        mGraph.SetTextureDesc(mForwardColor, CreateAttachmentDesc(mTargetWidth, mTargetHeight, AttachmentFormat::B8G8R8A8_SRGB));
+        mGraph.SetTextureDesc(mForwardDepth, CreateAttachmentDesc(mTargetWidth, mTargetHeight, AttachmentFormat::DepthStencil));
+    }
+
+    // Targets are created in the same order every run, so their index identifies them across sessions
+    static std::string GetTargetLabel(uint32_t TargetIndex)
+    {
+        return "FrameGraphTarget" + std::to_string(TargetIndex);
+    }
+
+    FrameBuffer CreateTargetFrameBuffer(const PhysicalTarget& Target, uint32_t Width, uint32_t Height)
+    {
+        std::vector<FramebufferAttachmentDescription> ColorAttachments;
+        for (AttachmentFormat Format : Target.ColorFormats)
+            ColorAttachments.push_back({ AttachmentUsage::ShaderRead, Format, FilterType::NEAREST });
+
+        FrameBufferCreateInfo CreateInfo{};
+        CreateInfo.ColorAttachmentCount = static_cast<uint32_t>(ColorAttachments.size());
+        CreateInfo.ColorAttachmentDescriptions = ColorAttachments.data();
+        CreateInfo.bHasDepthStencilAttachment = Target.bHasDepth;
+        CreateInfo.DepthStencilDescription = { AttachmentUsage::DepthStencilAttachment, AttachmentFormat::DepthStencil, FilterType::NEAREST };
+        CreateInfo.Width = Width;
+        CreateInfo.Height = Height;
+        CreateInfo.TargetGraph = Target.CompatibleGraph;
+
+        gMemory.TrackGpuAllocation(GpuResourceKind::RenderTarget, "Frame graph targets", Target.GetBytes(Width, Height));
+        return GRenderAPI->CreateFrameBuffer(&CreateInfo);
+    }
+
+    // Swaps in a framebuffer of the new size. The old one may still be referenced by frames in flight, so it only
+    // becomes a spare once they retired; resizing a spare then can't stall on work that is using it.
+    void ReallocateTarget(uint32_t TargetIndex, uint32_t Width, uint32_t Height)
+    {
+        PhysicalTarget& Target = mTargets[TargetIndex];
+
+        PhysicalTarget::Spare Old = { Target.Target, Target.Width, Target.Height };
+        gDeferredDeletes.Enqueue([this, TargetIndex, Old]()
+        {
+            mTargets[TargetIndex].Spares.push_back(Old);
+        });
+
+        if (!Target.Spares.empty())
+        {
+            PhysicalTarget::Spare Reused = Target.Spares.back();
+            Target.Spares.pop_back();
+
+            Target.Target = Reused.Buffer;
+            GRenderAPI->ResizeFrameBuffer(Target.Target, Width, Height);
+
+            gMemory.TrackGpuRelease(GpuResourceKind::RenderTarget, "Frame graph targets", Target.GetBytes(Reused.Width, Reused.Height));
+            gMemory.TrackGpuAllocation(GpuResourceKind::RenderTarget, "Frame graph targets", Target.GetBytes(Width, Height));
+        }
+        else
+        {
+            Target.Target = CreateTargetFrameBuffer(Target, Width, Height);
+        }
+
+        Target.Width = Width;
+        Target.Height = Height;
+        Target.ColorUsage.assign(Target.ColorUsage.size(), AttachmentUsage::ShaderRead);
+        NameCaptureObject(CaptureObjectKind::FrameBuffer, Target.Target, GetTargetLabel(TargetIndex));
+        mReallocations++;
+    }
+
+    // Creates or resizes a framebuffer for every distinct set of physical slots a pass renders into. Passes whose
+    // transients were aliased into the same slots end up sharing a framebuffer.
+    void Realize()
+    {
+        mResourceTargets.assign(mGraph.GetResourceCount(), {});
+
+        for (const FrameGraphCompiledPass& Compiled : mGraph.GetSchedule())
+        {
+            std::vector<FrameGraphResource> Colors;
+            FrameGraphResource Depth = INVALID_FRAME_GRAPH_RESOURCE;
+            for (FrameGraphResource Write : mGraph.GetPassWrites(Compiled.Pass))
+            {
+                if (!mGraph.IsTransient(Write))
+                    continue;
+
+                if (IsDepthFormat(mGraph.GetTextureDesc(Write)))
+                    Depth = Write;
+                else
+                    Colors.push_back(Write);
+            }
+
+            if (Colors.empty() && Depth == INVALID_FRAME_GRAPH_RESOURCE)
+                continue;
+
+            std::vector<uint32_t> Slots;
+            for (FrameGraphResource Color : Colors)
+                Slots.push_back(mGraph.GetPhysicalSlot(Color));
+            if (Depth != INVALID_FRAME_GRAPH_RESOURCE)
+                Slots.push_back(mGraph.GetPhysicalSlot(Depth));
+
+            const FrameGraphTextureDesc& Desc = mGraph.GetPhysicalSlotDesc(Slots[0]);
+
+            uint32_t TargetIndex = 0;
+            while (TargetIndex < mTargets.size() && mTargets[TargetIndex].Slots != Slots)
+                TargetIndex++;
+
+            if (TargetIndex == mTargets.size())
+            {
+                PhysicalTarget& NewTarget = mTargets.emplace_back();
+                NewTarget.Slots = Slots;
+                for (FrameGraphResource Color : Colors)
+                    NewTarget.ColorFormats.push_back(static_cast<AttachmentFormat>(mGraph.GetTextureDesc(Color).Format));
+                NewTarget.bHasDepth = Depth != INVALID_FRAME_GRAPH_RESOURCE;
+                NewTarget.CompatibleGraph = mPassRenderGraphs[Compiled.Pass];
+                NewTarget.Target = CreateTargetFrameBuffer(NewTarget, Desc.Width, Desc.Height);
+                NewTarget.Width = Desc.Width;
+                NewTarget.Height = Desc.Height;
+                NewTarget.ColorUsage.assign(Colors.size(), AttachmentUsage::ShaderRead);
+                NameCaptureObject(CaptureObjectKind::FrameBuffer, NewTarget.Target, GetTargetLabel(TargetIndex));
+            }
+            else if (mTargets[TargetIndex].Width != Desc.Width || mTargets[TargetIndex].Height != Desc.Height)
+            {
+                ReallocateTarget(TargetIndex, Desc.Width, Desc.Height);
+            }
+
+            for (uint32_t ColorIndex = 0; ColorIndex < Colors.size(); ColorIndex++)
+                mResourceTargets[Colors[ColorIndex]] = { TargetIndex, ColorIndex };
+            if (Depth != INVALID_FRAME_GRAPH_RESOURCE)
+                mResourceTargets[Depth] = { TargetIndex, static_cast<uint32_t>(Colors.size()) };
+        }
+    }
+
+    void ApplyBarrier(const FrameGraphBarrier& Barrier)
+    {
+        // Imported resources and depth attachments are transitioned by the render graphs that use them
+        if (!mGraph.IsTransient(Barrier.Resource) || IsDepthFormat(mGraph.GetTextureDesc(Barrier.Resource)))
+            return;
+
+        const AttachmentRef& Ref = mResourceTargets[Barrier.Resource];
+        PhysicalTarget& Target = mTargets[Ref.Target];
+
+        AttachmentUsage After = ToAttachmentUsage(Barrier.After);
+        if (Target.ColorUsage[Ref.Attachment] != After)
+        {
+            gCapturedAPI.TransitionFrameBufferColorAttachment(mCmd, Target.Target, Ref.Attachment, Target.ColorUsage[Ref.Attachment], After);
+            Target.ColorUsage[Ref.Attachment] = After;
+        }
+    }
+
+    void Execute(CommandBuffer Cmd, const Scene& Render, uint32_t SwapWidth, uint32_t SwapHeight, uint32_t RenderWidth, uint32_t RenderHeight)
+    {
+        mCmd = Cmd;
+        mScene = &Render;
+        mSwapWidth = SwapWidth;
+        mSwapHeight = SwapHeight;
+        mRenderWidth = RenderWidth;
+        mRenderHeight = RenderHeight;
+
+        // Only recompiles after the pass layout or a transient's size changed
+        if (mGraph.Compile())
+            Realize();
+
+        mGraph.Execute([this](const FrameGraphBarrier& Barrier)
+        {
+            ApplyBarrier(Barrier);
+        });
+
+        mScene = nullptr;
+    }
+
+} gFrameGraph;
+
+void ProcessNode(const aiScene* Scene, aiNode* Node)
+{
+
+}
+
+static glm::vec3 Bl, Tr;
+
+aiColor3D GetAlbedo(const aiMaterial* AIMat)
+{
+    aiColor3D AIAlbedo{1.0f, 1.0f, 1.0f};
+    if (AIMat->Get(AI_MATKEY_BASE_COLOR, AIAlbedo) == aiReturn_SUCCESS)
+        return AIAlbedo;
+    if (AIMat->Get(AI_MATKEY_COLOR_DIFFUSE, AIAlbedo) == aiReturn_SUCCESS)
+        return AIAlbedo;
+    return AIAlbedo;
+}
+
+bool GetAlbedoTexture(const aiMaterial* AIMat, aiString& OutPath)
+{
+    aiString AlbedoPath{};
+    if (AIMat->GetTexture(aiTextureType_BASE_COLOR, 0, &AlbedoPath) == aiReturn_SUCCESS)
+    {
+        OutPath = AlbedoPath;
+        return true;
+    }
+    if (AIMat->GetTexture(aiTextureType_DIFFUSE, 0, &AlbedoPath) == aiReturn_SUCCESS)
+    {
+        OutPath = AlbedoPath;
+        return true;
+    }
+
+    return false;
+}
+
+std::string ResolveTexturePath(const aiString& TexturePath, std::string ParentPath)
+{
+    std::filesystem::path FullTexturePath = TexturePath.C_Str();
+    if(FullTexturePath.is_relative())
+    {
+        FullTexturePath = std::filesystem::canonical(ParentPath / FullTexturePath);
+    }
+
+    return FullTexturePath.string();
+}
+
+Material BuildMaterial(const aiMaterial* AIMat, std::string ParentPath)
+{
+    Material NewMat;
+
+    aiColor3D AIAlbedo = GetAlbedo(AIMat);
+    NewMat.AlbedoColor = glm::vec3{AIAlbedo.r, AIAlbedo.g, AIAlbedo.b};
+
+    aiString AlbedoTex;
+    if(GetAlbedoTexture(AIMat, AlbedoTex))
+    {
+        NewMat.bUsesAlbedoTexture = true;
+        // Only the low mip is loaded up front, the rest streams in once something looks at it
+        NewMat.AlbedoTexture = gTextureStreamer.Register(ResolveTexturePath(AlbedoTex, ParentPath));
+    }
+
+    return NewMat;
+}
+
+Mesh BuildMesh(const aiMesh* AIMesh, const std::string& Asset, const LightmapAtlas* Lightmap, uint32_t MeshIndex)
+{
+    Mesh NewMesh;
+    NewMesh.mBoundsMin = glm::vec3(std::numeric_limits<float>::max());
+    NewMesh.mBoundsMax = glm::vec3(std::numeric_limits<float>::lowest());
+
+    TrackedVector<MeshVertex, MemoryCategory::MeshBuild> Verts;
+    Verts.reserve(AIMesh->mNumVertices);
+    for(uint32_t VertIndex = 0; VertIndex < AIMesh->mNumVertices; VertIndex++)
+    {
+        aiVector3D Pos = AIMesh->mVertices[VertIndex];
+        aiVector3D Norm = AIMesh->mNormals[VertIndex];
+
+        MeshVertex Vert;
+        Vert.mPosition = {Pos.x, Pos.y, Pos.z};
+        Vert.mNormal = {Norm.x, Norm.y, Norm.z};
+        Verts.push_back(Vert);
+    }
+
+    // One pass over the finished vertices instead of a min/max chain per vertex. World space swaps y and z.
+    if (!Verts.empty())
+    {
+        glm::vec3 Min, Max;
+        ComputePointBounds(&Verts[0].mPosition, static_cast<uint32_t>(Verts.size()), sizeof(MeshVertex), Min, Max);
+
+        Bl = glm::min(Bl, Min);
+        Tr = glm::max(Tr, Max);
+        NewMesh.mBoundsMin = { Min.x, Min.z, Min.y };
+        NewMesh.mBoundsMax = { Max.x, Max.z, Max.y };
+    }
+
+    TrackedVector<uint32_t, MemoryCategory::MeshBuild> Indicies;
+    for(uint32_t VertIndex = 0; VertIndex < AIMesh->mNumFaces; VertIndex++)
+    {
+        if(AIMesh->mFaces[VertIndex].mNumIndices == 3)
+        {
+            Indicies.push_back(AIMesh->mFaces[VertIndex].mIndices[0]);
+            Indicies.push_back(AIMesh->mFaces[VertIndex].mIndices[1]);
+            Indicies.push_back(AIMesh->mFaces[VertIndex].mIndices[2]);
+        }
+    }
+
+    if (Lightmap)
+    {
+        std::vector<glm::vec4> Baked = ResolveLightmapToVertices(*Lightmap, MeshIndex, Indicies, static_cast<uint32_t>(Verts.size()));
+        for (uint32_t VertIndex = 0; VertIndex < Baked.size(); VertIndex++)
+            Verts[VertIndex].mBakedLight = Baked[VertIndex];
+    }
+
+    VertexBufferCreateInfo CreateInfo{};
     CreateInfo.bCreateIndexBuffer = true;
     CreateInfo.VertexBufferSize = Verts.size() * sizeof(MeshVertex);
     CreateInfo.IndexBufferSize = Indicies.size() * sizeof(uint32_t);
     NewMesh.mBuffer = GRenderAPI->CreateVertexBuffer(&CreateInfo);
+    gMemory.TrackGpuAllocation(GpuResourceKind::VertexBuffer, Asset, CreateInfo.VertexBufferSize);
+    gMemory.TrackGpuAllocation(GpuResourceKind::IndexBuffer, Asset, CreateInfo.IndexBufferSize);
 
     GRenderAPI->UploadVertexBufferData(NewMesh.mBuffer, Verts.data(), CreateInfo.VertexBufferSize);
     GRenderAPI->UploadIndexBufferData(NewMesh.mBuffer, Indicies.data(), CreateInfo.IndexBufferSize);
 
+    // Captures of frames drawing this mesh take its contents along
+    gCapture.SetBufferContents(GetCaptureKey(NewMesh.mBuffer), { reinterpret_cast<const uint8_t*>(Verts.data()), Verts.size() * sizeof(MeshVertex) },
+        { reinterpret_cast<const uint8_t*>(Indicies.data()), Indicies.size() * sizeof(uint32_t) });
+    NameCaptureObject(CaptureObjectKind::VertexBuffer, NewMesh.mBuffer, Asset);
+
     NewMesh.mVertexCount = Verts.size();
     NewMesh.mIndexCount = Indicies.size();
+    NewMesh.mMaterialIndex = AIMesh->mMaterialIndex;
 
     return NewMesh;
 }
 
+// Baked next to the scene, e.g. Sponza.gltf has Sponza.lightmap
+std::string GetLightmapPath(const std::string& SceneFile)
+{
+    return std::filesystem::path(SceneFile).replace_extension(".lightmap").string();
+}
+
+// Static geometry for the lightmap baker, read the same way ImportScene reads it so meshes and triangles line up
+std::vector<BakeMesh> LoadBakeMeshes(const std::string& File)
+{
+    Assimp::Importer Importer;
+    const aiScene* AIScene = Importer.ReadFile(File,
+        aiProcess_CalcTangentSpace       |
+        aiProcess_Triangulate            |
+        aiProcess_JoinIdenticalVertices  |
+        aiProcess_SortByPType
+    );
+
+    std::vector<BakeMesh> Meshes;
+    if (!AIScene)
+        return Meshes;
+
+    for (uint32_t MeshIndex = 0; MeshIndex < AIScene->mNumMeshes; MeshIndex++)
+    {
+        const aiMesh* AIMesh = AIScene->mMeshes[MeshIndex];
+        BakeMesh& Mesh = Meshes.emplace_back();
+
+        // World space swaps y and z, like the forward vertex shader
+        for (uint32_t VertIndex = 0; VertIndex < AIMesh->mNumVertices; VertIndex++)
+        {
+            aiVector3D Pos = AIMesh->mVertices[VertIndex];
+            aiVector3D Norm = AIMesh->mNormals[VertIndex];
+            Mesh.Positions.push_back({ Pos.x, Pos.z, Pos.y });
+            Mesh.Normals.push_back({ Norm.x, Norm.z, Norm.y });
+        }
+
+        for (uint32_t FaceIndex = 0; FaceIndex < AIMesh->mNumFaces; FaceIndex++)
+        {
+            const aiFace& Face = AIMesh->mFaces[FaceIndex];
+            if (Face.mNumIndices == 3)
+                Mesh.Indices.insert(Mesh.Indices.end(), Face.mIndices, Face.mIndices + 3);
+        }
+
+        // Textures aren't sampled while baking, textured materials are assumed to average half their base color
+        if (AIMesh->mMaterialIndex < AIScene->mNumMaterials)
+        {
+            const aiMaterial* AIMat = AIScene->mMaterials[AIMesh->mMaterialIndex];
+            aiColor3D AIAlbedo = GetAlbedo(AIMat);
+            aiString AlbedoTex;
+            float TextureScale = GetAlbedoTexture(AIMat, AlbedoTex) ? 0.5f : 1.0f;
+            Mesh.Albedo = glm::clamp(glm::vec3(AIAlbedo.r, AIAlbedo.g, AIAlbedo.b) * TextureScale, glm::vec3(0.0f), glm::vec3(0.95f));
+        }
+    }
+
+    return Meshes;
+}
+
 Scene ImportScene(std::string File)
 {
     std::string ParentPath = std::filesystem::path(File).parent_path().string();
@@ -725,11 +1618,35 @@ Scene ImportScene(std::string File)
 
     Scene NewScene;
 
+    // Baked lighting is optional, scenes without a lightmap or with a stale one just go without
+    LightmapAtlas Lightmap;
+    bool bHasLightmap = ReadLightmap(GetLightmapPath(File), Lightmap);
+    if (bHasLightmap && Lightmap.MeshUVs.size() != AIScene->mNumMeshes)
+    {
+        GLog->warn("Ignoring lightmap for {}, it was baked for {} meshes but the scene has {}", File, Lightmap.MeshUVs.size(), AIScene->mNumMeshes);
+        bHasLightmap = false;
+    }
+
     // Build meshes
     for(uint32_t MeshIndex = 0; MeshIndex < AIScene->mNumMeshes; MeshIndex++)
     {
         aiMesh* Mesh = AIScene->mMeshes[MeshIndex];
-        NewScene.mMeshes.push_back(BuildMesh(Mesh));
+
+        // Buffers of a reimported scene are never destroyed, so every reimport shows up as growth of these assets
+        std::string Asset = std::filesystem::path(File).filename().string() + "/" + (Mesh->mName.length > 0 ? Mesh->mName.C_Str() : std::to_string(MeshIndex));
+        NewScene.mMeshes.push_back(BuildMesh(Mesh, Asset, bHasLightmap ? &Lightmap : nullptr, MeshIndex));
+    }
+
+    // Meshes have a single level, below the minimum screen size they're culled
+    for (const Mesh& SourceMesh : NewScene.mMeshes)
+    {
+        DrawSource Source;
+        Source.BoundsMin = SourceMesh.mBoundsMin;
+        Source.BoundsMax = SourceMesh.mBoundsMax;
+        Source.PipelineIndex = FORWARD_PIPELINE_OPAQUE;
+        Source.MaterialIndex = SourceMesh.mMaterialIndex;
+        Source.Lods[0].IndexCount = SourceMesh.mIndexCount;
+        NewScene.mDrawSources.push_back(Source);
     }
 
     // Build materials
@@ -746,6 +1663,253 @@ Scene ImportScene(std::string File)
     return NewScene;
 }
 
+// Shader names are virtual paths without the extension, as passed to CreateShader
+void TrackPipeline(const std::string& Node, const std::filesystem::path& ShadersRoot, std::initializer_list<const char*> Shaders, std::function<void()> Reload)
+{
+    for (const char* Shader : Shaders)
+        gHotReload.TrackShader(Node, (ShadersRoot / (std::string(Shader) + ".hlsl")).string());
+
+    gHotReload.mGraph.SetReloader(Node, std::move(Reload));
+}
+
+// The scene depends on its glTF and buffers. Textures are streamed independently, so each one just reloads itself.
+void TrackSceneFiles(const std::string& Node, const std::string& SceneFile, const Scene& Tracked)
+{
+    std::unordered_set<std::string> Textures;
+    for (const Material& Mat : Tracked.mMaterials)
+    {
+        if (Mat.AlbedoTexture == INVALID_STREAMED_TEXTURE)
+            continue;
+
+        StreamedTextureId Id = Mat.AlbedoTexture;
+        std::string Path = NormalizePath(gTextureStreamer.GetPath(Id));
+        Textures.insert(Path);
+        gHotReload.mGraph.SetReloader(Path, [Id]()
+        {
+            gTextureStreamer.Reload(Id);
+        });
+    }
+
+    gHotReload.mGraph.ClearDependencies(Node);
+    gHotReload.mGraph.AddDependency(Node, NormalizePath(SceneFile));
+
+    // Rebaking reimports the scene to pick up the new lighting
+    gHotReload.mGraph.AddDependency(Node, NormalizePath(GetLightmapPath(SceneFile)));
+    for (const std::string& Uri : ScanGltfUris(SceneFile))
+    {
+        if (!Textures.contains(Uri))
+            gHotReload.mGraph.AddDependency(Node, Uri);
+    }
+}
+
+void ScatterSceneLights(uint32_t Count)
+{
+    // Bounds are in asset space, the forward vertex shader swaps y and z
+    glm::vec3 Min = { Bl.x, Bl.z, Bl.y };
+    glm::vec3 Max = { Tr.x, Tr.z, Tr.y };
+    SceneRes.mLights = ScatterLocalLights(Count, Min, Max, 1337);
+}
+
+// Requests texture detail from how many pixels each mesh covers, assuming its UVs span the texture once
+void UpdateTextureStreaming(const Scene& Render, uint64_t Frame)
+{
+    const Camera& Cam = SceneRes.mSceneCamera;
+    float PixelsPerUnit = gFrameGraph.mRenderHeight / (2.0f * std::tan(Cam.FieldOfView * 0.5f));
+
+    for (const Mesh& StreamedMesh : Render.mMeshes)
+    {
+        if (StreamedMesh.mMaterialIndex >= Render.mMaterials.size())
+            continue;
+
+        const Material& Mat = Render.mMaterials[StreamedMesh.mMaterialIndex];
+        if (Mat.AlbedoTexture == INVALID_STREAMED_TEXTURE)
+            continue;
+
+        glm::vec3 Center = (StreamedMesh.mBoundsMin + StreamedMesh.mBoundsMax) * 0.5f;
+        float Radius = glm::length(StreamedMesh.mBoundsMax - StreamedMesh.mBoundsMin) * 0.5f;
+        float Distance = std::max(glm::length(Center - Cam.Position) - Radius, Cam.NearClip);
+
+        gTextureStreamer.RequestResolution(Mat.AlbedoTexture, 2.0f * Radius / Distance * PixelsPerUnit, Frame);
+    }
+
+    gTextureStreamer.Update(Frame);
+}
+
+void BuildForwardDraws(Scene& Render)
+{
+    Camera& Cam = SceneRes.mSceneCamera;
+
+    glm::mat4 Transform, ViewMatrix;
+    CreateCameraMatrices(Cam, Transform, ViewMatrix);
+
+    DrawView View;
+    View.ViewProjection = MultiplyMatrix(CreateCameraProjection(Cam), ViewMatrix);
+    View.Eye = Cam.Position;
+    View.NearClip = Cam.NearClip;
+    View.PixelsPerUnit = gFrameGraph.mRenderHeight / (2.0f * std::tan(Cam.FieldOfView * 0.5f));
+
+    for (DrawSource& Source : Render.mDrawSources)
+        Source.Lods[0].MinScreenSize = gMinDrawScreenSize;
+
+    gForwardDraws.Build(Render.mDrawSources, FORWARD_PIPELINE_COUNT, View, gJobs);
+}
+
+// Where the memory report button writes to, next to the log
+std::string gMemoryReportPath = "MemoryReport.json";
+
+// Where captures are written to and replayed from, next to the log
+std::string gCapturePath = "Capture.rcap";
+
+// Frames to capture when the capture button is pressed, and replays waiting for the next frame boundary
+int gCaptureFrames = 1;
+uint32_t gPendingReplayIterations = 0;
+CaptureReplayStats gLastReplay;
+
+// Replays a capture on the render API in place of a frame of the app. Captured objects are matched to this session's
+// by name and vertex buffers are recreated from their captured contents, so the scene the capture was taken in isn't
+// needed, only a build with the same pipelines and frame graph. Frames are begun at Width x Height.
+bool ReplayOnRenderAPI(const RenderCapture& Capture, uint32_t Iterations, uint32_t Width, uint32_t Height, CaptureReplayStats& OutStats)
+{
+    std::vector<uint64_t> Keys(Capture.Objects.size());
+
+    CaptureReplayBackend Backend;
+    Backend.mCreateObject = [&Keys](CaptureObject Object, const CaptureObjectInfo& Info, std::span<const uint8_t> Vertices, std::span<const uint8_t> Indices)
+    {
+        if (Info.Kind != CaptureObjectKind::VertexBuffer)
+        {
+            if (gCapture.FindNamedObject(Info.Kind, Info.Label, Keys[Object]))
+                return true;
+
+            GLog->error("Capture replay: no {} named \"{}\"", GetCaptureObjectKindName(Info.Kind), Info.Label);
+            return false;
+        }
+
+        if (Vertices.empty() || Indices.empty())
+        {
+            GLog->error("Capture replay: vertex buffer \"{}\" was captured without its contents", Info.Label);
+            return false;
+        }
+
+        // Like the buffers of a reimported scene, these are never destroyed
+        VertexBufferCreateInfo CreateInfo{};
+        CreateInfo.bCreateIndexBuffer = true;
+        CreateInfo.VertexBufferSize = Vertices.size();
+        CreateInfo.IndexBufferSize = Indices.size();
+        VertexBuffer Buffer = GRenderAPI->CreateVertexBuffer(&CreateInfo);
+        gMemory.TrackGpuAllocation(GpuResourceKind::VertexBuffer, "Capture replay", CreateInfo.VertexBufferSize);
+        gMemory.TrackGpuAllocation(GpuResourceKind::IndexBuffer, "Capture replay", CreateInfo.IndexBufferSize);
+
+        GRenderAPI->UploadVertexBufferData(Buffer, const_cast<uint8_t*>(Vertices.data()), CreateInfo.VertexBufferSize);
+        GRenderAPI->UploadIndexBufferData(Buffer, const_cast<uint8_t*>(Indices.data()), CreateInfo.IndexBufferSize);
+
+        Keys[Object] = GetCaptureKey(Buffer);
+        return true;
+    };
+
+    Backend.mIssue = [&Keys, Width, Height](const CaptureCallArgs& Args)
+    {
+        const uint64_t Key0 = Keys[Args.Objects[0]];
+        const uint64_t Key1 = Args.Objects[1] != INVALID_CAPTURE_OBJECT ? Keys[Args.Objects[1]] : 0;
+        const uint64_t Key2 = Args.Objects[2] != INVALID_CAPTURE_OBJECT ? Keys[Args.Objects[2]] : 0;
+
+        // Pass info is only meaningful to the build that captured it, the pipelines have to match anyway
+        RenderGraphInfo PassInfo{};
+        if (Args.Call == CaptureCall::BeginRenderGraph || Args.Call == CaptureCall::BeginSwapChainRenderGraph)
+            std::memcpy(&PassInfo, Args.Data.data(), std::min(sizeof(PassInfo), Args.Data.size()));
+
+        switch (Args.Call)
+        {
+        case CaptureCall::BeginFrame:
+            GRenderAPI->BeginFrame(FromCaptureKey<SwapChain>(Key0), Globals.mSurface, Width, Height);
+            break;
+        case CaptureCall::EndFrame:
+            GRenderAPI->EndFrame(FromCaptureKey<SwapChain>(Key0), Globals.mSurface, Width, Height);
+            break;
+        case CaptureCall::ResetCommandBuffer:
+            GRenderAPI->Reset(FromCaptureKey<CommandBuffer>(Key0));
+            break;
+        case CaptureCall::BeginCommandBuffer:
+            GRenderAPI->Begin(FromCaptureKey<CommandBuffer>(Key0));
+            break;
+        case CaptureCall::EndCommandBuffer:
+            GRenderAPI->End(FromCaptureKey<CommandBuffer>(Key0));
+            break;
+        case CaptureCall::SubmitCommandBuffer:
+            GRenderAPI->SubmitSwapCommandBuffer(FromCaptureKey<SwapChain>(Key0), FromCaptureKey<CommandBuffer>(Key1));
+            break;
+        case CaptureCall::BeginRenderGraph:
+            GRenderAPI->BeginRenderGraph(FromCaptureKey<CommandBuffer>(Key0), FromCaptureKey<RenderGraph>(Key1), FromCaptureKey<FrameBuffer>(Key2), PassInfo);
+            break;
+        case CaptureCall::BeginSwapChainRenderGraph:
+            GRenderAPI->BeginRenderGraph(FromCaptureKey<CommandBuffer>(Key0), FromCaptureKey<SwapChain>(Key1), PassInfo);
+            break;
+        case CaptureCall::EndRenderGraph:
+            GRenderAPI->EndRenderGraph(FromCaptureKey<CommandBuffer>(Key0));
+            break;
+        case CaptureCall::BindPipeline:
+            GRenderAPI->BindPipeline(FromCaptureKey<CommandBuffer>(Key0), FromCaptureKey<Pipeline>(Key1));
+            break;
+        case CaptureCall::BindResources:
+            GRenderAPI->BindResources(FromCaptureKey<CommandBuffer>(Key0), FromCaptureKey<ResourceSet>(Key1));
+            break;
+        case CaptureCall::SetViewport:
+            GRenderAPI->SetViewport(FromCaptureKey<CommandBuffer>(Key0), Args.Values[0], Args.Values[1], Args.Values[2], Args.Values[3]);
+            break;
+        case CaptureCall::SetScissor:
+            GRenderAPI->SetScissor(FromCaptureKey<CommandBuffer>(Key0), Args.Values[0], Args.Values[1], Args.Values[2], Args.Values[3]);
+            break;
+        case CaptureCall::UpdateUniformBuffer:
+            GRenderAPI->UpdateUniformBuffer(FromCaptureKey<ResourceSet>(Key0), FromCaptureKey<SwapChain>(Key1), Args.Values[0], const_cast<uint8_t*>(Args.Data.data()), Args.Data.size());
+            break;
+        case CaptureCall::UpdateAttachmentResource:
+            GRenderAPI->UpdateAttachmentResource(FromCaptureKey<ResourceSet>(Key0), FromCaptureKey<SwapChain>(Key1), FromCaptureKey<FrameBuffer>(Key2), Args.Values[0], Args.Values[1]);
+            break;
+        case CaptureCall::TransitionAttachment:
+            GRenderAPI->TransitionFrameBufferColorAttachment(FromCaptureKey<CommandBuffer>(Key0), FromCaptureKey<FrameBuffer>(Key1), Args.Values[0],
+                static_cast<AttachmentUsage>(Args.Values[1]), static_cast<AttachmentUsage>(Args.Values[2]));
+            break;
+        case CaptureCall::DrawVertexBufferIndexed:
+            GRenderAPI->DrawVertexBufferIndexed(FromCaptureKey<CommandBuffer>(Key0), FromCaptureKey<VertexBuffer>(Key1), Args.Values[0]);
+            break;
+        default:
+            break;
+        }
+    };
+
+    return ReplayCapture(Capture, Backend, Iterations, OutStats);
+}
+
+void LogCaptureReplay(const char* BackendName, const CaptureReplayStats& Stats)
+{
+    double FrameTotal = 0.0;
+    double FrameMax = 0.0;
+    for (double Seconds : Stats.FrameSeconds)
+    {
+        FrameTotal += Seconds;
+        FrameMax = std::max(FrameMax, Seconds);
+    }
+    double FrameAvg = Stats.FrameSeconds.empty() ? 0.0 : FrameTotal / Stats.FrameSeconds.size();
+
+    GLog->info("Capture replay on {}: {} frames in {:.3f} ms, avg {:.3f} ms, max {:.3f} ms per frame, {:.3f} ms creating objects", BackendName,
+        Stats.FrameSeconds.size(), Stats.TotalSeconds * 1e3, FrameAvg * 1e3, FrameMax * 1e3, Stats.CreateSeconds * 1e3);
+
+    for (uint32_t Call = 0; Call < CAPTURE_CALL_COUNT; Call++)
+    {
+        const CaptureCallTiming& Timing = Stats.Calls[Call];
+        if (Timing.Count == 0)
+            continue;
+
+        GLog->info("  {}: {} calls, avg {:.3f} us, max {:.3f} us, {:.3f} ms total", GetCaptureCallName(static_cast<CaptureCall>(Call)), Timing.Count,
+            Timing.TotalSeconds / Timing.Count * 1e6, Timing.MaxSeconds * 1e6, Timing.TotalSeconds * 1e3);
+    }
+}
+
+void DrawMemoryCounter(const char* Name, const MemoryCounter& Counter)
+{
+    ImGui::Text("%s: %.2f MB (peak %.2f MB), %llu live", Name, Counter.mBytes.load() / (1024.0 * 1024.0), Counter.mPeakBytes.load() / (1024.0 * 1024.0),
+        static_cast<unsigned long long>(Counter.GetLiveCount()));
+}
+
 void DrawImGui()
 {
     static bool WindowOpen = true;
@@ -763,27 +1927,239 @@ void DrawImGui()
             ImGui::Text("Avg: %.2f ms", gMetrics.GetAvgTime("Frame"));
         	ImGui::Text("Min: %.2f ms", gMetrics.GetMinTime("Frame"));
             ImGui::Text("Max: %.2f ms", gMetrics.GetMaxTime("Frame"));
+            ImGui::Text("Render: %.2f ms (avg %.2f ms)", gMetrics.GetLastTime("Render"), gMetrics.GetAvgTime("Render"));
+        }
+
+        if (ImGui::CollapsingHeader("Simulation"))
+        {
+            FixedTimestepSettings& Settings = gSimulation.mTimestep.mSettings;
+            static int RateHz = static_cast<int>(std::round(1.0 / Settings.StepSeconds));
+            if (ImGui::SliderInt("Rate (Hz)", &RateHz, 10, 240))
+                Settings.StepSeconds = 1.0 / RateHz;
+            static int MaxSteps = static_cast<int>(Settings.MaxStepsPerFrame);
+            if (ImGui::SliderInt("Max steps per frame", &MaxSteps, 1, 32))
+                Settings.MaxStepsPerFrame = static_cast<uint32_t>(MaxSteps);
+            ImGui::Checkbox("Lockstep", &Settings.bLockstep);
+
+            ImGui::Text("Steps: %llu (%u last frame)", static_cast<unsigned long long>(gSimulation.mTimestep.mSteps), gSimulation.mTimestep.mLastFrameSteps);
+            ImGui::Text("Interpolation: %.2f", gSimulation.mTimestep.GetAlpha());
+            ImGui::Text("Dropped: %.3f s", gSimulation.mTimestep.mDroppedSeconds);
+            ImGui::Text("Simulation: %.3f ms", gMetrics.GetLastTime("Simulation"));
+        }
+
+        if (ImGui::CollapsingHeader("Lights"))
+        {
+            static int LightCount = 256;
+            if (ImGui::SliderInt("Count", &LightCount, 0, MAX_CLUSTER_LIGHTS))
+                ScatterSceneLights(LightCount);
+
+            ImGui::Text("Binned: %u", SceneRes.mLightClusters.mBinnedLights);
+            ImGui::Text("Indices: %u / %u", SceneRes.mLightClusters.mIndexCount, MAX_CLUSTER_LIGHT_INDICES);
+            ImGui::Text("Dropped: %u", SceneRes.mLightClusters.mDroppedIndices);
+            ImGui::Text("Binning: %.3f ms (avg %.3f ms)", gMetrics.GetLastTime("LightBinning"), gMetrics.GetAvgTime("LightBinning"));
+        }
+
+        if (ImGui::CollapsingHeader("Shadows"))
+        {
+            ImGui::SliderFloat("Distance", &gShadowPass.mCascades.mSettings.MaxDistance, 10.0f, 5000.0f);
+
+            for (uint32_t CascadeIndex = 0; CascadeIndex < SHADOW_CASCADE_COUNT; CascadeIndex++)
+            {
+                const ShadowCascade& Cascade = gShadowPass.mCascades.mCascades[CascadeIndex];
+                ImGui::Text("Cascade %u: %.1f - %.1f, %zu casters, %s", CascadeIndex, Cascade.SplitNear, Cascade.SplitFar, Cascade.Casters.size(), Cascade.bNeedsRedraw ? "redrawn" : "cached");
+            }
+            ImGui::Text("Shadow draws: %u", gShadowPass.mCascades.GetDrawCount());
+            ImGui::Text("Cascade update: %.3f ms", gMetrics.GetLastTime("ShadowCascades"));
+        }
+
+        if (ImGui::CollapsingHeader("Draws"))
+        {
+            ImGui::SliderFloat("Min screen size (px)", &gMinDrawScreenSize, 0.0f, 32.0f);
+
+            ImGui::Text("Drawn: %zu", gForwardDraws.mCommands.size());
+            ImGui::Text("Frustum culled: %u", gForwardDraws.mFrustumCulled);
+            ImGui::Text("Too small: %u", gForwardDraws.mContributionCulled);
+            ImGui::Text("Generation: %.3f ms (avg %.3f ms)", gMetrics.GetLastTime("DrawGeneration"), gMetrics.GetAvgTime("DrawGeneration"));
+        }
+
+        if (ImGui::CollapsingHeader("Dynamic Resolution"))
+        {
+            // Fixed scale only, the controller has nothing to steer on until GPU work can be timed
+            ImGui::SliderFloat("Scale", &gDynamicResolution.mSettings.MaxScale, 0.25f, 1.0f);
+            ImGui::TextDisabled("Automatic scaling needs GPU timestamps, which the render API doesn't expose");
+
+            ImGui::Text("Scale: %.3f (%u x %u)", gDynamicResolution.mScale, gFrameGraph.mRenderWidth, gFrameGraph.mRenderHeight);
+            ImGui::Text("Scale changes: %u", gDynamicResolution.mScaleChanges);
+        }
+
+        if (ImGui::CollapsingHeader("Texture Streaming"))
+        {
+            static float BudgetMB = gTextureStreamer.mSettings.BudgetBytes / (1024.0f * 1024.0f);
+            if (ImGui::SliderFloat("Budget (MB)", &BudgetMB, 16.0f, 4096.0f))
+                gTextureStreamer.mSettings.BudgetBytes = static_cast<uint64_t>(BudgetMB * 1024.0 * 1024.0);
+            ImGui::SliderFloat("Texels per pixel", &gTextureStreamer.mSettings.TexelsPerPixel, 0.25f, 4.0f);
+
+            ImGui::Text("Resident: %.2f MB", gTextureStreamer.mResidentBytes / (1024.0 * 1024.0));
+            ImGui::Text("Textures: %u", gTextureStreamer.GetTextureCount());
+            ImGui::Text("Pending requests: %u", gTextureStreamer.mPendingRequests);
+            ImGui::Text("Uploads: %u, evictions: %u, failed: %u", gTextureStreamer.mUploads, gTextureStreamer.mEvictions, gTextureStreamer.mFailedLoads);
+            ImGui::Text("Read from disk: %.2f MB", gTextureStreamer.mStreamedBytes / (1024.0 * 1024.0));
+            ImGui::Text("Update: %.3f ms", gMetrics.GetLastTime("TextureStreaming"));
+            ImGui::TextDisabled("Streamed textures aren't sampled by the forward pass yet");
+        }
+
+        if (ImGui::CollapsingHeader("Hot Reload"))
+        {
+            ImGui::Text("Reloads: %u", gHotReload.mReloads);
+            ImGui::Text("Last reload: %.2f ms", gHotReload.mLastReloadMs);
+            for (const std::string& Reloaded : gHotReload.mLastReloaded)
+                ImGui::BulletText("%s", Reloaded.c_str());
+        }
+
+        if (ImGui::CollapsingHeader("Memory"))
+        {
+            DrawMemoryCounter("CPU", gMemory.GetCpuTotal());
+            for (uint32_t Category = 0; Category < MEMORY_CATEGORY_COUNT; Category++)
+            {
+                MemoryCategory Tag = static_cast<MemoryCategory>(Category);
+                ImGui::Indent();
+                DrawMemoryCounter(GetMemoryCategoryName(Tag), gMemory.GetCpu(Tag));
+                ImGui::Text("Allocations last frame: %llu (max %llu)", static_cast<unsigned long long>(gMemory.GetFrameAllocations(Tag)),
+                    static_cast<unsigned long long>(gMemory.GetPeakFrameAllocations(Tag)));
+                ImGui::Unindent();
+            }
+
+            DrawMemoryCounter("GPU", gMemory.GetGpuTotal());
+            for (uint32_t Kind = 0; Kind < GPU_RESOURCE_KIND_COUNT; Kind++)
+            {
+                ImGui::Indent();
+                DrawMemoryCounter(GetGpuResourceKindName(static_cast<GpuResourceKind>(Kind)), gMemory.GetGpu(static_cast<GpuResourceKind>(Kind)));
+                ImGui::Unindent();
+            }
+
+            if (ImGui::TreeNode("GPU assets"))
+            {
+                for (const GpuAssetUsage& Usage : gMemory.GetGpuAssets())
+                    ImGui::Text("%.2f MB (peak %.2f MB) %s", Usage.TotalBytes / (1024.0 * 1024.0), Usage.PeakBytes / (1024.0 * 1024.0), Usage.Asset.c_str());
+                ImGui::TreePop();
+            }
+
+            if (ImGui::Button("Write JSON report"))
+            {
+                if (gMemory.WriteJson(gMemoryReportPath))
+                    GLog->info("Wrote memory report to {}", gMemoryReportPath);
+                else
+                    GLog->error("Failed to write memory report to {}", gMemoryReportPath);
+            }
+        }
+
+        if (ImGui::CollapsingHeader("Capture"))
+        {
+            ImGui::SliderInt("Frames", &gCaptureFrames, 1, 120);
+            if (!gCapture.bRetainBufferContents)
+                ImGui::TextDisabled("Run with --capture for captures that replay on the render API");
+            if (gCapture.IsActive())
+                ImGui::Text("Capturing: %u / %d frames", gCapture.mRecordedFrames, gCaptureFrames);
+            else if (ImGui::Button("Capture"))
+                gCapture.Start(static_cast<uint32_t>(gCaptureFrames));
+
+            static int ReplayIterations = 10;
+            ImGui::SliderInt("Replay iterations", &ReplayIterations, 1, 100);
+            if (ImGui::Button("Replay on render API"))
+                gPendingReplayIterations = static_cast<uint32_t>(ReplayIterations);
+
+            ImGui::Text("Last replay: %zu frames in %.3f ms", gLastReplay.FrameSeconds.size(), gLastReplay.TotalSeconds * 1e3);
+            for (uint32_t Call = 0; Call < CAPTURE_CALL_COUNT; Call++)
+            {
+                const CaptureCallTiming& Timing = gLastReplay.Calls[Call];
+                if (Timing.Count > 0)
+                    ImGui::Text("%s: %llu calls, avg %.3f us, max %.3f us", GetCaptureCallName(static_cast<CaptureCall>(Call)), static_cast<unsigned long long>(Timing.Count),
+                        Timing.TotalSeconds / Timing.Count * 1e6, Timing.MaxSeconds * 1e6);
+            }
+        }
+
+        if (ImGui::CollapsingHeader("Frame Graph"))
+        {
+            ImGui::Text("Targets: %u x %u (rendering %u x %u)", gFrameGraph.mTargetWidth, gFrameGraph.mTargetHeight, gFrameGraph.mRenderWidth, gFrameGraph.mRenderHeight);
+            ImGui::Text("Reallocations: %u", gFrameGraph.mReallocations);
+            ImGui::Text("Resizes: %u applied of %u requested", gResize.mApplied, gResize.mRequests);
+            ImGui::Text("Deferred releases: %zu pending, %u done", gDeferredDeletes.GetPendingCount(), gDeferredDeletes.mReleased);
+            const FrameGraph& Graph = gFrameGraph.mGraph;
+            ImGui::Text("Passes: %zu (%u culled)", Graph.GetSchedule().size(), Graph.mCulledPasses);
+            ImGui::Text("Transients: %.2f MB, %.2f MB aliased", Graph.mTransientBytes / (1024.0 * 1024.0), Graph.mAliasedBytes / (1024.0 * 1024.0));
+            ImGui::Text("Physical targets: %zu", gFrameGraph.mTargets.size());
+            ImGui::Text("Compiles: %u", Graph.mCompileCount);
         }
     }
     ImGui::End();
 }
 
-void Tick(float Delta)
+// Camera pose advanced by the fixed step simulation
+struct CameraPose
+{
+    glm::vec3 Position;
+    glm::quat Rotation;
+};
+
+struct SimulationState
+{
+    FixedTimestep mTimestep;
+
+    // The last two simulated states, rendering interpolates between them
+    CameraPose mPrevious;
+    CameraPose mCurrent;
+
+    // Mouse movement since the last step, frames that don't step keep adding to it
+    float mPendingMouseX = 0.0f;
+    float mPendingMouseY = 0.0f;
+
+    void Reset(const Camera& Cam)
+    {
+        mCurrent = { Cam.Position, Cam.Rotation };
+        mPrevious = mCurrent;
+    }
+} gSimulation;
+
+// Derives everything view dependent from the render camera
+void UpdateView()
 {
     glm::mat4 Proj = CreateCameraProjection(SceneRes.mSceneCamera);
-    glm::mat4 Trans = CreateCamTransform(SceneRes.mSceneCamera);
-    glm::mat4 View = CreateViewMatrix(SceneRes.mSceneCamera);
+    glm::mat4 Trans, View;
+    CreateCameraMatrices(SceneRes.mSceneCamera, Trans, View);
 
     SceneRes.mFragmentUniforms.mEye = SceneRes.mSceneCamera.Position;
-	SceneRes.mVertexUniforms.ViewProjectionMatrix = glm::transpose(Proj * View);
+	SceneRes.mVertexUniforms.ViewProjectionMatrix = glm::transpose(MultiplyMatrix(Proj, View));
 
-    glm::vec4 Forward = glm::vec4(0.0f, 0.0f, -1.0f, 0.0f);
-    glm::vec4 Right = glm::vec4(1.0f, 0.0f, 0.0f, 0.0f);
-    glm::vec4 Up = glm::vec4(0.0f, 1.0f, 0.0f, 0.0f);
+    PROFILE_START(LightBinning)
+    SceneRes.UpdateLightClusters(View);
+    PROFILE_END(LightBinning)
+
+    // Direction stores the direction towards the light
+    PROFILE_START(ShadowCascades)
+    gShadowPass.Update(SceneRes.mSceneCamera, Trans, -SceneRes.mFragmentUniforms.mDir.Direction);
+    PROFILE_END(ShadowCascades)
+
+    for (uint32_t CascadeIndex = 0; CascadeIndex < SHADOW_CASCADE_COUNT; CascadeIndex++)
+    {
+        const ShadowCascade& Cascade = gShadowPass.mCascades.mCascades[CascadeIndex];
+        SceneRes.mFragmentUniforms.mCascadeViewProjection[CascadeIndex] = glm::transpose(Cascade.ViewProjection);
+        SceneRes.mFragmentUniforms.mCascadeSplits[CascadeIndex] = Cascade.SplitFar;
+    }
+}
+
+// Advances the simulated camera by one fixed step. Mouse movement is consumed by the first step of a frame.
+void SimulateStep(float StepSeconds)
+{
+    float MouseX = gSimulation.mPendingMouseX, MouseY = gSimulation.mPendingMouseY;
+    gSimulation.mPendingMouseX = 0.0f;
+    gSimulation.mPendingMouseY = 0.0f;
+
+    CameraPose& Pose = gSimulation.mCurrent;
 
-	// Transform forward/right
-    Forward = Trans * Forward;
-    Right = Trans * Right;
+	// Rotate forward/right into the camera's orientation
+    glm::vec4 Forward = glm::vec4(Pose.Rotation * glm::vec3(0.0f, 0.0f, -1.0f), 0.0f);
+    glm::vec4 Right = glm::vec4(Pose.Rotation * glm::vec3(1.0f, 0.0f, 0.0f), 0.0f);
+    glm::vec4 Up = glm::vec4(0.0f, 1.0f, 0.0f, 0.0f);
 
     glm::vec4 Movement{};
     bool Moved = false;
@@ -823,7 +2199,7 @@ void Tick(float Delta)
         glm::vec3 NewForward = Forward, NewRight = Right;
 
 	    // Right mouse
-        float Dx = gInput.mDeltaMouseX, Dy = gInput.mDeltaMouseY;
+        float Dx = MouseX, Dy = MouseY;
         bool Rotated = false;
         if(Dx > 0.0 || Dx < 0.0)
         {
@@ -840,20 +2216,55 @@ void Tick(float Delta)
 
         if(Rotated)
         {
-            SceneRes.mSceneCamera.Rotation = glm::quatLookAt(glm::normalize(NewForward), glm::vec3(Up.x, Up.y, Up.z));
+            Pose.Rotation = glm::quatLookAt(glm::normalize(NewForward), glm::vec3(Up.x, Up.y, Up.z));
         }
     }
 
     if(Moved)
     {
-        glm::vec3 MoveVector = glm::normalize(glm::vec3(Movement.x, Movement.y, Movement.z)) * Delta * 100.0f;
-        SceneRes.mSceneCamera.Position += MoveVector;
+        glm::vec3 MoveVector = glm::normalize(glm::vec3(Movement.x, Movement.y, Movement.z)) * StepSeconds * 100.0f;
+        Pose.Position += MoveVector;
+    }
+}
+
+void Tick(double Delta)
+{
+    gSimulation.mPendingMouseX += gInput.mDeltaMouseX;
+    gSimulation.mPendingMouseY += gInput.mDeltaMouseY;
+
+    PROFILE_START(Simulation)
+    uint32_t Steps = gSimulation.mTimestep.Advance(Delta);
+    for (uint32_t Step = 0; Step < Steps; Step++)
+    {
+        gSimulation.mPrevious = gSimulation.mCurrent;
+        SimulateStep(static_cast<float>(gSimulation.mTimestep.mSettings.StepSeconds));
     }
+    PROFILE_END(Simulation)
+
+    // Rendering sits between the last two simulated states, so motion stays smooth at any frame rate
+    float Alpha = gSimulation.mTimestep.GetAlpha();
+    SceneRes.mSceneCamera.Position = glm::mix(gSimulation.mPrevious.Position, gSimulation.mCurrent.Position, Alpha);
+    SceneRes.mSceneCamera.Rotation = glm::slerp(gSimulation.mPrevious.Rotation, gSimulation.mCurrent.Rotation, Alpha);
+
+    UpdateView();
+}
 
+double GetSeconds()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count() / (double)1e9;
+}
 
+bool HasArg(int ArgC, char** ArgV, const char* Arg)
+{
+    for (int ArgIndex = 1; ArgIndex < ArgC; ArgIndex++)
+    {
+        if (std::strcmp(ArgV[ArgIndex], Arg) == 0)
+            return true;
+    }
+    return false;
 }
 
-int main()
+int main(int ArgC, char** ArgV)
 {
     gInput.mKeyState.fill(false);
     gInput.mMouseState.fill(false);
@@ -861,6 +2272,8 @@ int main()
     std::string ExePath;
     GetExePath(&ExePath);
     std::filesystem::path LogsPath = std::filesystem::path(ExePath).parent_path() / "Log.txt";
+    gMemoryReportPath = (std::filesystem::path(ExePath).parent_path() / "MemoryReport.json").string();
+    gCapturePath = (std::filesystem::path(ExePath).parent_path() / "Capture.rcap").string();
 
     auto FileSink = std::make_shared<spdlog::sinks::basic_file_sink_mt>(LogsPath.string(), true);
     FileSink->set_level(spdlog::level::trace);
@@ -871,6 +2284,97 @@ int main()
     GLog = new spdlog::logger("3D Renderer", spdlog::sinks_init_list{ FileSink, ConsoleSink });
     GLog->set_level(spdlog::level::trace);
 
+    // This thread becomes the job system's main thread
+    gJobs.Start(std::max(std::thread::hardware_concurrency(), 1u) - 1);
+
+    // Headless benchmarks
+    if (HasArg(ArgC, ArgV, "--bench-jobs"))
+    {
+        for (const JobBenchmarkResult& Result : RunJobSystemBenchmarks(gJobs))
+        {
+            GLog->info("{} ({} threads): {:.3f} {}", Result.Name, Result.Threads, Result.Value, Result.Unit);
+        }
+        return 0;
+    }
+
+    if (HasArg(ArgC, ArgV, "--bench-draws"))
+    {
+        for (const IndirectDrawBenchmark& Result : BenchmarkIndirectDraws(gJobs, { 1000, 10000, 100000 }, 200))
+        {
+            GLog->info("Draw generation: {} sources, avg {:.3f} ms, min {:.3f} ms, {} draws", Result.SourceCount, Result.AvgMs, Result.MinMs, Result.DrawCount);
+        }
+        return 0;
+    }
+
+    if (HasArg(ArgC, ArgV, "--bench-lights"))
+    {
+        for (const LightBinningBenchmark& Result : BenchmarkLightBinning(gJobs, { 64, 128, 256, 512, 1024 }, 200))
+        {
+            GLog->info("Light binning: {} lights, avg {:.3f} ms, min {:.3f} ms, {} indices", Result.LightCount, Result.AvgMs, Result.MinMs, Result.IndexCount);
+        }
+        return 0;
+    }
+
+    if (HasArg(ArgC, ArgV, "--bench-math"))
+    {
+        GLog->info("SIMD math: dispatching to {}", GetSimdLevelName(GetSimdLevel()));
+        for (const SimdMathBenchmark& Result : RunSimdMathBenchmarks(100000, 50))
+        {
+            GLog->info("SIMD math: {} ({}), {:.2f} ns per element, {:.2f}x glm", Result.Name, GetSimdLevelName(Result.Level), Result.NsPerElement, Result.Speedup);
+        }
+        return 0;
+    }
+
+    // Bakes the scene's lightmap into the installed content, where the next run picks it up
+    if (HasArg(ArgC, ArgV, "--bake-lightmaps"))
+    {
+        std::string SceneFile = (std::filesystem::path(ExePath).parent_path() / "Content" / "Sponza" / "Sponza.gltf").string();
+        std::vector<BakeMesh> Meshes = LoadBakeMeshes(SceneFile);
+        if (Meshes.empty())
+        {
+            GLog->error("Lightmap bake: failed to load {}", SceneFile);
+            return 1;
+        }
+
+        LightmapBakeSettings Settings;
+        LightmapBakeStats Stats;
+        LightmapAtlas Atlas = BakeLightmaps(Meshes, Settings, gJobs, Stats);
+
+        GLog->info("Lightmap bake: {} triangles, {} BVH nodes, {}x{} atlas at {:.2f} texels per unit, {} texels", Stats.Triangles, Stats.BvhNodes, Atlas.Width, Atlas.Height, Stats.TexelsPerUnit, Stats.CoveredTexels);
+        GLog->info("Lightmap bake: {} rays in {:.2f} s on {} threads, {:.2f} Mrays/s per core, {:.2f} s total", Stats.Rays, Stats.TraceSeconds, Stats.Threads, Stats.RaysPerSecondPerCore / 1e6, Stats.Seconds);
+
+        std::string LightmapFile = GetLightmapPath(SceneFile);
+        if (!WriteLightmap(LightmapFile, Atlas))
+        {
+            GLog->error("Lightmap bake: failed to write {}", LightmapFile);
+            return 1;
+        }
+
+        GLog->info("Lightmap bake: wrote {}", LightmapFile);
+        return 0;
+    }
+
+    // Measures what submitting the last capture costs without a GPU, a window or the scene it was taken in
+    if (HasArg(ArgC, ArgV, "--replay-capture"))
+    {
+        RenderCapture Capture;
+        if (!ReadRenderCapture(gCapturePath, Capture))
+        {
+            GLog->error("Capture replay: failed to read {}", gCapturePath);
+            return 1;
+        }
+
+        CaptureReplayStats Stats;
+        if (!ReplayCapture(Capture, MakeNullReplayBackend(), 100, Stats))
+        {
+            GLog->error("Capture replay: {} is malformed", gCapturePath);
+            return 1;
+        }
+
+        LogCaptureReplay("null backend", Stats);
+        return 0;
+    }
+
     // Initialize windowing
     InitWindowing();
 
@@ -879,6 +2383,9 @@ int main()
     auto ShadersRoot = RootInstall / "Shaders";
     auto ContentRoot = RootInstall / "Content";
     MountDirectory(ShadersRoot.string().c_str(), "Shaders");
+    MountDirectory(ContentRoot.string().c_str(), "Content");
+    gHotReload.Watch(ShadersRoot.string());
+    gHotReload.Watch(ContentRoot.string());
 
     uint32_t FrameWidth = 16 * 50, FrameHeight = 9 * 50;
 
@@ -889,16 +2396,10 @@ int main()
     WindowOptions.bUseDecorations = true;
 
     Globals.mWindow = MakeWindow(WindowOptions);
-    Globals.mWindow->OnWindowResize = [&](uint32_t NewWidth, uint32_t NewHeight)
+    // Resizes only get recorded here, a drag produces far too many of them to recreate on each
+    Globals.mWindow->OnWindowResize = [](uint32_t NewWidth, uint32_t NewHeight)
     {
-        FrameWidth = NewWidth;
-        FrameHeight = NewHeight;
-        GRenderAPI->RecreateSwapChain(Globals.mSwap, Globals.mSurface, NewWidth, NewHeight);
-
-        // Resize framebuffer
-        SceneRes.Resize(NewWidth, NewHeight);
-
-        SceneRes.UpdateCamera();
+        gResize.Request(NewWidth, NewHeight, GetSeconds());
     };
     Globals.mWindow->OnKey = [](uint32_t KeyCode, bool bPressed)
     {
@@ -908,8 +2409,9 @@ int main()
 
     Globals.mWindow->OnMouse = [](float PosX, float PosY)
     {
-        gInput.mDeltaMouseX = PosX - gInput.mMouseX;
-        gInput.mDeltaMouseY = PosY - gInput.mMouseY;
+        // Several moves can arrive in one poll
+        gInput.mDeltaMouseX += PosX - gInput.mMouseX;
+        gInput.mDeltaMouseY += PosY - gInput.mMouseY;
         gInput.mMouseX = PosX;
         gInput.mMouseY = PosY;
     };
@@ -933,17 +2435,48 @@ int main()
     ImGuiContext* Context = InitImGui(Globals.mWindow, Globals.mSwap, { true, true, true });
     ImGui::SetCurrentContext(Context);
 
+    // Buffer contents are copied as buffers are created, so this has to be decided before any are
+    gCapture.bRetainBufferContents = HasArg(ArgC, ArgV, "--capture");
+
     gFinalPass.Init();
+    gShadowPass.Init(Globals.mSwap);
     SceneRes.Init(Globals.mSwap);
+    gFrameGraph.Init(Globals.mSwap);
 
     CommandBuffer FinalPass = GRenderAPI->CreateSwapChainCommandBuffer(Globals.mSwap, true);
+    NameCaptureObject(CaptureObjectKind::SwapChain, Globals.mSwap, "Main");
+    NameCaptureObject(CaptureObjectKind::CommandBuffer, FinalPass, "FinalPass");
+
+    InitTextureStreaming();
 
     // Load the scene
     auto SceneFile = ContentRoot / "Sponza" / "Sponza.gltf";
     Scene NewScene = ImportScene(SceneFile.string());
+    ScatterSceneLights(256);
+    gShadowPass.SetCasters(NewScene);
+
+    // Reloads run at the frame boundary, before anything of the frame is recorded. Replaced pipelines and buffers
+    // are left alone since frames in flight may still use them.
+    TrackPipeline("Pipeline:Forward", ShadersRoot, { "Forward.vert", "Forward.frag" }, []() { SceneRes.CreateForwardPipeline(); });
+    TrackPipeline("Pipeline:Shadow", ShadersRoot, { "Shadow.vert", "Shadow.frag" }, []() { gShadowPass.CreateShadowPipeline(); });
+    TrackPipeline("Pipeline:FinalPass", ShadersRoot, { "FinalPass.vert", "FinalPass.frag" }, []() { gFinalPass.CreateFinalPassPipeline(); });
+
+    TrackSceneFiles("Scene:Sponza", SceneFile.string(), NewScene);
+    gHotReload.mGraph.SetReloader("Scene:Sponza", [&]()
+    {
+        for (const Mesh& Replaced : NewScene.mMeshes)
+            gCapture.ForgetObject(CaptureObjectKind::VertexBuffer, GetCaptureKey(Replaced.mBuffer));
+
+        NewScene = ImportScene(SceneFile.string());
+        gShadowPass.SetCasters(NewScene);
+        TrackSceneFiles("Scene:Sponza", SceneFile.string(), NewScene);
+    });
+
+    gSimulation.mTimestep.mSettings.bLockstep = HasArg(ArgC, ArgV, "--lockstep");
+    gSimulation.Reset(SceneRes.mSceneCamera);
 
-    auto ThisTime = std::chrono::high_resolution_clock::now();
-    auto LastTime = ThisTime;
+    double LastTime = GetSeconds();
+    uint64_t FrameIndex = 0;
 
     while (!ShouldWindowClose(Globals.mWindow))
     {
@@ -951,13 +2484,65 @@ int main()
         gInput.mDeltaMouseY = 0.0;
     	PollWindowEvents();
 
+        // Render API work queued by jobs since last frame
+        gJobs.PumpMainThread();
+
+        // Frame boundary, nothing of this frame has been recorded yet
+        gDeferredDeletes.BeginFrame();
+        gMemory.BeginFrame();
+
+        uint32_t NewWidth, NewHeight;
+        if (gResize.Consume(GetSeconds(), NewWidth, NewHeight))
+        {
+            FrameWidth = NewWidth;
+            FrameHeight = NewHeight;
+            GRenderAPI->RecreateSwapChain(Globals.mSwap, Globals.mSurface, NewWidth, NewHeight);
+
+            // Transient targets are reallocated when the frame graph recompiles, if they outgrew their bucket
+            gFrameGraph.Resize(NewWidth, NewHeight);
+
+            // Times measured at the old size say nothing about the new one
+            gMetrics.ResetRecent("Frame");
+            gMetrics.ResetRecent("Render");
+
+            SceneRes.UpdateCamera();
+        }
+
+        gHotReload.Update(GetSeconds());
+
+        // A replay stands in for this frame, it begins and submits frames of its own
+        if (gPendingReplayIterations > 0)
+        {
+            RenderCapture Capture;
+            if (!ReadRenderCapture(gCapturePath, Capture))
+                GLog->error("Capture replay: failed to read {}", gCapturePath);
+            else if (!ReplayOnRenderAPI(Capture, gPendingReplayIterations, FrameWidth, FrameHeight, gLastReplay))
+                GLog->error("Capture replay: {} can't be replayed on the render API", gCapturePath);
+            else
+                LogCaptureReplay("render API", gLastReplay);
+
+            gPendingReplayIterations = 0;
+
+            // The simulation shouldn't try to catch up on the time the replay took
+            LastTime = GetSeconds();
+            continue;
+        }
+
         // Update
-        ThisTime = std::chrono::high_resolution_clock::now();
-        float Delta = static_cast<float>(std::chrono::duration_cast<std::chrono::nanoseconds>(ThisTime - LastTime).count() / (double)1e9);
+        double ThisTime = GetSeconds();
+        double Delta = ThisTime - LastTime;
         LastTime = ThisTime;
 
         Tick(Delta);
 
+        PROFILE_START(TextureStreaming)
+        UpdateTextureStreaming(NewScene, ++FrameIndex);
+        PROFILE_END(TextureStreaming)
+
+        PROFILE_START(DrawGeneration)
+        BuildForwardDraws(NewScene);
+        PROFILE_END(DrawGeneration)
+
         BeginImGuiFrame();
         {
             DrawImGui();
@@ -967,30 +2552,49 @@ int main()
         uint32_t SwapWidth, SwapHeight;
         GRenderAPI->GetSwapChainSize(Globals.mSwap, SwapWidth, SwapHeight);
 
+        // Nothing measured here follows the render resolution, so the controller is disabled and only applies the fixed
+        // scale. See DynamicResolutionSettings::bEnabled.
+        gDynamicResolution.Update(0.0f, 0);
+
+        uint32_t RenderWidth, RenderHeight;
+        gDynamicResolution.GetRenderExtent(SwapWidth, SwapHeight, RenderWidth, RenderHeight);
+
         PROFILE_START(Frame)
-        GRenderAPI->BeginFrame(Globals.mSwap, Globals.mSurface, FrameWidth, FrameHeight);
+        gCapturedAPI.BeginFrame(Globals.mSwap, Globals.mSurface, FrameWidth, FrameHeight);
         {
-            GRenderAPI->Reset(FinalPass);
-            GRenderAPI->Begin(FinalPass);
+            PROFILE_START(Render)
+            gCapturedAPI.Reset(FinalPass);
+            gCapturedAPI.Begin(FinalPass);
             {
-                RenderScene(FinalPass, NewScene, SwapWidth, SwapHeight);
-
-                gFinalPass.Composite(FinalPass, SceneRes.mForwardFramebuffer, 0, SwapWidth, SwapHeight);
-
-            	RecordImGuiDrawCmds(FinalPass);
+                gFrameGraph.Execute(FinalPass, NewScene, SwapWidth, SwapHeight, RenderWidth, RenderHeight);
             }
-            GRenderAPI->End(FinalPass);
+            gCapturedAPI.End(FinalPass);
 
-            GRenderAPI->SubmitSwapCommandBuffer(Globals.mSwap, FinalPass);
+            gCapturedAPI.SubmitSwapCommandBuffer(Globals.mSwap, FinalPass);
+            PROFILE_END(Render)
         }
-        GRenderAPI->EndFrame(Globals.mSwap, Globals.mSurface, FrameWidth, FrameHeight);
+        gCapturedAPI.EndFrame(Globals.mSwap, Globals.mSurface, FrameWidth, FrameHeight);
         PROFILE_END(Frame)
 
+        RenderCapture Finished;
+        if (gCapture.TakeCapture(Finished))
+        {
+            if (WriteRenderCapture(gCapturePath, Finished))
+                GLog->info("Captured {} frames, {} calls, {:.2f} MB to {}", Finished.Frames, gCapture.mRecordedCalls, Finished.GetSize() / (1024.0 * 1024.0), gCapturePath);
+            else
+                GLog->error("Failed to write capture to {}", gCapturePath);
+        }
+
 
         UpdateImGuiViewports();
     }
 
+    gTextureStreamer.Stop();
+    gDeferredDeletes.Flush();
+
     GRenderAPI->DestroySwapChain(Globals.mSwap);
     GRenderAPI->DestroySurface(Globals.mSurface);
     DestroyWindow(Globals.mWindow);
+
+    gJobs.Stop();
 }
@@ -0,0 +1,193 @@
+#include "CascadedShadows.h"
+#include "glm/gtc/matrix_transform.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+// FNV-1a, used to detect whether a cascade's inputs changed since it was last drawn
+struct CascadeKeyHasher
+{
+    uint64_t Hash = 14695981039346656037ull;
+
+    void Add(const void* Data, size_t Size)
+    {
+        const uint8_t* Bytes = static_cast<const uint8_t*>(Data);
+        for (size_t Byte = 0; Byte < Size; Byte++)
+        {
+            Hash ^= Bytes[Byte];
+            Hash *= 1099511628211ull;
+        }
+    }
+
+    template<typename T>
+    void Add(const T& Value)
+    {
+        Add(&Value, sizeof(T));
+    }
+};
+
+std::array<float, SHADOW_CASCADE_COUNT> ComputeCascadeSplits(float NearClip, float FarClip, float Lambda)
+{
+    std::array<float, SHADOW_CASCADE_COUNT> Splits;
+    for (uint32_t Cascade = 0; Cascade < SHADOW_CASCADE_COUNT; Cascade++)
+    {
+        float Fraction = (Cascade + 1) / static_cast<float>(SHADOW_CASCADE_COUNT);
+        float Log = NearClip * std::pow(FarClip / NearClip, Fraction);
+        float Uniform = NearClip + (FarClip - NearClip) * Fraction;
+        Splits[Cascade] = Lambda * Log + (1.0f - Lambda) * Uniform;
+    }
+
+    return Splits;
+}
+
+glm::mat4 CreateLightRotation(glm::vec3 LightDirection)
+{
+    glm::vec3 Up = std::abs(LightDirection.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+    return glm::lookAt(glm::vec3(0.0f), LightDirection, Up);
+}
+
+glm::vec4 ComputeFrustumSliceSphere(const glm::mat4& CameraTransform, float FieldOfView, float Aspect, float SliceNear, float SliceFar)
+{
+    float TanY = std::tan(FieldOfView * 0.5f);
+    float TanX = TanY * Aspect;
+
+    glm::vec3 Corners[8];
+    uint32_t Corner = 0;
+    for (float Depth : { SliceNear, SliceFar })
+    {
+        for (float SignY : { -1.0f, 1.0f })
+        {
+            for (float SignX : { -1.0f, 1.0f })
+            {
+                glm::vec4 ViewCorner(SignX * TanX * Depth, SignY * TanY * Depth, -Depth, 1.0f);
+                Corners[Corner++] = glm::vec3(CameraTransform * ViewCorner);
+            }
+        }
+    }
+
+    glm::vec3 Center(0.0f);
+    for (const glm::vec3& WorldCorner : Corners)
+        Center += WorldCorner;
+    Center = Center / 8.0f;
+
+    float Radius = 0.0f;
+    for (const glm::vec3& WorldCorner : Corners)
+        Radius = std::max(Radius, glm::length(WorldCorner - Center));
+
+    // The corner distances are rotation invariant, but round anyway so float noise can't change the cascade size
+    Radius = std::ceil(Radius * 16.0f) / 16.0f;
+
+    return glm::vec4(Center, Radius);
+}
+
+float CullShadowCasters(const glm::mat4& LightRotation, glm::vec2 ReceiverMin, glm::vec2 ReceiverMax, float ReceiverNear, float ReceiverFar,
+    const std::vector<ShadowCaster>& Casters, std::vector<uint32_t>& OutCasters)
+{
+    glm::mat3 Rotation(LightRotation);
+    glm::vec3 AbsColumns[3] = { glm::abs(Rotation[0]), glm::abs(Rotation[1]), glm::abs(Rotation[2]) };
+
+    float NearestDepth = ReceiverNear;
+    for (uint32_t CasterIndex = 0; CasterIndex < Casters.size(); CasterIndex++)
+    {
+        const ShadowCaster& Caster = Casters[CasterIndex];
+        glm::vec3 Center = (Caster.BoundsMin + Caster.BoundsMax) * 0.5f;
+        glm::vec3 Extent = (Caster.BoundsMax - Caster.BoundsMin) * 0.5f;
+
+        // Light space AABB of the world space AABB
+        glm::vec3 LightCenter = Rotation * Center;
+        glm::vec3 LightExtent = AbsColumns[0] * Extent.x + AbsColumns[1] * Extent.y + AbsColumns[2] * Extent.z;
+
+        if (LightCenter.x + LightExtent.x < ReceiverMin.x || LightCenter.x - LightExtent.x > ReceiverMax.x)
+            continue;
+        if (LightCenter.y + LightExtent.y < ReceiverMin.y || LightCenter.y - LightExtent.y > ReceiverMax.y)
+            continue;
+
+        // Anything between the light and the far side of the receivers can cast into the cascade, so the caster
+        // volume is only bounded away from the light
+        float CasterNearDepth = -(LightCenter.z + LightExtent.z);
+        if (CasterNearDepth > ReceiverFar)
+            continue;
+
+        NearestDepth = std::min(NearestDepth, CasterNearDepth);
+        OutCasters.push_back(CasterIndex);
+    }
+
+    return NearestDepth;
+}
+
+void CascadedShadowMap::Update(const glm::mat4& CameraTransform, float FieldOfView, float Aspect, float NearClip, float FarClip,
+    glm::vec3 LightDirection, const std::vector<ShadowCaster>& Casters, uint64_t SceneVersion)
+{
+    std::array<float, SHADOW_CASCADE_COUNT> Splits = ComputeCascadeSplits(NearClip, std::min(FarClip, mSettings.MaxDistance), mSettings.SplitLambda);
+    glm::mat4 LightRotation = CreateLightRotation(LightDirection);
+
+    bool bLightChanged = LightDirection != mLightDirection;
+    bool bSceneChanged = SceneVersion != mSceneVersion;
+    mLightDirection = LightDirection;
+    mSceneVersion = SceneVersion;
+
+    mRedrawnCascades = 0;
+    mCachedCascades = 0;
+
+    float SplitNear = NearClip;
+    for (uint32_t CascadeIndex = 0; CascadeIndex < SHADOW_CASCADE_COUNT; CascadeIndex++)
+    {
+        ShadowCascade& Cascade = mCascades[CascadeIndex];
+        Cascade.SplitNear = SplitNear;
+        Cascade.SplitFar = Splits[CascadeIndex];
+        SplitNear = Cascade.SplitFar;
+
+        glm::vec4 Sphere = ComputeFrustumSliceSphere(CameraTransform, FieldOfView, Aspect, Cascade.SplitNear, Cascade.SplitFar);
+        glm::vec3 LightCenter = glm::vec3(LightRotation * glm::vec4(glm::vec3(Sphere), 1.0f));
+        float PaddedRadius = Sphere.w * (1.0f + mSettings.CacheMargin);
+
+        // Keep the old fit for as long as the slice is still inside it
+        bool bRefit = !Cascade.bValid || bLightChanged || PaddedRadius != Cascade.Radius
+            || glm::length(LightCenter - Cascade.LightSpaceCenter) + Sphere.w > Cascade.Radius;
+
+        if (!bRefit && !bSceneChanged)
+        {
+            Cascade.bNeedsRedraw = false;
+            mCachedCascades++;
+            continue;
+        }
+
+        if (bRefit)
+        {
+            // Snap to whole texels so the rasterized caster edges don't crawl when the cascade moves
+            float TexelSize = 2.0f * PaddedRadius / mSettings.Resolution;
+            Cascade.LightSpaceCenter = glm::vec3(std::floor(LightCenter.x / TexelSize) * TexelSize, std::floor(LightCenter.y / TexelSize) * TexelSize, LightCenter.z);
+            Cascade.Radius = PaddedRadius;
+        }
+
+        glm::vec2 ReceiverMin = glm::vec2(Cascade.LightSpaceCenter.x, Cascade.LightSpaceCenter.y) - glm::vec2(Cascade.Radius);
+        glm::vec2 ReceiverMax = glm::vec2(Cascade.LightSpaceCenter.x, Cascade.LightSpaceCenter.y) + glm::vec2(Cascade.Radius);
+        float ReceiverNear = -Cascade.LightSpaceCenter.z - Cascade.Radius;
+        float ReceiverFar = -Cascade.LightSpaceCenter.z + Cascade.Radius;
+
+        Cascade.Casters.clear();
+        Cascade.NearDepth = CullShadowCasters(LightRotation, ReceiverMin, ReceiverMax, ReceiverNear, ReceiverFar, Casters, Cascade.Casters);
+        Cascade.FarDepth = ReceiverFar;
+
+        glm::mat4 Projection = glm::ortho(ReceiverMin.x, ReceiverMax.x, ReceiverMin.y, ReceiverMax.y, Cascade.NearDepth, Cascade.FarDepth);
+        Cascade.ViewProjection = Projection * LightRotation;
+
+        CascadeKeyHasher Key;
+        Key.Add(LightDirection);
+        Key.Add(Cascade.LightSpaceCenter);
+        Key.Add(Cascade.Radius);
+        Key.Add(Cascade.NearDepth);
+        Key.Add(SceneVersion);
+        Key.Add(Cascade.Casters.data(), Cascade.Casters.size() * sizeof(uint32_t));
+
+        Cascade.bNeedsRedraw = !Cascade.bValid || Key.Hash != Cascade.CacheKey;
+        Cascade.CacheKey = Key.Hash;
+        Cascade.bValid = true;
+
+        if (Cascade.bNeedsRedraw)
+            mRedrawnCascades++;
+        else
+            mCachedCascades++;
+    }
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include "glm/glm.hpp"
+#include <array>
+#include <cstdint>
+#include <vector>
+
+// Must match the cascade count in Forward.frag.hlsl
+constexpr uint32_t SHADOW_CASCADE_COUNT = 4;
+
+struct ShadowCaster
+{
+    glm::vec3 BoundsMin;
+    glm::vec3 BoundsMax;
+};
+
+struct CascadeSettings
+{
+    uint32_t Resolution = 2048;
+
+    // Shadows are only rendered up to this view depth, regardless of the camera far clip
+    float MaxDistance = 1000.0f;
+
+    // Blend between logarithmic (1) and uniform (0) split placement
+    float SplitLambda = 0.75f;
+
+    // Cascades are fit with this much slack so they can stay put (and cached) while the camera moves a little
+    float CacheMargin = 0.15f;
+};
+
+struct ShadowCascade
+{
+    // Light space, column major, ready for the shadow pass
+    glm::mat4 ViewProjection{1.0f};
+
+    // View depth range this cascade is responsible for
+    float SplitNear = 0.0f;
+    float SplitFar = 0.0f;
+
+    // Light space sphere the cascade was last fit to, center is texel snapped
+    glm::vec3 LightSpaceCenter{};
+    float Radius = 0.0f;
+    float NearDepth = 0.0f;
+    float FarDepth = 0.0f;
+
+    // Indices into the caster list that intersect this cascade, one draw each
+    std::vector<uint32_t> Casters;
+
+    uint64_t CacheKey = 0;
+    bool bValid = false;
+    bool bNeedsRedraw = true;
+};
+
+// Fits stable cascades around the camera frustum and culls casters per cascade, all on the CPU.
+struct CascadedShadowMap
+{
+    CascadeSettings mSettings;
+    std::array<ShadowCascade, SHADOW_CASCADE_COUNT> mCascades;
+
+    // Stats from the last update
+    uint32_t mRedrawnCascades = 0;
+    uint32_t mCachedCascades = 0;
+
+    // CameraTransform is the camera's world transform. LightDirection is the direction light travels in.
+    // SceneVersion must change whenever caster geometry changes, so cached cascades get redrawn.
+    void Update(const glm::mat4& CameraTransform, float FieldOfView, float Aspect, float NearClip, float FarClip,
+        glm::vec3 LightDirection, const std::vector<ShadowCaster>& Casters, uint64_t SceneVersion);
+
+    // Forces every cascade to be redrawn, for instance when the shadow maps were recreated
+    void Invalidate()
+    {
+        for (ShadowCascade& Cascade : mCascades)
+            Cascade.bValid = false;
+    }
+
+    uint32_t GetDrawCount() const
+    {
+        uint32_t Draws = 0;
+        for (const ShadowCascade& Cascade : mCascades)
+            Draws += Cascade.bNeedsRedraw ? static_cast<uint32_t>(Cascade.Casters.size()) : 0;
+        return Draws;
+    }
+
+private:
+
+    glm::vec3 mLightDirection{};
+    uint64_t mSceneVersion = 0;
+};
+
+// Practical split scheme, returns the far depth of each cascade
+std::array<float, SHADOW_CASCADE_COUNT> ComputeCascadeSplits(float NearClip, float FarClip, float Lambda);
+
+// Rotation only view matrix looking down LightDirection
+glm::mat4 CreateLightRotation(glm::vec3 LightDirection);
+
+// Bounding sphere (xyz center, w radius) of the view frustum slice between two view depths, in world space.
+// The radius is rounded up so it doesn't flicker as the camera rotates.
+glm::vec4 ComputeFrustumSliceSphere(const glm::mat4& CameraTransform, float FieldOfView, float Aspect, float SliceNear, float SliceFar);
+
+// Appends every caster whose light space bounds, extruded towards the light, touch the receiver box. Returns the
+// nearest light depth of any accepted caster, or ReceiverNear if none are closer.
+float CullShadowCasters(const glm::mat4& LightRotation, glm::vec2 ReceiverMin, glm::vec2 ReceiverMax, float ReceiverNear, float ReceiverFar,
+    const std::vector<ShadowCaster>& Casters, std::vector<uint32_t>& OutCasters);
@@ -0,0 +1,309 @@
+#include "ClusteredLighting.h"
+#include "JobSystem.h"
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <random>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CLUSTER_USE_SSE 1
+#include <emmintrin.h>
+#else
+#define CLUSTER_USE_SSE 0
+#endif
+
+// Position used for the padding lanes of the SoA arrays, far enough away to never touch a cluster
+constexpr float PADDING_POSITION = 1e18f;
+
+// Calls Emit for every sphere in [0, Count) that overlaps the box. Count must be a multiple of four.
+template<typename EmitFunc>
+static void CullSpheresAgainstBox(const float* X, const float* Y, const float* Z, const float* R, uint32_t Count, glm::vec3 Min, glm::vec3 Max, EmitFunc&& Emit)
+{
+#if CLUSTER_USE_SSE
+    const __m128 MinX = _mm_set1_ps(Min.x), MinY = _mm_set1_ps(Min.y), MinZ = _mm_set1_ps(Min.z);
+    const __m128 MaxX = _mm_set1_ps(Max.x), MaxY = _mm_set1_ps(Max.y), MaxZ = _mm_set1_ps(Max.z);
+    const __m128 Zero = _mm_setzero_ps();
+
+    for (uint32_t Base = 0; Base < Count; Base += 4)
+    {
+        __m128 Cx = _mm_loadu_ps(X + Base);
+        __m128 Cy = _mm_loadu_ps(Y + Base);
+        __m128 Cz = _mm_loadu_ps(Z + Base);
+        __m128 Rad = _mm_loadu_ps(R + Base);
+
+        // Distance from the sphere center to the closest point on the box, per axis
+        __m128 Dx = _mm_add_ps(_mm_max_ps(_mm_sub_ps(MinX, Cx), Zero), _mm_max_ps(_mm_sub_ps(Cx, MaxX), Zero));
+        __m128 Dy = _mm_add_ps(_mm_max_ps(_mm_sub_ps(MinY, Cy), Zero), _mm_max_ps(_mm_sub_ps(Cy, MaxY), Zero));
+        __m128 Dz = _mm_add_ps(_mm_max_ps(_mm_sub_ps(MinZ, Cz), Zero), _mm_max_ps(_mm_sub_ps(Cz, MaxZ), Zero));
+        __m128 DistSq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(Dx, Dx), _mm_mul_ps(Dy, Dy)), _mm_mul_ps(Dz, Dz));
+
+        uint32_t Mask = static_cast<uint32_t>(_mm_movemask_ps(_mm_cmple_ps(DistSq, _mm_mul_ps(Rad, Rad))));
+        while (Mask)
+        {
+            Emit(Base + std::countr_zero(Mask));
+            Mask &= Mask - 1;
+        }
+    }
+#else
+    for (uint32_t Index = 0; Index < Count; Index++)
+    {
+        float Dx = std::max(Min.x - X[Index], 0.0f) + std::max(X[Index] - Max.x, 0.0f);
+        float Dy = std::max(Min.y - Y[Index], 0.0f) + std::max(Y[Index] - Max.y, 0.0f);
+        float Dz = std::max(Min.z - Z[Index], 0.0f) + std::max(Z[Index] - Max.z, 0.0f);
+        if (Dx * Dx + Dy * Dy + Dz * Dz <= R[Index] * R[Index])
+            Emit(Index);
+    }
+#endif
+}
+
+static uint32_t PadToSimdWidth(uint32_t Count)
+{
+    return (Count + 3) & ~3u;
+}
+
+void LightClusterBuilder::RebuildClusterBounds(const ClusterFrustum& Frustum)
+{
+    mBoundsFrustum = Frustum;
+
+    float TanY = std::tan(Frustum.FieldOfView * 0.5f);
+    float TanX = TanY * Frustum.Aspect;
+    float DepthRatio = Frustum.FarClip / Frustum.NearClip;
+
+    for (uint32_t Slice = 0; Slice < CLUSTER_SLICES; Slice++)
+    {
+        float Near = Frustum.NearClip * std::pow(DepthRatio, Slice / static_cast<float>(CLUSTER_SLICES));
+        float Far = Frustum.NearClip * std::pow(DepthRatio, (Slice + 1) / static_cast<float>(CLUSTER_SLICES));
+
+        for (uint32_t Row = 0; Row < CLUSTER_TILES_Y; Row++)
+        {
+            float NdcY0 = -1.0f + 2.0f * Row / CLUSTER_TILES_Y;
+            float NdcY1 = -1.0f + 2.0f * (Row + 1) / CLUSTER_TILES_Y;
+
+            for (uint32_t Col = 0; Col < CLUSTER_TILES_X; Col++)
+            {
+                float NdcX0 = -1.0f + 2.0f * Col / CLUSTER_TILES_X;
+                float NdcX1 = -1.0f + 2.0f * (Col + 1) / CLUSTER_TILES_X;
+
+                // The tile's side planes pass through the eye, so the extremes are at either the near or far depth
+                float Xs[] = { NdcX0 * TanX * Near, NdcX0 * TanX * Far, NdcX1 * TanX * Near, NdcX1 * TanX * Far };
+                float Ys[] = { NdcY0 * TanY * Near, NdcY0 * TanY * Far, NdcY1 * TanY * Near, NdcY1 * TanY * Far };
+
+                uint32_t Cluster = Col + (Row + Slice * CLUSTER_TILES_Y) * CLUSTER_TILES_X;
+                mClusterMin[Cluster] = { *std::min_element(std::begin(Xs), std::end(Xs)), *std::min_element(std::begin(Ys), std::end(Ys)), Near };
+                mClusterMax[Cluster] = { *std::max_element(std::begin(Xs), std::end(Xs)), *std::max_element(std::begin(Ys), std::end(Ys)), Far };
+            }
+        }
+    }
+
+    float LogRatio = std::log(DepthRatio);
+    mParams.Dims = { CLUSTER_TILES_X, CLUSTER_TILES_Y, CLUSTER_SLICES, 0 };
+    mParams.SliceScale = CLUSTER_SLICES / LogRatio;
+    mParams.SliceBias = -(CLUSTER_SLICES * std::log(Frustum.NearClip)) / LogRatio;
+}
+
+void LightClusterBuilder::Build(const std::vector<LocalLight>& Lights, const glm::mat4& View, const ClusterFrustum& Frustum, JobSystem& Jobs)
+{
+    if (!(Frustum == mBoundsFrustum))
+        RebuildClusterBounds(Frustum);
+
+    mLightCount = static_cast<uint32_t>(std::min<size_t>(Lights.size(), MAX_CLUSTER_LIGHTS));
+    uint32_t PaddedCount = PadToSimdWidth(mLightCount);
+    mLightX.assign(PaddedCount, PADDING_POSITION);
+    mLightY.assign(PaddedCount, PADDING_POSITION);
+    mLightZ.assign(PaddedCount, PADDING_POSITION);
+    mLightR.assign(PaddedCount, 0.0f);
+
+    for (uint32_t LightIndex = 0; LightIndex < mLightCount; LightIndex++)
+    {
+        const LocalLight& Light = Lights[LightIndex];
+        GPULocalLight& Gpu = mLightUniforms.Lights[LightIndex];
+
+        glm::vec3 BoundsCenter = Light.Position;
+        float BoundsRadius = Light.Radius;
+
+        if (Light.Type == LocalLightType::Spot)
+        {
+            float Outer = std::clamp(Light.OuterConeAngle, 0.0f, glm::radians(89.0f));
+            float CosOuter = std::cos(Outer);
+            float CosInner = std::max(std::cos(std::min(Light.InnerConeAngle, Outer)), CosOuter + 1e-4f);
+
+            // Tightest sphere around the cone and its spherical cap
+            if (Outer > glm::radians(45.0f))
+            {
+                BoundsCenter = Light.Position + Light.Direction * (Light.Radius * CosOuter);
+                BoundsRadius = Light.Radius * std::sin(Outer);
+            }
+            else
+            {
+                BoundsRadius = Light.Radius / (2.0f * CosOuter);
+                BoundsCenter = Light.Position + Light.Direction * BoundsRadius;
+            }
+
+            Gpu.ColorInnerCone = glm::vec4(Light.Color, CosInner);
+            Gpu.DirectionOuterCone = glm::vec4(Light.Direction, CosOuter);
+        }
+        else
+        {
+            // A cone that never cuts off
+            Gpu.ColorInnerCone = glm::vec4(Light.Color, -1.0f);
+            Gpu.DirectionOuterCone = glm::vec4(0.0f, 0.0f, 0.0f, -2.0f);
+        }
+        Gpu.PositionRadius = glm::vec4(Light.Position, Light.Radius);
+
+        glm::vec4 ViewCenter = View * glm::vec4(BoundsCenter, 1.0f);
+        mLightX[LightIndex] = ViewCenter.x;
+        mLightY[LightIndex] = ViewCenter.y;
+        mLightZ[LightIndex] = -ViewCenter.z;
+        mLightR[LightIndex] = BoundsRadius;
+    }
+
+    mParams.Dims.w = mLightCount;
+
+    mRows.resize(CLUSTER_SLICES * CLUSTER_TILES_Y);
+    Jobs.ParallelFor(CLUSTER_SLICES * CLUSTER_TILES_Y, 1, [this](uint32_t RowIndex)
+    {
+        BinRow(RowIndex / CLUSTER_TILES_Y, RowIndex % CLUSTER_TILES_Y);
+    });
+
+    // Stitch the per row lists into one compact list, in cluster order
+    uint32_t Offset = 0;
+    mDroppedIndices = 0;
+    for (uint32_t RowIndex = 0; RowIndex < mRows.size(); RowIndex++)
+    {
+        const RowScratch& Scratch = mRows[RowIndex];
+        uint32_t Cursor = 0;
+
+        for (uint32_t Col = 0; Col < CLUSTER_TILES_X; Col++)
+        {
+            uint32_t Count = Scratch.Counts[Col];
+            uint32_t Kept = std::min(Count, MAX_CLUSTER_LIGHT_INDICES - Offset);
+
+            for (uint32_t Local = 0; Local < Kept; Local++)
+            {
+                uint32_t Slot = Offset + Local;
+                uint32_t LightIndex = Scratch.Indices[Cursor + Local];
+                if (Slot & 1)
+                    mIndexUniforms.PackedIndices[Slot >> 1] |= LightIndex << 16;
+                else
+                    mIndexUniforms.PackedIndices[Slot >> 1] = LightIndex;
+            }
+
+            mGridUniforms.Ranges[Col + RowIndex * CLUSTER_TILES_X] = (Offset << 16) | Kept;
+            Offset += Kept;
+            Cursor += Count;
+            mDroppedIndices += Count - Kept;
+        }
+    }
+
+    mBinnedLights = mLightCount;
+    mIndexCount = Offset;
+}
+
+void LightClusterBuilder::BinRow(uint32_t Slice, uint32_t Row)
+{
+    RowScratch& Scratch = mRows[Row + Slice * CLUSTER_TILES_Y];
+    Scratch.Candidates.clear();
+    Scratch.Indices.clear();
+    Scratch.Counts.fill(0);
+
+    uint32_t FirstCluster = (Row + Slice * CLUSTER_TILES_Y) * CLUSTER_TILES_X;
+    glm::vec3 RowMin = mClusterMin[FirstCluster];
+    glm::vec3 RowMax = mClusterMax[FirstCluster];
+    for (uint32_t Col = 1; Col < CLUSTER_TILES_X; Col++)
+    {
+        RowMin = glm::min(RowMin, mClusterMin[FirstCluster + Col]);
+        RowMax = glm::max(RowMax, mClusterMax[FirstCluster + Col]);
+    }
+
+    // Coarse pass against the whole row to cut down on the per cluster tests
+    CullSpheresAgainstBox(mLightX.data(), mLightY.data(), mLightZ.data(), mLightR.data(), static_cast<uint32_t>(mLightX.size()), RowMin, RowMax, [&](uint32_t LightIndex)
+    {
+        Scratch.Candidates.push_back(LightIndex);
+    });
+
+    if (Scratch.Candidates.empty())
+        return;
+
+    uint32_t PaddedCount = PadToSimdWidth(static_cast<uint32_t>(Scratch.Candidates.size()));
+    Scratch.CandX.assign(PaddedCount, PADDING_POSITION);
+    Scratch.CandY.assign(PaddedCount, PADDING_POSITION);
+    Scratch.CandZ.assign(PaddedCount, PADDING_POSITION);
+    Scratch.CandR.assign(PaddedCount, 0.0f);
+    for (uint32_t Candidate = 0; Candidate < Scratch.Candidates.size(); Candidate++)
+    {
+        uint32_t LightIndex = Scratch.Candidates[Candidate];
+        Scratch.CandX[Candidate] = mLightX[LightIndex];
+        Scratch.CandY[Candidate] = mLightY[LightIndex];
+        Scratch.CandZ[Candidate] = mLightZ[LightIndex];
+        Scratch.CandR[Candidate] = mLightR[LightIndex];
+    }
+
+    for (uint32_t Col = 0; Col < CLUSTER_TILES_X; Col++)
+    {
+        size_t Before = Scratch.Indices.size();
+        CullSpheresAgainstBox(Scratch.CandX.data(), Scratch.CandY.data(), Scratch.CandZ.data(), Scratch.CandR.data(), PaddedCount, mClusterMin[FirstCluster + Col], mClusterMax[FirstCluster + Col], [&](uint32_t Candidate)
+        {
+            Scratch.Indices.push_back(static_cast<uint16_t>(Scratch.Candidates[Candidate]));
+        });
+        Scratch.Counts[Col] = static_cast<uint32_t>(Scratch.Indices.size() - Before);
+    }
+}
+
+std::vector<LocalLight> ScatterLocalLights(uint32_t Count, glm::vec3 Min, glm::vec3 Max, uint32_t Seed)
+{
+    std::mt19937 Rng(Seed);
+    std::uniform_real_distribution<float> Unit(0.0f, 1.0f);
+
+    float Extent = glm::length(Max - Min);
+    std::vector<LocalLight> Lights(Count);
+    for (LocalLight& Light : Lights)
+    {
+        Light.Position = Min + (Max - Min) * glm::vec3(Unit(Rng), Unit(Rng), Unit(Rng));
+        Light.Color = glm::vec3(0.2f + 0.8f * Unit(Rng), 0.2f + 0.8f * Unit(Rng), 0.2f + 0.8f * Unit(Rng));
+        Light.Radius = Extent * (0.02f + 0.04f * Unit(Rng));
+
+        // One in four lights is a downward facing spot
+        if (Unit(Rng) < 0.25f)
+        {
+            Light.Type = LocalLightType::Spot;
+            Light.Direction = glm::normalize(glm::vec3(Unit(Rng) - 0.5f, -1.0f, Unit(Rng) - 0.5f));
+            Light.OuterConeAngle = glm::radians(20.0f + 30.0f * Unit(Rng));
+            Light.InnerConeAngle = Light.OuterConeAngle * 0.7f;
+        }
+    }
+
+    return Lights;
+}
+
+std::vector<LightBinningBenchmark> BenchmarkLightBinning(JobSystem& Jobs, const std::vector<uint32_t>& LightCounts, uint32_t Iterations)
+{
+    ClusterFrustum Frustum{ glm::radians(75.0f), 16.0f / 9.0f, 0.1f, 5000.0f };
+    glm::mat4 View(1.0f);
+
+    std::vector<LightBinningBenchmark> Results;
+    for (uint32_t LightCount : LightCounts)
+    {
+        // Lights fill the first hundred units in front of a camera at the origin
+        std::vector<LocalLight> Lights = ScatterLocalLights(LightCount, { -60.0f, -30.0f, -100.0f }, { 60.0f, 30.0f, -1.0f }, 1337);
+
+        LightClusterBuilder Builder;
+        Builder.Build(Lights, View, Frustum, Jobs); // Warm up the scratch allocations
+
+        double Total = 0.0, Min = std::numeric_limits<double>::max();
+        for (uint32_t Iteration = 0; Iteration < Iterations; Iteration++)
+        {
+            auto Start = std::chrono::high_resolution_clock::now();
+            Builder.Build(Lights, View, Frustum, Jobs);
+            double Ms = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now() - Start).count() / 1e6;
+
+            Total += Ms;
+            Min = std::min(Min, Ms);
+        }
+
+        Results.push_back({ Builder.mBinnedLights, Total / Iterations, Min, Builder.mIndexCount });
+    }
+
+    return Results;
+}
@@ -0,0 +1,145 @@
+#pragma once
+
+#include "glm/glm.hpp"
+#include <array>
+#include <cstdint>
+#include <vector>
+
+struct JobSystem;
+
+// Froxel grid dimensions. These must match the defines at the top of Forward.frag.hlsl.
+constexpr uint32_t CLUSTER_TILES_X = 16;
+constexpr uint32_t CLUSTER_TILES_Y = 9;
+constexpr uint32_t CLUSTER_SLICES = 24;
+constexpr uint32_t CLUSTER_COUNT = CLUSTER_TILES_X * CLUSTER_TILES_Y * CLUSTER_SLICES;
+
+// Upper bounds dictated by the 64KB constant buffer limit
+constexpr uint32_t MAX_CLUSTER_LIGHTS = 1024;
+constexpr uint32_t MAX_CLUSTER_LIGHT_INDICES = 16384;
+
+static_assert(CLUSTER_COUNT % 4 == 0, "Cluster ranges are uploaded as uint4s");
+static_assert(MAX_CLUSTER_LIGHT_INDICES <= 0xFFFF, "Cluster offsets are packed into 16 bits");
+
+enum class LocalLightType : uint32_t
+{
+    Point,
+    Spot
+};
+
+struct LocalLight
+{
+    LocalLightType Type = LocalLightType::Point;
+
+    glm::vec3 Position{};
+    glm::vec3 Color{1.0f};
+    float Radius = 1.0f;
+
+    // Spot lights only, cone angles are half angles in radians
+    glm::vec3 Direction{0.0f, -1.0f, 0.0f};
+    float InnerConeAngle = 0.0f;
+    float OuterConeAngle = 0.0f;
+};
+
+// Layout matches LocalLight in Forward.frag.hlsl. Point lights are encoded as spot lights whose cone never cuts off.
+struct GPULocalLight
+{
+    glm::vec4 PositionRadius;
+    glm::vec4 ColorInnerCone;
+    glm::vec4 DirectionOuterCone;
+};
+
+struct ClusterShadingParams
+{
+    glm::uvec4 Dims; // Tiles x, tiles y, slices, light count
+    float SliceScale;
+    float SliceBias;
+};
+
+struct ClusterLightUniforms
+{
+    GPULocalLight Lights[MAX_CLUSTER_LIGHTS];
+};
+
+struct ClusterGridUniforms
+{
+    // (Offset << 16) | Count into the light index list
+    uint32_t Ranges[CLUSTER_COUNT];
+};
+
+struct ClusterIndexUniforms
+{
+    // Two 16 bit light indices per uint
+    uint32_t PackedIndices[MAX_CLUSTER_LIGHT_INDICES / 2];
+};
+
+struct ClusterFrustum
+{
+    float FieldOfView = 0.0f;
+    float Aspect = 0.0f;
+    float NearClip = 0.0f;
+    float FarClip = 0.0f;
+
+    bool operator==(const ClusterFrustum& Other) const = default;
+};
+
+// Bins local lights into an exponentially sliced froxel grid. Each (slice, row) of the grid is one unit of work on
+// the job system; the per-row results are stitched together into compact index lists afterwards.
+struct LightClusterBuilder
+{
+    ClusterShadingParams mParams{};
+    ClusterLightUniforms mLightUniforms{};
+    ClusterGridUniforms mGridUniforms{};
+    ClusterIndexUniforms mIndexUniforms{};
+
+    // Stats from the last build
+    uint32_t mBinnedLights = 0;
+    uint32_t mIndexCount = 0;
+    uint32_t mDroppedIndices = 0;
+
+    void Build(const std::vector<LocalLight>& Lights, const glm::mat4& View, const ClusterFrustum& Frustum, JobSystem& Jobs);
+
+    // Number of lights touching a cluster, for debug visualization
+    uint32_t GetClusterLightCount(uint32_t X, uint32_t Y, uint32_t Z) const
+    {
+        return mGridUniforms.Ranges[X + (Y + Z * CLUSTER_TILES_Y) * CLUSTER_TILES_X] & 0xFFFF;
+    }
+
+private:
+
+    struct RowScratch
+    {
+        std::vector<uint32_t> Candidates;
+        std::vector<float> CandX, CandY, CandZ, CandR;
+        std::vector<uint16_t> Indices;
+        std::array<uint32_t, CLUSTER_TILES_X> Counts;
+    };
+
+    void RebuildClusterBounds(const ClusterFrustum& Frustum);
+    void BinRow(uint32_t Slice, uint32_t Row);
+
+    ClusterFrustum mBoundsFrustum{};
+
+    // View space cluster AABBs, depth is positive along the view direction
+    std::array<glm::vec3, CLUSTER_COUNT> mClusterMin;
+    std::array<glm::vec3, CLUSTER_COUNT> mClusterMax;
+
+    // View space light bounding spheres in SoA form, padded to a multiple of four
+    std::vector<float> mLightX, mLightY, mLightZ, mLightR;
+    uint32_t mLightCount = 0;
+
+    std::vector<RowScratch> mRows;
+};
+
+// Deterministically scatters point and spot lights through a box
+std::vector<LocalLight> ScatterLocalLights(uint32_t Count, glm::vec3 Min, glm::vec3 Max, uint32_t Seed);
+
+struct LightBinningBenchmark
+{
+    uint32_t LightCount;
+    double AvgMs;
+    double MinMs;
+    uint32_t IndexCount;
+};
+
+// Times LightClusterBuilder::Build against an increasing number of lights without touching the GPU
+std::vector<LightBinningBenchmark> BenchmarkLightBinning(JobSystem& Jobs, const std::vector<uint32_t>& LightCounts, uint32_t Iterations);
@@ -0,0 +1,72 @@
+#include "DeferredResize.h"
+#include <algorithm>
+
+void ResizeCoalescer::Request(uint32_t Width, uint32_t Height, double Now)
+{
+    if (!bPending)
+        mFirstRequest = Now;
+
+    bPending = true;
+    mWidth = Width;
+    mHeight = Height;
+    mLastRequest = Now;
+    mRequests++;
+}
+
+bool ResizeCoalescer::Consume(double Now, uint32_t& OutWidth, uint32_t& OutHeight)
+{
+    if (!bPending)
+        return false;
+
+    // Minimized, nothing to render into until the window comes back
+    if (mWidth == 0 || mHeight == 0)
+        return false;
+
+    bool bSettled = Now - mLastRequest >= mSettleSeconds;
+    bool bOverdue = Now - mFirstRequest >= mMaxDelaySeconds;
+    if (!bSettled && !bOverdue)
+        return false;
+
+    OutWidth = mWidth;
+    OutHeight = mHeight;
+    bPending = false;
+    mApplied++;
+
+    return true;
+}
+
+void DeferredDeletionQueue::Enqueue(std::function<void()> Release)
+{
+    mPending.push_back({ mFrame, std::move(Release) });
+}
+
+void DeferredDeletionQueue::BeginFrame()
+{
+    mFrame++;
+
+    while (!mPending.empty() && mPending.front().Frame + FRAMES_IN_FLIGHT <= mFrame)
+    {
+        mPending.front().Release();
+        mPending.pop_front();
+        mReleased++;
+    }
+}
+
+void DeferredDeletionQueue::Flush()
+{
+    while (!mPending.empty())
+    {
+        mPending.front().Release();
+        mPending.pop_front();
+        mReleased++;
+    }
+}
+
+uint32_t ChooseTargetSize(uint32_t Current, uint32_t Required)
+{
+    Required = std::max(Required, 1u);
+    if (Required <= Current && Required * 2 > Current)
+        return Current;
+
+    return (Required + TARGET_SIZE_BUCKET - 1) / TARGET_SIZE_BUCKET * TARGET_SIZE_BUCKET;
+}
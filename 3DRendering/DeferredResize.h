@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+
+// Collapses a burst of window resizes into a single recreate. A resize is applied once the size has been stable for
+// SettleSeconds, or at the latest MaxDelaySeconds after the burst started so a long drag still updates now and then.
+struct ResizeCoalescer
+{
+    double mSettleSeconds = 0.05;
+    double mMaxDelaySeconds = 0.25;
+
+    // Stats
+    uint32_t mRequests = 0;
+    uint32_t mApplied = 0;
+
+    void Request(uint32_t Width, uint32_t Height, double Now);
+
+    // Called at a frame boundary, returns true with the size to recreate at if a resize is due
+    bool Consume(double Now, uint32_t& OutWidth, uint32_t& OutHeight);
+
+    bool IsPending() const
+    {
+        return bPending;
+    }
+
+private:
+
+    bool bPending = false;
+    uint32_t mWidth = 0;
+    uint32_t mHeight = 0;
+    double mFirstRequest = 0.0;
+    double mLastRequest = 0.0;
+};
+
+// Holds on to GPU resources that were replaced while frames using them may still be in flight
+struct DeferredDeletionQueue
+{
+    // Conservative, the swapchain may have this many frames queued
+    static constexpr uint32_t FRAMES_IN_FLIGHT = 3;
+
+    // Release runs once every frame that could reference the resource has retired
+    void Enqueue(std::function<void()> Release);
+
+    // Advances to the next frame and releases whatever has retired
+    void BeginFrame();
+
+    // Releases everything regardless of age, only safe once the device is idle
+    void Flush();
+
+    size_t GetPendingCount() const
+    {
+        return mPending.size();
+    }
+
+    uint32_t mReleased = 0;
+
+private:
+
+    struct PendingRelease
+    {
+        uint64_t Frame;
+        std::function<void()> Release;
+    };
+
+    uint64_t mFrame = 0;
+    std::deque<PendingRelease> mPending;
+};
+
+// Granularity render targets are over allocated to
+constexpr uint32_t TARGET_SIZE_BUCKET = 128;
+
+// Size to allocate along one axis. The current allocation is kept as long as Required fits and doesn't waste more
+// than half of it, otherwise Required is rounded up to the next bucket.
+uint32_t ChooseTargetSize(uint32_t Current, uint32_t Required);
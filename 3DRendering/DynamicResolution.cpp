@@ -0,0 +1,47 @@
+#include "DynamicResolution.h"
+#include <algorithm>
+#include <cmath>
+
+bool DynamicResolutionController::Update(float PercentileMs, uint32_t SampleCount)
+{
+    float MinScale = std::clamp(mSettings.MinScale, SCALE_GRANULARITY, 1.0f);
+    float MaxScale = std::clamp(mSettings.MaxScale, MinScale, 1.0f);
+
+    float NewScale = mScale;
+    if (!mSettings.bEnabled)
+    {
+        NewScale = MaxScale;
+    }
+    else if (SampleCount >= mSettings.SettleFrames && PercentileMs > 0.0f)
+    {
+        mLastPercentileMs = PercentileMs;
+
+        if (PercentileMs > mSettings.TargetFrameMs)
+        {
+            // Cost roughly follows pixel count, which is quadratic in scale
+            NewScale = mScale * std::sqrt(mSettings.TargetFrameMs / PercentileMs);
+            NewScale = std::floor(NewScale / SCALE_GRANULARITY) * SCALE_GRANULARITY;
+        }
+        else if (PercentileMs < mSettings.TargetFrameMs * mSettings.Headroom)
+        {
+            float Ideal = mScale * std::sqrt(mSettings.TargetFrameMs * mSettings.Headroom / PercentileMs);
+            NewScale = std::min(Ideal, mScale + mSettings.MaxStepUp);
+            NewScale = std::floor(NewScale / SCALE_GRANULARITY) * SCALE_GRANULARITY;
+        }
+    }
+
+    NewScale = std::clamp(NewScale, MinScale, MaxScale);
+    if (std::abs(NewScale - mScale) < SCALE_GRANULARITY * 0.5f)
+        return false;
+
+    mScale = NewScale;
+    mScaleChanges++;
+
+    return true;
+}
+
+void DynamicResolutionController::GetRenderExtent(uint32_t TargetWidth, uint32_t TargetHeight, uint32_t& OutWidth, uint32_t& OutHeight) const
+{
+    OutWidth = std::clamp(static_cast<uint32_t>(std::lround(TargetWidth * mScale)), 1u, std::max(TargetWidth, 1u));
+    OutHeight = std::clamp(static_cast<uint32_t>(std::lround(TargetHeight * mScale)), 1u, std::max(TargetHeight, 1u));
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+
+struct DynamicResolutionSettings
+{
+    // Off until the render API can time GPU work. Recording and submit time don't change with resolution, and under
+    // vsync the frame time sits at the refresh interval whatever the load, so steering on either moves the scale the
+    // wrong way. While disabled the scale stays at MaxScale.
+    bool bEnabled = false;
+
+    // Fraction of the swapchain resolution, along each axis
+    float MinScale = 0.5f;
+    float MaxScale = 1.0f;
+
+    // Budget for the GPU time of the frame's render work
+    float TargetFrameMs = 1000.0f / 60.0f;
+
+    // GPU time percentile the controller steers, high enough that spikes count
+    float Percentile = 0.9f;
+
+    // Scale only goes back up once the percentile is this far under budget, so it doesn't oscillate around the target
+    float Headroom = 0.85f;
+    float MaxStepUp = 0.05f;
+
+    // Frames that have to be measured at a scale before it is adjusted again
+    uint32_t SettleFrames = 30;
+};
+
+// Steers the forward render scale so a GPU time percentile stays under budget. Render targets stay allocated at
+// full size, only the rendered region shrinks, so changing scale never allocates.
+struct DynamicResolutionController
+{
+    // Scale changes snap to this so tiny corrections don't produce a new resolution every few frames
+    static constexpr float SCALE_GRANULARITY = 1.0f / 64.0f;
+
+    DynamicResolutionSettings mSettings;
+    float mScale = 1.0f;
+
+    // Stats from the last update
+    float mLastPercentileMs = 0.0f;
+    uint32_t mScaleChanges = 0;
+
+    // PercentileMs is measured over SampleCount frames that were all rendered at the current scale. Returns true if
+    // the scale changed, in which case the caller should start a fresh measurement window.
+    bool Update(float PercentileMs, uint32_t SampleCount);
+
+    // Rendered extent within a target of the given size, never zero
+    void GetRenderExtent(uint32_t TargetWidth, uint32_t TargetHeight, uint32_t& OutWidth, uint32_t& OutHeight) const;
+};
@@ -0,0 +1,147 @@
+#include "FileWatcher.h"
+
+#if defined(__linux__)
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+std::string NormalizePath(const std::filesystem::path& Path)
+{
+    std::error_code Error;
+    std::filesystem::path Canonical = std::filesystem::weakly_canonical(Path, Error);
+    return (Error ? Path.lexically_normal() : Canonical).string();
+}
+
+bool FileWatcher::Watch(const std::string& Directory)
+{
+    std::error_code Error;
+    if (!std::filesystem::is_directory(Directory, Error))
+        return false;
+
+    std::filesystem::path Root = NormalizePath(Directory);
+    mRoots.push_back(Root);
+
+#if defined(__linux__)
+    if (mInotify < 0)
+        mInotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+
+    if (mInotify >= 0)
+    {
+        // inotify isn't recursive, every directory needs its own watch
+        bool bWatched = AddWatch(Root.string());
+        for (const auto& Entry : std::filesystem::recursive_directory_iterator(Root, Error))
+        {
+            if (Entry.is_directory(Error))
+                bWatched &= AddWatch(NormalizePath(Entry.path()));
+        }
+        return bWatched;
+    }
+#endif
+
+    Scan(Root, nullptr);
+    return true;
+}
+
+#if defined(__linux__)
+bool FileWatcher::AddWatch(const std::string& Directory)
+{
+    int Watch = inotify_add_watch(mInotify, Directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_DELETE_SELF);
+    if (Watch < 0)
+        return false;
+
+    mWatchDirectories[Watch] = Directory;
+    return true;
+}
+#endif
+
+void FileWatcher::Poll(double Now, std::vector<std::string>& OutChanged)
+{
+#if defined(__linux__)
+    if (mInotify >= 0)
+    {
+        alignas(inotify_event) char Buffer[16 * 1024];
+        while (true)
+        {
+            ssize_t Read = read(mInotify, Buffer, sizeof(Buffer));
+            if (Read <= 0)
+                break;
+
+            for (char* Cursor = Buffer; Cursor < Buffer + Read; )
+            {
+                const inotify_event* Event = reinterpret_cast<const inotify_event*>(Cursor);
+                Cursor += sizeof(inotify_event) + Event->len;
+
+                auto Found = mWatchDirectories.find(Event->wd);
+                if (Found == mWatchDirectories.end())
+                    continue;
+
+                if (Event->mask & (IN_DELETE_SELF | IN_IGNORED))
+                {
+                    mWatchDirectories.erase(Found);
+                    continue;
+                }
+
+                if (Event->len == 0)
+                    continue;
+
+                std::filesystem::path Changed = std::filesystem::path(Found->second) / Event->name;
+                if (Event->mask & IN_ISDIR)
+                {
+                    // New directories start being watched, files already written into them are missed
+                    if (Event->mask & (IN_CREATE | IN_MOVED_TO))
+                        AddWatch(NormalizePath(Changed));
+                    continue;
+                }
+
+                // Creation alone isn't a finished write, IN_CLOSE_WRITE follows it
+                if (Event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO))
+                    OutChanged.push_back(NormalizePath(Changed));
+            }
+        }
+        return;
+    }
+#endif
+
+    if (Now - mLastScan < mScanInterval)
+        return;
+    mLastScan = Now;
+
+    for (const std::filesystem::path& Root : mRoots)
+        Scan(Root, &OutChanged);
+}
+
+void FileWatcher::Scan(const std::filesystem::path& Root, std::vector<std::string>* OutChanged)
+{
+    std::error_code Error;
+    for (const auto& Entry : std::filesystem::recursive_directory_iterator(Root, Error))
+    {
+        if (!Entry.is_regular_file(Error))
+            continue;
+
+        std::string Path = NormalizePath(Entry.path());
+        std::filesystem::file_time_type WriteTime = Entry.last_write_time(Error);
+
+        auto Found = mWriteTimes.find(Path);
+        if (Found == mWriteTimes.end())
+        {
+            mWriteTimes.emplace(Path, WriteTime);
+            if (OutChanged)
+                OutChanged->push_back(Path);
+        }
+        else if (Found->second != WriteTime)
+        {
+            Found->second = WriteTime;
+            if (OutChanged)
+                OutChanged->push_back(Path);
+        }
+    }
+}
+
+FileWatcher::~FileWatcher()
+{
+#if defined(__linux__)
+    if (mInotify >= 0)
+        close(mInotify);
+#endif
+}
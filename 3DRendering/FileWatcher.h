@@ -0,0 +1,40 @@
+#pragma once
+
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Reports files that changed under a set of directories. Uses inotify on Linux and falls back to comparing write
+// times elsewhere, which is throttled since it has to walk the whole tree.
+struct FileWatcher
+{
+    // Seconds between scans of the write time fallback
+    double mScanInterval = 1.0;
+
+    // Watches Directory and everything below it
+    bool Watch(const std::string& Directory);
+
+    // Appends the normalized path of every file written since the last poll. Never blocks.
+    void Poll(double Now, std::vector<std::string>& OutChanged);
+
+    ~FileWatcher();
+
+private:
+
+    void Scan(const std::filesystem::path& Root, std::vector<std::string>* OutChanged);
+
+#if defined(__linux__)
+    bool AddWatch(const std::string& Directory);
+
+    int mInotify = -1;
+    std::unordered_map<int, std::string> mWatchDirectories;
+#endif
+
+    std::vector<std::filesystem::path> mRoots;
+    std::unordered_map<std::string, std::filesystem::file_time_type> mWriteTimes;
+    double mLastScan = 0.0;
+};
+
+// Canonical form paths are compared in, the file doesn't have to exist
+std::string NormalizePath(const std::filesystem::path& Path);
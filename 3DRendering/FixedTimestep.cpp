@@ -0,0 +1,46 @@
+#include "FixedTimestep.h"
+#include <algorithm>
+#include <cmath>
+
+uint32_t FixedTimestep::Advance(double FrameSeconds)
+{
+    double Step = std::max(mSettings.StepSeconds, 1e-6);
+
+    if (mSettings.bLockstep)
+    {
+        mAccumulator = 0.0;
+        mLastFrameSteps = 1;
+        mSteps++;
+        return 1;
+    }
+
+    mAccumulator += std::max(FrameSeconds, 0.0);
+
+    // Floor with a little slack, so step sized frames don't lose a step to rounding
+    double Available = std::floor(mAccumulator / Step + 1e-9);
+    uint32_t Steps = static_cast<uint32_t>(std::min(Available, static_cast<double>(mSettings.MaxStepsPerFrame)));
+
+    mAccumulator = std::max(mAccumulator - Steps * Step, 0.0);
+
+    // Behind by more than the clamp allows, keep only the fraction of a step that rendering interpolates over
+    if (mAccumulator >= Step)
+    {
+        double Kept = std::fmod(mAccumulator, Step);
+        mDroppedSeconds += mAccumulator - Kept;
+        mAccumulator = Kept;
+    }
+
+    mLastFrameSteps = Steps;
+    mSteps += Steps;
+    return Steps;
+}
+
+float FixedTimestep::GetAlpha() const
+{
+    // Nothing is left over in lockstep, the current state is exactly where rendering is
+    if (mSettings.bLockstep)
+        return 1.0f;
+
+    double Step = std::max(mSettings.StepSeconds, 1e-6);
+    return static_cast<float>(std::clamp(mAccumulator / Step, 0.0, 1.0));
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+
+struct FixedTimestepSettings
+{
+    double StepSeconds = 1.0 / 60.0;
+
+    // Steps a single frame may run. When simulating falls behind further than this, the extra time is dropped
+    // instead of spiraling into ever longer frames.
+    uint32_t MaxStepsPerFrame = 8;
+
+    // Every frame advances exactly one step, whatever the wall clock says, so frame N always sees the same
+    // simulation state. For benchmark runs.
+    bool bLockstep = false;
+};
+
+// Accumulates real frame time and hands it out as whole simulation steps. The remainder is what rendering
+// interpolates over, between the two most recent simulation states.
+struct FixedTimestep
+{
+    FixedTimestepSettings mSettings;
+
+    // Stats
+    uint64_t mSteps = 0;
+    uint32_t mLastFrameSteps = 0;
+    double mDroppedSeconds = 0.0;
+
+    // Adds a frame's duration and returns how many steps to run for it
+    uint32_t Advance(double FrameSeconds);
+
+    // How far rendering is between the previous and the current simulation state, in [0, 1]
+    float GetAlpha() const;
+
+    double GetAccumulator() const
+    {
+        return mAccumulator;
+    }
+
+private:
+
+    double mAccumulator = 0.0;
+};
@@ -0,0 +1,264 @@
+#include "FrameGraph.h"
+#include <algorithm>
+
+FrameGraphResource FrameGraph::CreateTexture(std::string Name, FrameGraphTextureDesc Desc)
+{
+    ResourceNode& NewResource = mResources.emplace_back();
+    NewResource.Name = std::move(Name);
+    NewResource.Desc = Desc;
+    bDirty = true;
+
+    return static_cast<FrameGraphResource>(mResources.size() - 1);
+}
+
+FrameGraphResource FrameGraph::ImportTexture(std::string Name, FrameGraphState InitialState, FrameGraphState FinalState)
+{
+    ResourceNode& NewResource = mResources.emplace_back();
+    NewResource.Name = std::move(Name);
+    NewResource.bImported = true;
+    NewResource.InitialState = InitialState;
+    NewResource.FinalState = FinalState;
+    bDirty = true;
+
+    return static_cast<FrameGraphResource>(mResources.size() - 1);
+}
+
+uint32_t FrameGraph::AddPass(std::string Name, std::function<void()> Execute, bool bHasSideEffects)
+{
+    PassNode& NewPass = mPasses.emplace_back();
+    NewPass.Name = std::move(Name);
+    NewPass.Execute = std::move(Execute);
+    NewPass.bHasSideEffects = bHasSideEffects;
+    bDirty = true;
+
+    return static_cast<uint32_t>(mPasses.size() - 1);
+}
+
+void FrameGraph::Read(uint32_t Pass, FrameGraphResource Resource, FrameGraphState State)
+{
+    mPasses[Pass].ReadResources.push_back(Resource);
+    mPasses[Pass].ReadStates.push_back(State);
+    bDirty = true;
+}
+
+void FrameGraph::Write(uint32_t Pass, FrameGraphResource Resource, FrameGraphState State)
+{
+    mPasses[Pass].WriteResources.push_back(Resource);
+    mPasses[Pass].WriteStates.push_back(State);
+    bDirty = true;
+}
+
+void FrameGraph::SetTextureDesc(FrameGraphResource Resource, FrameGraphTextureDesc Desc)
+{
+    if (mResources[Resource].Desc == Desc)
+        return;
+
+    mResources[Resource].Desc = Desc;
+    bDirty = true;
+}
+
+bool FrameGraph::Compile()
+{
+    if (!bDirty)
+        return false;
+
+    Cull();
+    AssignPhysicalSlots();
+    BuildBarriers();
+
+    mCompileCount++;
+    bDirty = false;
+
+    return true;
+}
+
+void FrameGraph::Cull()
+{
+    for (ResourceNode& Resource : mResources)
+    {
+        // Imported resources with a final state are read by whatever comes after the frame
+        Resource.RefCount = (Resource.bImported && Resource.FinalState != FrameGraphState::Undefined) ? 1 : 0;
+    }
+
+    for (PassNode& Pass : mPasses)
+    {
+        Pass.RefCount = static_cast<uint32_t>(Pass.WriteResources.size());
+
+        // Passes that write nothing at all can only matter through side effects. Their reads aren't counted, so
+        // whatever only feeds them is released by the walk below like any other unread resource.
+        Pass.bCulled = Pass.RefCount == 0 && !Pass.bHasSideEffects;
+        if (Pass.bCulled)
+            continue;
+
+        for (FrameGraphResource Read : Pass.ReadResources)
+            mResources[Read].RefCount++;
+    }
+
+    // Walk back from every resource nobody reads, releasing the passes that only produce unread resources
+    std::vector<FrameGraphResource> Unreferenced;
+    for (FrameGraphResource Resource = 0; Resource < mResources.size(); Resource++)
+    {
+        if (mResources[Resource].RefCount == 0)
+            Unreferenced.push_back(Resource);
+    }
+
+    while (!Unreferenced.empty())
+    {
+        FrameGraphResource Resource = Unreferenced.back();
+        Unreferenced.pop_back();
+
+        for (PassNode& Pass : mPasses)
+        {
+            if (Pass.bHasSideEffects || Pass.RefCount == 0)
+                continue;
+
+            uint32_t Writes = static_cast<uint32_t>(std::count(Pass.WriteResources.begin(), Pass.WriteResources.end(), Resource));
+            if (Writes == 0)
+                continue;
+
+            Pass.RefCount -= Writes;
+            if (Pass.RefCount > 0)
+                continue;
+
+            Pass.bCulled = true;
+            for (FrameGraphResource Read : Pass.ReadResources)
+            {
+                if (--mResources[Read].RefCount == 0)
+                    Unreferenced.push_back(Read);
+            }
+        }
+    }
+
+    mCulledPasses = 0;
+    for (const PassNode& Pass : mPasses)
+        mCulledPasses += Pass.bCulled ? 1 : 0;
+}
+
+void FrameGraph::AssignPhysicalSlots()
+{
+    for (ResourceNode& Resource : mResources)
+    {
+        Resource.FirstUse = ~0u;
+        Resource.LastUse = 0;
+        Resource.PhysicalSlot = ~0u;
+    }
+
+    // Passes run in declaration order, so lifetimes are just the first and last live pass touching a resource
+    for (uint32_t PassIndex = 0; PassIndex < mPasses.size(); PassIndex++)
+    {
+        const PassNode& Pass = mPasses[PassIndex];
+        if (Pass.bCulled)
+            continue;
+
+        auto Touch = [&](FrameGraphResource Resource)
+        {
+            ResourceNode& Node = mResources[Resource];
+            Node.FirstUse = std::min(Node.FirstUse, PassIndex);
+            Node.LastUse = std::max(Node.LastUse, PassIndex);
+        };
+
+        for (FrameGraphResource Read : Pass.ReadResources)
+            Touch(Read);
+        for (FrameGraphResource Write : Pass.WriteResources)
+            Touch(Write);
+    }
+
+    std::vector<FrameGraphResource> Transients;
+    for (FrameGraphResource Resource = 0; Resource < mResources.size(); Resource++)
+    {
+        if (!mResources[Resource].bImported && mResources[Resource].FirstUse != ~0u)
+            Transients.push_back(Resource);
+    }
+
+    std::stable_sort(Transients.begin(), Transients.end(), [this](FrameGraphResource A, FrameGraphResource B)
+    {
+        return mResources[A].FirstUse < mResources[B].FirstUse;
+    });
+
+    // Greedy interval packing. A slot is reused once its previous owner's last use is behind us and the descriptor
+    // matches, since the render API can only alias whole attachments rather than placing them in a heap.
+    mPhysicalSlots.clear();
+    mTransientBytes = 0;
+    mAliasedBytes = 0;
+
+    for (FrameGraphResource Resource : Transients)
+    {
+        ResourceNode& Node = mResources[Resource];
+        mTransientBytes += Node.Desc.GetSize();
+
+        for (uint32_t Slot = 0; Slot < mPhysicalSlots.size(); Slot++)
+        {
+            if (mPhysicalSlots[Slot].LastUse < Node.FirstUse && mPhysicalSlots[Slot].Desc == Node.Desc)
+            {
+                Node.PhysicalSlot = Slot;
+                mPhysicalSlots[Slot].LastUse = Node.LastUse;
+                break;
+            }
+        }
+
+        if (Node.PhysicalSlot == ~0u)
+        {
+            Node.PhysicalSlot = static_cast<uint32_t>(mPhysicalSlots.size());
+            mPhysicalSlots.push_back({Node.Desc, Node.LastUse});
+            mAliasedBytes += Node.Desc.GetSize();
+        }
+    }
+}
+
+void FrameGraph::BuildBarriers()
+{
+    // Transients start every frame undefined, their contents are never carried over
+    std::vector<FrameGraphState> States(mResources.size());
+    for (FrameGraphResource Resource = 0; Resource < mResources.size(); Resource++)
+        States[Resource] = mResources[Resource].bImported ? mResources[Resource].InitialState : FrameGraphState::Undefined;
+
+    mSchedule.clear();
+    for (uint32_t PassIndex = 0; PassIndex < mPasses.size(); PassIndex++)
+    {
+        const PassNode& Pass = mPasses[PassIndex];
+        if (Pass.bCulled)
+            continue;
+
+        FrameGraphCompiledPass& Compiled = mSchedule.emplace_back();
+        Compiled.Pass = PassIndex;
+
+        auto Require = [&](FrameGraphResource Resource, FrameGraphState State)
+        {
+            if (States[Resource] != State)
+            {
+                Compiled.Barriers.push_back({Resource, States[Resource], State});
+                States[Resource] = State;
+            }
+        };
+
+        for (size_t Read = 0; Read < Pass.ReadResources.size(); Read++)
+            Require(Pass.ReadResources[Read], Pass.ReadStates[Read]);
+        for (size_t Write = 0; Write < Pass.WriteResources.size(); Write++)
+            Require(Pass.WriteResources[Write], Pass.WriteStates[Write]);
+    }
+
+    mFinalBarriers.clear();
+    for (FrameGraphResource Resource = 0; Resource < mResources.size(); Resource++)
+    {
+        const ResourceNode& Node = mResources[Resource];
+        if (Node.bImported && Node.FinalState != FrameGraphState::Undefined && States[Resource] != Node.FinalState)
+            mFinalBarriers.push_back({Resource, States[Resource], Node.FinalState});
+    }
+}
+
+void FrameGraph::Execute(const std::function<void(const FrameGraphBarrier&)>& ApplyBarrier)
+{
+    Compile();
+
+    for (const FrameGraphCompiledPass& Compiled : mSchedule)
+    {
+        for (const FrameGraphBarrier& Barrier : Compiled.Barriers)
+            ApplyBarrier(Barrier);
+
+        if (mPasses[Compiled.Pass].Execute)
+            mPasses[Compiled.Pass].Execute();
+    }
+
+    for (const FrameGraphBarrier& Barrier : mFinalBarriers)
+        ApplyBarrier(Barrier);
+}
@@ -0,0 +1,185 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// The engine's RenderGraph is a single render pass object. FrameGraph sits above it and wires a whole frame together
+// from passes that declare what they read and write.
+
+using FrameGraphResource = uint32_t;
+constexpr FrameGraphResource INVALID_FRAME_GRAPH_RESOURCE = ~0u;
+
+enum class FrameGraphState : uint8_t
+{
+    Undefined,
+    ColorAttachment,
+    DepthStencilAttachment,
+    ShaderRead
+};
+
+struct FrameGraphTextureDesc
+{
+    uint32_t Width = 0;
+    uint32_t Height = 0;
+
+    // Opaque to the graph, transients only alias when their formats match
+    uint32_t Format = 0;
+    uint32_t BytesPerPixel = 4;
+
+    bool operator==(const FrameGraphTextureDesc& Other) const = default;
+
+    uint64_t GetSize() const
+    {
+        return static_cast<uint64_t>(Width) * Height * BytesPerPixel;
+    }
+};
+
+struct FrameGraphBarrier
+{
+    FrameGraphResource Resource;
+    FrameGraphState Before;
+    FrameGraphState After;
+};
+
+struct FrameGraphCompiledPass
+{
+    uint32_t Pass;
+
+    // Transitions to issue before the pass runs
+    std::vector<FrameGraphBarrier> Barriers;
+};
+
+struct FrameGraph
+{
+    // Transient textures only exist for the part of the frame between their first and last use
+    FrameGraphResource CreateTexture(std::string Name, FrameGraphTextureDesc Desc);
+
+    // Imported textures live outside the graph, FinalState is where the graph leaves them at the end of the frame.
+    // Anything imported with a final state is considered read after the frame, so its writers are never culled.
+    FrameGraphResource ImportTexture(std::string Name, FrameGraphState InitialState, FrameGraphState FinalState);
+
+    uint32_t AddPass(std::string Name, std::function<void()> Execute, bool bHasSideEffects = false);
+    void Read(uint32_t Pass, FrameGraphResource Resource, FrameGraphState State = FrameGraphState::ShaderRead);
+    void Write(uint32_t Pass, FrameGraphResource Resource, FrameGraphState State);
+
+    // Changing a transient's size or format invalidates the compiled graph, typically on resize
+    void SetTextureDesc(FrameGraphResource Resource, FrameGraphTextureDesc Desc);
+
+    // Culls, orders, aliases and computes barriers. Does nothing if the graph hasn't changed since the last compile.
+    // Returns true if a recompile happened, in which case physical resources need to be realized again.
+    bool Compile();
+
+    // Runs every live pass in order. ApplyBarrier is handed each transition right before the pass that needs it, and
+    // the final transitions of imported resources once all passes ran.
+    void Execute(const std::function<void(const FrameGraphBarrier&)>& ApplyBarrier);
+
+    bool IsPassCulled(uint32_t Pass) const
+    {
+        return mPasses[Pass].bCulled;
+    }
+
+    uint32_t GetResourceCount() const
+    {
+        return static_cast<uint32_t>(mResources.size());
+    }
+
+    bool IsTransient(FrameGraphResource Resource) const
+    {
+        return !mResources[Resource].bImported;
+    }
+
+    const FrameGraphTextureDesc& GetTextureDesc(FrameGraphResource Resource) const
+    {
+        return mResources[Resource].Desc;
+    }
+
+    const std::string& GetName(FrameGraphResource Resource) const
+    {
+        return mResources[Resource].Name;
+    }
+
+    // Physical slot a transient is aliased into, transients sharing a slot share memory
+    uint32_t GetPhysicalSlot(FrameGraphResource Resource) const
+    {
+        return mResources[Resource].PhysicalSlot;
+    }
+
+    uint32_t GetPhysicalSlotCount() const
+    {
+        return static_cast<uint32_t>(mPhysicalSlots.size());
+    }
+
+    const FrameGraphTextureDesc& GetPhysicalSlotDesc(uint32_t Slot) const
+    {
+        return mPhysicalSlots[Slot].Desc;
+    }
+
+    const std::vector<FrameGraphResource>& GetPassWrites(uint32_t Pass) const
+    {
+        return mPasses[Pass].WriteResources;
+    }
+
+    const std::vector<FrameGraphCompiledPass>& GetSchedule() const
+    {
+        return mSchedule;
+    }
+
+    // Memory for every transient with and without aliasing, from the last compile
+    uint64_t mTransientBytes = 0;
+    uint64_t mAliasedBytes = 0;
+    uint32_t mCulledPasses = 0;
+    uint32_t mCompileCount = 0;
+
+private:
+
+    struct ResourceNode
+    {
+        std::string Name;
+        FrameGraphTextureDesc Desc;
+        bool bImported = false;
+        FrameGraphState InitialState = FrameGraphState::Undefined;
+        FrameGraphState FinalState = FrameGraphState::Undefined;
+
+        // Compile results
+        uint32_t RefCount = 0;
+        uint32_t FirstUse = ~0u;
+        uint32_t LastUse = 0;
+        uint32_t PhysicalSlot = ~0u;
+    };
+
+    struct PassNode
+    {
+        std::string Name;
+        std::function<void()> Execute;
+        bool bHasSideEffects = false;
+
+        std::vector<FrameGraphResource> ReadResources;
+        std::vector<FrameGraphState> ReadStates;
+        std::vector<FrameGraphResource> WriteResources;
+        std::vector<FrameGraphState> WriteStates;
+
+        // Compile results
+        uint32_t RefCount = 0;
+        bool bCulled = false;
+    };
+
+    struct PhysicalSlot
+    {
+        FrameGraphTextureDesc Desc;
+        uint32_t LastUse;
+    };
+
+    void Cull();
+    void AssignPhysicalSlots();
+    void BuildBarriers();
+
+    std::vector<ResourceNode> mResources;
+    std::vector<PassNode> mPasses;
+
+    std::vector<FrameGraphCompiledPass> mSchedule;
+    std::vector<FrameGraphBarrier> mFinalBarriers;
+    std::vector<PhysicalSlot> mPhysicalSlots;
+    bool bDirty = true;
+};
@@ -0,0 +1,178 @@
+#include "HotReload.h"
+#include <chrono>
+#include <fstream>
+#include <regex>
+#include <sstream>
+
+void AssetDependencyGraph::AddDependency(const std::string& Dependent, const std::string& Dependency)
+{
+    mDependents[Dependency].insert(Dependent);
+    mDependencies[Dependent].insert(Dependency);
+}
+
+void AssetDependencyGraph::ClearDependencies(const std::string& Dependent)
+{
+    auto Found = mDependencies.find(Dependent);
+    if (Found == mDependencies.end())
+        return;
+
+    for (const std::string& Dependency : Found->second)
+        mDependents[Dependency].erase(Dependent);
+    mDependencies.erase(Found);
+}
+
+void AssetDependencyGraph::SetReloader(const std::string& Node, std::function<void()> Reload)
+{
+    mReloaders[Node] = std::move(Reload);
+}
+
+std::vector<std::string> AssetDependencyGraph::CollectReloads(const std::vector<std::string>& Changed) const
+{
+    // Everything downstream of the changed files
+    std::unordered_set<std::string> Dirty;
+    std::vector<std::string> Stack(Changed.begin(), Changed.end());
+    while (!Stack.empty())
+    {
+        std::string Node = std::move(Stack.back());
+        Stack.pop_back();
+
+        if (!Dirty.insert(Node).second)
+            continue;
+
+        auto Found = mDependents.find(Node);
+        if (Found != mDependents.end())
+            Stack.insert(Stack.end(), Found->second.begin(), Found->second.end());
+    }
+
+    // Post order over dependencies, restricted to the dirty set, puts dependencies first
+    std::vector<std::string> Order;
+    std::unordered_set<std::string> Visited;
+    std::function<void(const std::string&)> Visit = [&](const std::string& Node)
+    {
+        if (!Visited.insert(Node).second)
+            return;
+
+        auto Found = mDependencies.find(Node);
+        if (Found != mDependencies.end())
+        {
+            for (const std::string& Dependency : Found->second)
+            {
+                if (Dirty.contains(Dependency))
+                    Visit(Dependency);
+            }
+        }
+
+        if (mReloaders.contains(Node))
+            Order.push_back(Node);
+    };
+
+    for (const std::string& Node : Dirty)
+        Visit(Node);
+
+    return Order;
+}
+
+void HotReloader::TrackShader(const std::string& Node, const std::string& ShaderFile)
+{
+    std::string Normalized = NormalizePath(ShaderFile);
+    mGraph.AddDependency(Node, Normalized);
+
+    std::unordered_set<std::string> Visited;
+    TrackIncludes(Normalized, Visited);
+}
+
+void HotReloader::TrackIncludes(const std::string& ShaderFile, std::unordered_set<std::string>& Visited)
+{
+    if (!Visited.insert(ShaderFile).second)
+        return;
+
+    mGraph.ClearDependencies(ShaderFile);
+    for (const std::string& Include : ScanShaderIncludes(ShaderFile))
+    {
+        mGraph.AddDependency(ShaderFile, Include);
+        TrackIncludes(Include, Visited);
+    }
+}
+
+uint32_t HotReloader::Update(double Now)
+{
+    std::vector<std::string> Changed;
+    mWatcher.Poll(Now, Changed);
+
+    for (std::string& Path : Changed)
+    {
+        if (mGraph.Contains(Path))
+        {
+            mPending.insert(std::move(Path));
+            mLastChange = Now;
+        }
+    }
+
+    if (mPending.empty() || Now - mLastChange < mQuietSeconds)
+        return 0;
+
+    auto Start = std::chrono::high_resolution_clock::now();
+
+    std::vector<std::string> Files(mPending.begin(), mPending.end());
+    mPending.clear();
+
+    // Edited shaders may include different files now
+    for (const std::string& File : Files)
+    {
+        if (File.ends_with(".hlsl"))
+        {
+            std::unordered_set<std::string> Visited;
+            TrackIncludes(File, Visited);
+        }
+    }
+
+    mLastReloaded = mGraph.CollectReloads(Files);
+    for (const std::string& Node : mLastReloaded)
+        mGraph.Reload(Node);
+
+    mReloads += static_cast<uint32_t>(mLastReloaded.size());
+    mLastReloadMs = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now() - Start).count() / 1e6;
+
+    return static_cast<uint32_t>(mLastReloaded.size());
+}
+
+std::vector<std::string> ScanShaderIncludes(const std::string& ShaderFile)
+{
+    std::vector<std::string> Includes;
+
+    std::ifstream File(ShaderFile);
+    std::filesystem::path Directory = std::filesystem::path(ShaderFile).parent_path();
+
+    static const std::regex IncludePattern(R"re(^\s*#\s*include\s*"([^"]+)")re");
+    std::string Line;
+    std::smatch Match;
+    while (std::getline(File, Line))
+    {
+        if (std::regex_search(Line, Match, IncludePattern))
+            Includes.push_back(NormalizePath(Directory / Match[1].str()));
+    }
+
+    return Includes;
+}
+
+std::vector<std::string> ScanGltfUris(const std::string& GltfFile)
+{
+    std::vector<std::string> Uris;
+
+    std::ifstream File(GltfFile);
+    std::stringstream Contents;
+    Contents << File.rdbuf();
+    std::string Json = Contents.str();
+
+    std::filesystem::path Directory = std::filesystem::path(GltfFile).parent_path();
+
+    static const std::regex UriPattern(R"re("uri"\s*:\s*"([^"]+)")re");
+    for (auto Match = std::sregex_iterator(Json.begin(), Json.end(), UriPattern); Match != std::sregex_iterator(); ++Match)
+    {
+        std::string Uri = (*Match)[1].str();
+        if (!Uri.starts_with("data:"))
+            Uris.push_back(NormalizePath(Directory / Uri));
+    }
+
+    return Uris;
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "FileWatcher.h"
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// Nodes are either files, named by their normalized path, or derived assets such as pipelines and scenes, named
+// freely. A node with a reloader is rebuilt whenever anything it transitively depends on changes.
+struct AssetDependencyGraph
+{
+    void AddDependency(const std::string& Dependent, const std::string& Dependency);
+
+    // Forgets what Dependent depends on, for nodes whose dependencies are rediscovered on every reload
+    void ClearDependencies(const std::string& Dependent);
+
+    void SetReloader(const std::string& Node, std::function<void()> Reload);
+
+    bool Contains(const std::string& Node) const
+    {
+        return mDependents.contains(Node) || mDependencies.contains(Node) || mReloaders.contains(Node);
+    }
+
+    // Every node affected by the changed files that has a reloader, dependencies before their dependents
+    std::vector<std::string> CollectReloads(const std::vector<std::string>& Changed) const;
+
+    void Reload(const std::string& Node) const
+    {
+        auto Found = mReloaders.find(Node);
+        if (Found != mReloaders.end())
+            Found->second();
+    }
+
+private:
+
+    std::unordered_map<std::string, std::unordered_set<std::string>> mDependents;
+    std::unordered_map<std::string, std::unordered_set<std::string>> mDependencies;
+    std::unordered_map<std::string, std::function<void()>> mReloaders;
+};
+
+// Watches directories and rebuilds what changed at a frame boundary. Changes are collected until the files have been
+// quiet for a moment, since editors tend to write a file in several steps.
+struct HotReloader
+{
+    AssetDependencyGraph mGraph;
+    FileWatcher mWatcher;
+
+    double mQuietSeconds = 0.1;
+
+    // Stats
+    uint32_t mReloads = 0;
+    double mLastReloadMs = 0.0;
+    std::vector<std::string> mLastReloaded;
+
+    bool Watch(const std::string& Directory)
+    {
+        return mWatcher.Watch(Directory);
+    }
+
+    // Makes Node depend on ShaderFile and, recursively, everything it includes
+    void TrackShader(const std::string& Node, const std::string& ShaderFile);
+
+    // Polls the watcher and runs due reloads, returns the number of nodes reloaded
+    uint32_t Update(double Now);
+
+private:
+
+    void TrackIncludes(const std::string& ShaderFile, std::unordered_set<std::string>& Visited);
+
+    std::unordered_set<std::string> mPending;
+    double mLastChange = 0.0;
+};
+
+// Files named by #include "..." directives, resolved relative to the including file
+std::vector<std::string> ScanShaderIncludes(const std::string& ShaderFile);
+
+// External files referenced by a glTF's buffers and images, resolved relative to it. Embedded data URIs are skipped.
+std::vector<std::string> ScanGltfUris(const std::string& GltfFile);
@@ -0,0 +1,235 @@
+#include "IndirectDraws.h"
+#include "JobSystem.h"
+#include "glm/gtc/matrix_transform.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <random>
+
+std::array<glm::vec4, 6> ExtractFrustumPlanes(const glm::mat4& ViewProjection)
+{
+    // Rows of the column major matrix
+    glm::vec4 Row0(ViewProjection[0][0], ViewProjection[1][0], ViewProjection[2][0], ViewProjection[3][0]);
+    glm::vec4 Row1(ViewProjection[0][1], ViewProjection[1][1], ViewProjection[2][1], ViewProjection[3][1]);
+    glm::vec4 Row2(ViewProjection[0][2], ViewProjection[1][2], ViewProjection[2][2], ViewProjection[3][2]);
+    glm::vec4 Row3(ViewProjection[0][3], ViewProjection[1][3], ViewProjection[2][3], ViewProjection[3][3]);
+
+    // The near plane assumes a -1 to 1 depth range, which is conservative for a 0 to 1 one
+    std::array<glm::vec4, 6> Planes = {
+        Row3 + Row0, Row3 - Row0,
+        Row3 + Row1, Row3 - Row1,
+        Row3 + Row2, Row3 - Row2
+    };
+
+    for (glm::vec4& Plane : Planes)
+        Plane /= glm::length(glm::vec3(Plane));
+
+    return Planes;
+}
+
+void IndirectDrawBuilder::Build(std::span<const DrawSource> Sources, uint32_t PipelineCount, const DrawView& View, JobSystem& Jobs)
+{
+    uint32_t SourceCount = static_cast<uint32_t>(Sources.size());
+    uint32_t ChunkCount = (SourceCount + CHUNK_SIZE - 1) / CHUNK_SIZE;
+
+    mPipelines = PipelineCount;
+    mSourceLods.resize(SourceCount);
+    mSourceSpheres.Resize(SourceCount);
+
+    // Nothing to draw, or nothing to draw it with. The chunk passes index the per pipeline counts, so skip them.
+    if (PipelineCount == 0 || SourceCount == 0)
+    {
+        std::fill(mSourceLods.begin(), mSourceLods.end(), FRUSTUM_CULLED);
+        mCommands.clear();
+        mDrawData.clear();
+        mPipelineFirst.assign(PipelineCount, 0);
+        mPipelineCount.assign(PipelineCount, 0);
+        mFrustumCulled = SourceCount;
+        mContributionCulled = 0;
+        mLodDraws.fill(0);
+        return;
+    }
+
+    mChunkCounts.assign(static_cast<size_t>(ChunkCount) * PipelineCount, 0);
+    mChunkOffsets.resize(mChunkCounts.size());
+
+    std::array<glm::vec4, 6> Planes = ExtractFrustumPlanes(View.ViewProjection);
+
+    Jobs.ParallelFor(ChunkCount, 1, [&](uint32_t Chunk)
+    {
+        ClassifyChunk(Sources, Chunk, View, Planes);
+    });
+
+    // Pipeline major prefix sum, so every pipeline's draws end up contiguous and in source order
+    uint32_t Offset = 0;
+    mPipelineFirst.resize(PipelineCount);
+    mPipelineCount.resize(PipelineCount);
+    for (uint32_t PipelineIndex = 0; PipelineIndex < PipelineCount; PipelineIndex++)
+    {
+        mPipelineFirst[PipelineIndex] = Offset;
+        for (uint32_t Chunk = 0; Chunk < ChunkCount; Chunk++)
+        {
+            uint32_t Slot = Chunk * PipelineCount + PipelineIndex;
+            mChunkOffsets[Slot] = Offset;
+            Offset += mChunkCounts[Slot];
+        }
+        mPipelineCount[PipelineIndex] = Offset - mPipelineFirst[PipelineIndex];
+    }
+
+    mCommands.resize(Offset);
+    mDrawData.resize(Offset);
+
+    Jobs.ParallelFor(ChunkCount, 1, [&](uint32_t Chunk)
+    {
+        ScatterChunk(Sources, Chunk);
+    });
+
+    // Stats are cheap enough to gather afterwards rather than contending over them in the jobs
+    mFrustumCulled = 0;
+    mContributionCulled = 0;
+    mLodDraws.fill(0);
+    for (uint8_t Lod : mSourceLods)
+    {
+        if (Lod == FRUSTUM_CULLED)
+            mFrustumCulled++;
+        else if (Lod == CONTRIBUTION_CULLED)
+            mContributionCulled++;
+        else
+            mLodDraws[Lod]++;
+    }
+}
+
+void IndirectDrawBuilder::ClassifyChunk(std::span<const DrawSource> Sources, uint32_t Chunk, const DrawView& View, const std::array<glm::vec4, 6>& Planes)
+{
+    uint32_t Begin = Chunk * CHUNK_SIZE;
+    uint32_t End = std::min(Begin + CHUNK_SIZE, static_cast<uint32_t>(Sources.size()));
+    uint32_t* Counts = &mChunkCounts[static_cast<size_t>(Chunk) * mPipelines];
+
+    for (uint32_t SourceIndex = Begin; SourceIndex < End; SourceIndex++)
+    {
+        const DrawSource& Source = Sources[SourceIndex];
+        mSourceSpheres.Set(SourceIndex, (Source.BoundsMin + Source.BoundsMax) * 0.5f, glm::length(Source.BoundsMax - Source.BoundsMin) * 0.5f);
+    }
+
+    // Bounding spheres against the planes through the batch kernels. A little looser than testing the boxes, but the
+    // same spheres pick the level below.
+    std::array<uint8_t, CHUNK_SIZE> Inside;
+    TestSpheresAgainstPlanes(mSourceSpheres, Begin, End - Begin, Planes.data(), static_cast<uint32_t>(Planes.size()), Inside.data());
+
+    for (uint32_t SourceIndex = Begin; SourceIndex < End; SourceIndex++)
+    {
+        const DrawSource& Source = Sources[SourceIndex];
+        if (!Inside[SourceIndex - Begin] || Source.PipelineIndex >= mPipelines)
+        {
+            mSourceLods[SourceIndex] = FRUSTUM_CULLED;
+            continue;
+        }
+
+        glm::vec3 Center(mSourceSpheres.X[SourceIndex], mSourceSpheres.Y[SourceIndex], mSourceSpheres.Z[SourceIndex]);
+        float Radius = mSourceSpheres.Radius[SourceIndex];
+
+        // Projected diameter of the bounding sphere
+        float Distance = std::max(glm::length(Center - View.Eye) - Radius, View.NearClip);
+        float ScreenSize = 2.0f * Radius / Distance * View.PixelsPerUnit;
+
+        uint8_t Chosen = CONTRIBUTION_CULLED;
+        for (uint32_t Lod = 0; Lod < std::min(Source.LodCount, MAX_DRAW_LODS); Lod++)
+        {
+            if (ScreenSize >= Source.Lods[Lod].MinScreenSize)
+            {
+                Chosen = static_cast<uint8_t>(Lod);
+                break;
+            }
+        }
+
+        mSourceLods[SourceIndex] = Chosen;
+        if (Chosen != CONTRIBUTION_CULLED)
+            Counts[Source.PipelineIndex]++;
+    }
+}
+
+void IndirectDrawBuilder::ScatterChunk(std::span<const DrawSource> Sources, uint32_t Chunk)
+{
+    uint32_t Begin = Chunk * CHUNK_SIZE;
+    uint32_t End = std::min(Begin + CHUNK_SIZE, static_cast<uint32_t>(Sources.size()));
+    uint32_t* Cursors = &mChunkOffsets[static_cast<size_t>(Chunk) * mPipelines];
+
+    for (uint32_t SourceIndex = Begin; SourceIndex < End; SourceIndex++)
+    {
+        uint8_t Lod = mSourceLods[SourceIndex];
+        if (Lod >= MAX_DRAW_LODS)
+            continue;
+
+        const DrawSource& Source = Sources[SourceIndex];
+        const DrawLod& Level = Source.Lods[Lod];
+        uint32_t DrawIndex = Cursors[Source.PipelineIndex]++;
+
+        mCommands[DrawIndex] = { Level.IndexCount, 1, Level.FirstIndex, Level.VertexOffset, DrawIndex };
+        mDrawData[DrawIndex] = { SourceIndex, Source.MaterialIndex, Lod, 0 };
+    }
+}
+
+std::vector<DrawSource> ScatterDrawSources(uint32_t Count, uint32_t PipelineCount, glm::vec3 Min, glm::vec3 Max, uint32_t Seed)
+{
+    std::mt19937 Rng(Seed);
+    std::uniform_real_distribution<float> Unit(0.0f, 1.0f);
+
+    float Extent = glm::length(Max - Min);
+    std::vector<DrawSource> Sources(Count);
+    for (uint32_t SourceIndex = 0; SourceIndex < Count; SourceIndex++)
+    {
+        DrawSource& Source = Sources[SourceIndex];
+
+        glm::vec3 Center = Min + (Max - Min) * glm::vec3(Unit(Rng), Unit(Rng), Unit(Rng));
+        glm::vec3 HalfExtent = glm::vec3(Unit(Rng), Unit(Rng), Unit(Rng)) * Extent * 0.01f;
+        Source.BoundsMin = Center - HalfExtent;
+        Source.BoundsMax = Center + HalfExtent;
+
+        Source.PipelineIndex = SourceIndex % PipelineCount;
+        Source.MaterialIndex = SourceIndex % 64;
+
+        // Each level halves the triangles and is used down to half the screen size of the previous one
+        uint32_t IndexCount = 3 * 4096;
+        Source.LodCount = MAX_DRAW_LODS;
+        for (uint32_t Lod = 0; Lod < MAX_DRAW_LODS; Lod++)
+        {
+            Source.Lods[Lod] = { 0, IndexCount, 0, 64.0f / static_cast<float>(1u << Lod) };
+            IndexCount /= 2;
+        }
+    }
+
+    return Sources;
+}
+
+std::vector<IndirectDrawBenchmark> BenchmarkIndirectDraws(JobSystem& Jobs, const std::vector<uint32_t>& SourceCounts, uint32_t Iterations)
+{
+    // A camera at the origin looking down -z at a field of draws that extends behind and beside it
+    DrawView View;
+    View.ViewProjection = glm::perspective(glm::radians(75.0f), 16.0f / 9.0f, 0.1f, 1000.0f);
+    View.PixelsPerUnit = 1080.0f / (2.0f * std::tan(glm::radians(75.0f) * 0.5f));
+
+    std::vector<IndirectDrawBenchmark> Results;
+    for (uint32_t SourceCount : SourceCounts)
+    {
+        std::vector<DrawSource> Sources = ScatterDrawSources(SourceCount, 4, { -500.0f, -50.0f, -1000.0f }, { 500.0f, 50.0f, 200.0f }, 1337);
+
+        IndirectDrawBuilder Builder;
+        Builder.Build(Sources, 4, View, Jobs); // Warm up the scratch allocations
+
+        double Total = 0.0, Min = std::numeric_limits<double>::max();
+        for (uint32_t Iteration = 0; Iteration < Iterations; Iteration++)
+        {
+            auto Start = std::chrono::high_resolution_clock::now();
+            Builder.Build(Sources, 4, View, Jobs);
+            double Ms = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now() - Start).count() / 1e6;
+
+            Total += Ms;
+            Min = std::min(Min, Ms);
+        }
+
+        Results.push_back({ SourceCount, Total / Iterations, Min, static_cast<uint32_t>(Builder.mCommands.size()) });
+    }
+
+    return Results;
+}
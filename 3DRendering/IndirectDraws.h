@@ -0,0 +1,127 @@
+#pragma once
+
+#include "MemoryTracking.h"
+#include "SimdMath.h"
+#include "glm/glm.hpp"
+#include <array>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+struct JobSystem;
+
+constexpr uint32_t MAX_DRAW_LODS = 4;
+
+// Layout matches VkDrawIndexedIndirectCommand and D3D12_DRAW_INDEXED_ARGUMENTS
+struct DrawIndexedIndirectCommand
+{
+    uint32_t IndexCount;
+    uint32_t InstanceCount;
+    uint32_t FirstIndex;
+    int32_t VertexOffset;
+    uint32_t FirstInstance;
+};
+
+struct DrawLod
+{
+    uint32_t FirstIndex = 0;
+    uint32_t IndexCount = 0;
+    int32_t VertexOffset = 0;
+
+    // Smallest projected diameter, in pixels, this level is drawn at
+    float MinScreenSize = 0.0f;
+};
+
+// Something that can be drawn. Levels go from most to least detailed, below the last level's MinScreenSize the draw
+// is culled entirely.
+struct DrawSource
+{
+    glm::vec3 BoundsMin{};
+    glm::vec3 BoundsMax{};
+
+    uint32_t PipelineIndex = 0;
+    uint32_t MaterialIndex = 0;
+
+    uint32_t LodCount = 1;
+    std::array<DrawLod, MAX_DRAW_LODS> Lods{};
+};
+
+// Per draw data, indexed by a command's FirstInstance
+struct DrawInstanceData
+{
+    uint32_t SourceIndex;
+    uint32_t MaterialIndex;
+    uint32_t Lod;
+    uint32_t Padding;
+};
+
+struct DrawView
+{
+    glm::mat4 ViewProjection{1.0f};
+    glm::vec3 Eye{};
+    float NearClip = 0.1f;
+
+    // Pixels covered by one unit at a distance of one unit, the render height over 2 tan(fov / 2)
+    float PixelsPerUnit = 1.0f;
+};
+
+// Builds compacted indirect draw arguments the way a culling compute shader would: sources are culled and assigned a
+// level in parallel chunks, a prefix sum over the per chunk survivor counts gives every chunk its output range, and a
+// second parallel pass scatters the records. The output is grouped by pipeline and keeps the source order within
+// each group, so it's identical however the work was split.
+struct IndirectDrawBuilder
+{
+    static constexpr uint32_t CHUNK_SIZE = 256;
+    static_assert(CHUNK_SIZE % SIMD_BATCH_ALIGNMENT == 0, "Chunks test their range of the sphere batch on their own");
+
+    TrackedVector<DrawIndexedIndirectCommand, MemoryCategory::Draws> mCommands;
+    TrackedVector<DrawInstanceData, MemoryCategory::Draws> mDrawData;
+
+    // Range of mCommands drawn with each pipeline
+    TrackedVector<uint32_t, MemoryCategory::Draws> mPipelineFirst;
+    TrackedVector<uint32_t, MemoryCategory::Draws> mPipelineCount;
+
+    // Stats from the last build
+    uint32_t mFrustumCulled = 0;
+    uint32_t mContributionCulled = 0;
+    std::array<uint32_t, MAX_DRAW_LODS> mLodDraws{};
+
+    void Build(std::span<const DrawSource> Sources, uint32_t PipelineCount, const DrawView& View, JobSystem& Jobs);
+
+private:
+
+    static constexpr uint8_t FRUSTUM_CULLED = 0xFF;
+    static constexpr uint8_t CONTRIBUTION_CULLED = 0xFE;
+
+    void ClassifyChunk(std::span<const DrawSource> Sources, uint32_t Chunk, const DrawView& View, const std::array<glm::vec4, 6>& Planes);
+    void ScatterChunk(std::span<const DrawSource> Sources, uint32_t Chunk);
+
+    // Bounding sphere per source, each chunk fills and frustum tests its own range
+    SphereBatch mSourceSpheres;
+
+    // Chosen level per source, or why it was culled
+    TrackedVector<uint8_t, MemoryCategory::Draws> mSourceLods;
+
+    // Survivors, then output offsets, per (chunk, pipeline)
+    TrackedVector<uint32_t, MemoryCategory::Draws> mChunkCounts;
+    TrackedVector<uint32_t, MemoryCategory::Draws> mChunkOffsets;
+
+    uint32_t mPipelines = 0;
+};
+
+// Frustum planes of a clip space transform, normals point inwards
+std::array<glm::vec4, 6> ExtractFrustumPlanes(const glm::mat4& ViewProjection);
+
+// Deterministically scatters single level draws of random sizes through a box, with level thresholds for each
+std::vector<DrawSource> ScatterDrawSources(uint32_t Count, uint32_t PipelineCount, glm::vec3 Min, glm::vec3 Max, uint32_t Seed);
+
+struct IndirectDrawBenchmark
+{
+    uint32_t SourceCount;
+    double AvgMs;
+    double MinMs;
+    uint32_t DrawCount;
+};
+
+// Times IndirectDrawBuilder::Build against an increasing number of draws without touching the GPU
+std::vector<IndirectDrawBenchmark> BenchmarkIndirectDraws(JobSystem& Jobs, const std::vector<uint32_t>& SourceCounts, uint32_t Iterations);
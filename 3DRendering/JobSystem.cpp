@@ -0,0 +1,432 @@
+#include "JobSystem.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_IX86)
+#include <emmintrin.h>
+#define JOB_SPIN_PAUSE() _mm_pause()
+#else
+#define JOB_SPIN_PAUSE() std::this_thread::yield()
+#endif
+
+JobSystem gJobs;
+
+// Which system and slot the current thread belongs to, if any
+static thread_local JobSystem* tJobSystem = nullptr;
+static thread_local uint32_t tThreadIndex = 0;
+
+// Number of failed steal rounds before a worker goes to sleep
+constexpr uint32_t WORKER_SPIN_ROUNDS = 64;
+
+bool JobDeque::Push(Job* NewJob)
+{
+    int64_t Bottom = mBottom.load(std::memory_order_relaxed);
+    int64_t Top = mTop.load(std::memory_order_acquire);
+    if (Bottom - Top >= CAPACITY)
+        return false;
+
+    mJobs[Bottom & (CAPACITY - 1)].store(NewJob, std::memory_order_relaxed);
+    mBottom.store(Bottom + 1, std::memory_order_release);
+    return true;
+}
+
+Job* JobDeque::Pop()
+{
+    // The bottom store must be visible before top is read, or a thief and the owner could both take the last job
+    int64_t Bottom = mBottom.load(std::memory_order_relaxed) - 1;
+    mBottom.store(Bottom, std::memory_order_seq_cst);
+    int64_t Top = mTop.load(std::memory_order_seq_cst);
+
+    if (Top > Bottom)
+    {
+        // Already empty
+        mBottom.store(Bottom + 1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    Job* Popped = mJobs[Bottom & (CAPACITY - 1)].load(std::memory_order_relaxed);
+    if (Top == Bottom)
+    {
+        // Last job, race any thieves for it
+        if (!mTop.compare_exchange_strong(Top, Top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            Popped = nullptr;
+        mBottom.store(Bottom + 1, std::memory_order_relaxed);
+    }
+
+    return Popped;
+}
+
+Job* JobDeque::Steal()
+{
+    int64_t Top = mTop.load(std::memory_order_seq_cst);
+    int64_t Bottom = mBottom.load(std::memory_order_seq_cst);
+    if (Top >= Bottom)
+        return nullptr;
+
+    Job* Stolen = mJobs[Top & (CAPACITY - 1)].load(std::memory_order_relaxed);
+    if (!mTop.compare_exchange_strong(Top, Top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+        return nullptr;
+
+    return Stolen;
+}
+
+void JobSystem::Start(uint32_t NumWorkers)
+{
+    Stop();
+
+    bStopping.store(false);
+    mMainThreadId = std::this_thread::get_id();
+
+    mThreadStates.clear();
+    for (uint32_t ThreadIndex = 0; ThreadIndex < NumWorkers + 1; ThreadIndex++)
+    {
+        auto State = std::make_unique<ThreadState>();
+        State->JobPool = std::make_unique<Job[]>(JOB_POOL_SIZE);
+        State->RandomState = 0x9E3779B9u * (ThreadIndex + 1);
+        mThreadStates.push_back(std::move(State));
+    }
+
+    // The starting thread is slot zero
+    tJobSystem = this;
+    tThreadIndex = 0;
+
+    for (uint32_t Worker = 1; Worker <= NumWorkers; Worker++)
+    {
+        mThreads.emplace_back(&JobSystem::WorkerMain, this, Worker);
+    }
+}
+
+void JobSystem::Stop()
+{
+    if (mThreadStates.empty())
+        return;
+
+    // Drain whatever is still queued so no counter is left waiting forever
+    while (Job* Remaining = FindJob())
+        Execute(Remaining);
+
+    {
+        std::lock_guard Lock(mSleepMutex);
+        bStopping.store(true);
+        mWakeSignal++;
+    }
+    mSleepCondition.notify_all();
+
+    for (std::thread& Thread : mThreads)
+        Thread.join();
+    mThreads.clear();
+    mThreadStates.clear();
+
+    if (tJobSystem == this)
+        tJobSystem = nullptr;
+}
+
+int32_t JobSystem::GetThreadIndex() const
+{
+    return tJobSystem == this ? static_cast<int32_t>(tThreadIndex) : -1;
+}
+
+bool JobSystem::IsMainThread() const
+{
+    return std::this_thread::get_id() == mMainThreadId;
+}
+
+Job* JobSystem::AllocateJob()
+{
+    int32_t ThreadIndex = GetThreadIndex();
+    if (ThreadIndex < 0)
+        return nullptr;
+
+    ThreadState& State = *mThreadStates[ThreadIndex];
+    Job& Slot = State.JobPool[State.NextJob++ & (JOB_POOL_SIZE - 1)];
+
+    // The ring wrapped onto a job that hasn't run yet, help out until it has
+    while (Slot.bInFlight.load(std::memory_order_acquire))
+    {
+        if (Job* Ready = FindJob())
+            Execute(Ready);
+        else
+            JOB_SPIN_PAUSE();
+    }
+
+    Slot.bInFlight.store(true, std::memory_order_relaxed);
+    return &Slot;
+}
+
+void JobSystem::Submit(Job* NewJob)
+{
+    ThreadState& State = *mThreadStates[GetThreadIndex()];
+    if (!State.Deque.Push(NewJob))
+    {
+        // Deque is full, there is plenty of parallelism already
+        Execute(NewJob);
+        return;
+    }
+
+    WakeWorkers();
+}
+
+void JobSystem::Execute(Job* Ready)
+{
+    JobCounter* Counter = Ready->mCounter;
+    Ready->mInvoke(*Ready);
+    Ready->bInFlight.store(false, std::memory_order_release);
+
+    Counter->mPending.fetch_sub(1, std::memory_order_release);
+}
+
+Job* JobSystem::FindJob()
+{
+    int32_t ThreadIndex = GetThreadIndex();
+    if (ThreadIndex < 0)
+        return nullptr;
+
+    ThreadState& State = *mThreadStates[ThreadIndex];
+    if (Job* Own = State.Deque.Pop())
+        return Own;
+
+    // Start at a random victim so thieves spread out
+    State.RandomState ^= State.RandomState << 13;
+    State.RandomState ^= State.RandomState >> 17;
+    State.RandomState ^= State.RandomState << 5;
+
+    uint32_t ThreadCount = static_cast<uint32_t>(mThreadStates.size());
+    uint32_t First = State.RandomState % ThreadCount;
+    for (uint32_t Offset = 0; Offset < ThreadCount; Offset++)
+    {
+        uint32_t Victim = (First + Offset) % ThreadCount;
+        if (Victim == static_cast<uint32_t>(ThreadIndex))
+            continue;
+
+        if (Job* Stolen = mThreadStates[Victim]->Deque.Steal())
+            return Stolen;
+    }
+
+    return nullptr;
+}
+
+bool JobSystem::HasQueuedJobs() const
+{
+    for (const auto& State : mThreadStates)
+    {
+        if (!State->Deque.IsEmpty())
+            return true;
+    }
+    return false;
+}
+
+void JobSystem::Wait(JobCounter& Counter)
+{
+    while (!Counter.IsDone())
+    {
+        if (Job* Ready = FindJob())
+            Execute(Ready);
+        else
+            JOB_SPIN_PAUSE();
+    }
+}
+
+void JobSystem::WorkerMain(uint32_t ThreadIndex)
+{
+    tJobSystem = this;
+    tThreadIndex = ThreadIndex;
+
+    uint32_t IdleRounds = 0;
+    while (!bStopping.load(std::memory_order_relaxed))
+    {
+        if (Job* Ready = FindJob())
+        {
+            Execute(Ready);
+            IdleRounds = 0;
+            continue;
+        }
+
+        if (++IdleRounds < WORKER_SPIN_ROUNDS)
+        {
+            JOB_SPIN_PAUSE();
+            continue;
+        }
+
+        Sleep();
+        IdleRounds = 0;
+    }
+}
+
+void JobSystem::Sleep()
+{
+    std::unique_lock Lock(mSleepMutex);
+    uint64_t Signal = mWakeSignal;
+
+    // Announce ourselves before the final check. Submit pushes before it looks for sleepers, so either it sees us or
+    // we see its job.
+    mSleepers.fetch_add(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (!HasQueuedJobs())
+    {
+        mSleepCondition.wait(Lock, [&]() { return mWakeSignal != Signal || bStopping.load(); });
+    }
+    mSleepers.fetch_sub(1, std::memory_order_relaxed);
+}
+
+void JobSystem::WakeWorkers()
+{
+    // Pairs with the fence in Sleep, the push must be visible before we look for sleepers
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (mSleepers.load(std::memory_order_relaxed) == 0)
+        return;
+
+    {
+        std::lock_guard Lock(mSleepMutex);
+        mWakeSignal++;
+    }
+    mSleepCondition.notify_one();
+}
+
+void JobSystem::RunParallelFor(uint32_t Count, uint32_t MinGrain, RangeFunction Func, const void* Body)
+{
+    if (Count == 0)
+        return;
+
+    // Start from a few ranges per thread, lazy splitting refines it from there
+    uint32_t Grain = std::max(std::max(MinGrain, 1u), Count / (GetThreadCount() * 8));
+    if (GetThreadIndex() < 0 || Count <= Grain)
+    {
+        Func(Body, 0, Count);
+        return;
+    }
+
+    JobCounter Counter;
+    RunRange({ Func, Body, 0, Count, Grain }, Counter);
+    Wait(Counter);
+}
+
+void JobSystem::RunRange(RangeJobData Data, JobCounter& Counter)
+{
+    const JobDeque& Local = mThreadStates[GetThreadIndex()]->Deque;
+
+    while (Data.Begin < Data.End)
+    {
+        // Only split when thieves have emptied our deque, otherwise there is already enough queued work
+        uint32_t Remaining = Data.End - Data.Begin;
+        if (Remaining >= 2 * Data.Grain && Local.IsEmpty())
+        {
+            RangeJobData Half = Data;
+            Half.Begin = Data.Begin + Remaining / 2;
+            Data.End = Half.Begin;
+
+            JobCounter* CounterPtr = &Counter;
+            Spawn(Counter, [this, Half, CounterPtr]()
+            {
+                RunRange(Half, *CounterPtr);
+            });
+            continue;
+        }
+
+        uint32_t ChunkEnd = std::min(Data.Begin + Data.Grain, Data.End);
+        Data.Func(Data.Body, Data.Begin, ChunkEnd);
+        Data.Begin = ChunkEnd;
+    }
+}
+
+void JobSystem::RunOnMainThread(std::function<void()> Fn)
+{
+    if (IsMainThread())
+    {
+        Fn();
+        return;
+    }
+
+    std::lock_guard Lock(mMainThreadMutex);
+    mMainThreadQueue.push_back(std::move(Fn));
+}
+
+void JobSystem::PumpMainThread()
+{
+    std::vector<std::function<void()>> Queue;
+    {
+        std::lock_guard Lock(mMainThreadMutex);
+        Queue.swap(mMainThreadQueue);
+    }
+
+    for (std::function<void()>& Fn : Queue)
+        Fn();
+}
+
+static double SecondsSince(std::chrono::high_resolution_clock::time_point Start)
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now() - Start).count() / 1e9;
+}
+
+std::vector<JobBenchmarkResult> RunJobSystemBenchmarks(JobSystem& Jobs)
+{
+    std::vector<JobBenchmarkResult> Results;
+    uint32_t MaxThreads = Jobs.GetThreadCount();
+
+    // Spawn overhead, empty jobs spawned from the main thread
+    {
+        constexpr uint32_t JobCount = 200000;
+        JobCounter Counter;
+        auto Start = std::chrono::high_resolution_clock::now();
+        for (uint32_t JobIndex = 0; JobIndex < JobCount; JobIndex++)
+            Jobs.Spawn(Counter, []() {});
+        Jobs.Wait(Counter);
+        Results.push_back({ "Spawn + run empty job", MaxThreads, SecondsSince(Start) * 1e9 / JobCount, "ns/job" });
+    }
+
+    // Fork-join latency, one tiny job per thread then wait
+    {
+        constexpr uint32_t Rounds = 20000;
+        std::atomic<uint32_t> Sink{0};
+        auto Start = std::chrono::high_resolution_clock::now();
+        for (uint32_t Round = 0; Round < Rounds; Round++)
+        {
+            JobCounter Counter;
+            for (uint32_t Thread = 0; Thread < MaxThreads; Thread++)
+                Jobs.Spawn(Counter, [&Sink]() { Sink.fetch_add(1, std::memory_order_relaxed); });
+            Jobs.Wait(Counter);
+        }
+        Results.push_back({ "Fork-join round trip", MaxThreads, SecondsSince(Start) * 1e6 / Rounds, "us" });
+    }
+
+    // Scaling of a parallel-for with a moderate amount of work per element
+    {
+        constexpr uint32_t ElementCount = 1 << 22;
+        std::vector<float> Data(ElementCount);
+        double SingleThreaded = 0.0;
+
+        std::vector<uint32_t> ThreadCounts;
+        for (uint32_t Threads = 1; Threads < MaxThreads; Threads *= 2)
+            ThreadCounts.push_back(Threads);
+        ThreadCounts.push_back(MaxThreads);
+
+        for (uint32_t Threads : ThreadCounts)
+        {
+            Jobs.Start(Threads - 1);
+
+            double Best = std::numeric_limits<double>::max();
+            for (uint32_t Repeat = 0; Repeat < 5; Repeat++)
+            {
+                auto Start = std::chrono::high_resolution_clock::now();
+                Jobs.ParallelFor(ElementCount, 1024, [&Data](uint32_t Index)
+                {
+                    float Value = static_cast<float>(Index);
+                    for (uint32_t Iteration = 0; Iteration < 16; Iteration++)
+                        Value = std::sqrt(Value * 1.0001f + 1.0f);
+                    Data[Index] = Value;
+                });
+                Best = std::min(Best, SecondsSince(Start));
+            }
+
+            if (Threads == 1)
+                SingleThreaded = Best;
+
+            Results.push_back({ "Parallel-for 4M elements", Threads, Best * 1e3, "ms" });
+            Results.push_back({ "Parallel-for speedup", Threads, SingleThreaded / Best, "x" });
+        }
+    }
+
+    Jobs.Start(MaxThreads - 1);
+    return Results;
+}
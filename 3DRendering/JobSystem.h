@@ -0,0 +1,197 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Tracks a group of outstanding jobs. This is the handle jobs are waited on with.
+struct JobCounter
+{
+    std::atomic<uint32_t> mPending{0};
+
+    bool IsDone() const
+    {
+        return mPending.load(std::memory_order_acquire) == 0;
+    }
+};
+
+struct Job
+{
+    static constexpr size_t PAYLOAD_SIZE = 48;
+
+    void (*mInvoke)(Job& Self) = nullptr;
+    JobCounter* mCounter = nullptr;
+    std::atomic<bool> bInFlight{false};
+    alignas(16) unsigned char mPayload[PAYLOAD_SIZE];
+};
+
+// Bounded Chase-Lev deque. The owning thread pushes and pops at the bottom, any other thread steals from the top.
+struct JobDeque
+{
+    static constexpr int64_t CAPACITY = 4096;
+
+    bool Push(Job* NewJob);
+    Job* Pop();
+    Job* Steal();
+
+    bool IsEmpty() const
+    {
+        return mBottom.load(std::memory_order_relaxed) <= mTop.load(std::memory_order_relaxed);
+    }
+
+private:
+
+    alignas(64) std::atomic<int64_t> mTop{0};
+    alignas(64) std::atomic<int64_t> mBottom{0};
+    alignas(64) std::array<std::atomic<Job*>, CAPACITY> mJobs{};
+};
+
+// Work-stealing scheduler. The thread that calls Start becomes the main thread and takes part in the work whenever
+// it waits. Only the main thread and the workers may spawn jobs; any other thread runs them inline.
+struct JobSystem
+{
+    void Start(uint32_t NumWorkers);
+    void Stop();
+
+    // Runs Fn on some thread, Counter is decremented once it has finished. Fn's captures must fit in a job payload.
+    template<typename FuncType>
+    void Spawn(JobCounter& Counter, FuncType&& Fn)
+    {
+        using Callable = std::decay_t<FuncType>;
+        static_assert(sizeof(Callable) <= Job::PAYLOAD_SIZE, "Job captures are too large, capture by reference instead");
+        static_assert(alignof(Callable) <= 16, "Job captures are over aligned");
+
+        Job* NewJob = AllocateJob();
+        if (!NewJob)
+        {
+            Fn();
+            return;
+        }
+
+        new (NewJob->mPayload) Callable(std::forward<FuncType>(Fn));
+        NewJob->mInvoke = [](Job& Self)
+        {
+            Callable* Payload = reinterpret_cast<Callable*>(Self.mPayload);
+            (*Payload)();
+            Payload->~Callable();
+        };
+        NewJob->mCounter = &Counter;
+        Counter.mPending.fetch_add(1, std::memory_order_relaxed);
+
+        Submit(NewJob);
+    }
+
+    // Executes other jobs until every job tracked by Counter has finished
+    void Wait(JobCounter& Counter);
+
+    // Calls Body(Begin, End) over [0, Count). Ranges are split lazily, only once the executing thread's deque has been
+    // drained by thieves, so the grain adapts to how busy the other workers are. MinGrain bounds the smallest range.
+    template<typename FuncType>
+    void ParallelForRange(uint32_t Count, uint32_t MinGrain, FuncType&& Body)
+    {
+        RunParallelFor(Count, MinGrain, [](const void* Body, uint32_t Begin, uint32_t End)
+        {
+            (*static_cast<const std::remove_reference_t<FuncType>*>(Body))(Begin, End);
+        }, &Body);
+    }
+
+    // Per index convenience over ParallelForRange
+    template<typename FuncType>
+    void ParallelFor(uint32_t Count, uint32_t MinGrain, FuncType&& Body)
+    {
+        ParallelForRange(Count, MinGrain, [&Body](uint32_t Begin, uint32_t End)
+        {
+            for (uint32_t Index = Begin; Index < End; Index++)
+                Body(Index);
+        });
+    }
+
+    // Render API calls are only legal on the main thread. Jobs that need one queue it here, and the main thread runs
+    // the queue at a frame boundary through PumpMainThread.
+    void RunOnMainThread(std::function<void()> Fn);
+    void PumpMainThread();
+
+    bool IsMainThread() const;
+
+    uint32_t GetThreadCount() const
+    {
+        return static_cast<uint32_t>(mThreads.size()) + 1;
+    }
+
+    ~JobSystem()
+    {
+        Stop();
+    }
+
+private:
+
+    using RangeFunction = void (*)(const void* Body, uint32_t Begin, uint32_t End);
+
+    struct RangeJobData
+    {
+        RangeFunction Func;
+        const void* Body;
+        uint32_t Begin;
+        uint32_t End;
+        uint32_t Grain;
+    };
+
+    struct alignas(64) ThreadState
+    {
+        JobDeque Deque;
+        std::unique_ptr<Job[]> JobPool;
+        uint32_t NextJob = 0;
+        uint32_t RandomState = 0;
+    };
+
+    static constexpr uint32_t JOB_POOL_SIZE = 4096;
+
+    void WorkerMain(uint32_t ThreadIndex);
+    void Sleep();
+    void WakeWorkers();
+
+    Job* AllocateJob();
+    void Submit(Job* NewJob);
+    void Execute(Job* Ready);
+    Job* FindJob();
+    bool HasQueuedJobs() const;
+    int32_t GetThreadIndex() const;
+
+    void RunParallelFor(uint32_t Count, uint32_t MinGrain, RangeFunction Func, const void* Body);
+    void RunRange(RangeJobData Data, JobCounter& Counter);
+
+    std::vector<std::thread> mThreads;
+    std::vector<std::unique_ptr<ThreadState>> mThreadStates;
+    std::atomic<bool> bStopping{false};
+
+    std::mutex mSleepMutex;
+    std::condition_variable mSleepCondition;
+    std::atomic<uint32_t> mSleepers{0};
+    uint64_t mWakeSignal = 0;
+
+    std::mutex mMainThreadMutex;
+    std::vector<std::function<void()>> mMainThreadQueue;
+    std::thread::id mMainThreadId;
+};
+
+extern JobSystem gJobs;
+
+struct JobBenchmarkResult
+{
+    std::string Name;
+    uint32_t Threads;
+    double Value;
+    const char* Unit;
+};
+
+// Spawn overhead, fork-join latency and parallel-for scaling. Restarts Jobs with various worker counts and leaves it
+// running with its original worker count.
+std::vector<JobBenchmarkResult> RunJobSystemBenchmarks(JobSystem& Jobs);
@@ -0,0 +1,1149 @@
+#include "LightmapBaker.h"
+#include "JobSystem.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <limits>
+#include <numeric>
+#include <unordered_map>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define LIGHTMAP_USE_SSE 1
+#include <emmintrin.h>
+#else
+#define LIGHTMAP_USE_SSE 0
+#endif
+
+constexpr uint32_t PACKET_WIDTH = 4;
+constexpr uint32_t ALL_LANES = (1u << PACKET_WIDTH) - 1;
+constexpr uint32_t INVALID_TRIANGLE = ~0u;
+
+constexpr uint32_t BVH_BINS = 16;
+constexpr uint32_t BVH_MAX_LEAF_TRIANGLES = 4;
+constexpr uint32_t BVH_MAX_DEPTH = 48;
+constexpr uint32_t BVH_STACK_SIZE = BVH_MAX_DEPTH + 2;
+
+constexpr float RAY_FAR = 1e30f;
+constexpr float PI = 3.14159265358979f;
+
+constexpr uint32_t LIGHTMAP_FILE_MAGIC = 0x50414D4C; // "LMAP"
+constexpr uint32_t LIGHTMAP_FILE_VERSION = 1;
+
+namespace
+{
+    // Four lanes of floats. Comparisons give a bitmask with one bit per lane.
+#if LIGHTMAP_USE_SSE
+    struct Float4
+    {
+        __m128 V;
+
+        static Float4 Set1(float Value) { return { _mm_set1_ps(Value) }; }
+        static Float4 Load(const float* Src) { return { _mm_load_ps(Src) }; }
+        void Store(float* Dst) const { _mm_store_ps(Dst, V); }
+
+        Float4 operator+(Float4 Other) const { return { _mm_add_ps(V, Other.V) }; }
+        Float4 operator-(Float4 Other) const { return { _mm_sub_ps(V, Other.V) }; }
+        Float4 operator*(Float4 Other) const { return { _mm_mul_ps(V, Other.V) }; }
+        Float4 operator/(Float4 Other) const { return { _mm_div_ps(V, Other.V) }; }
+    };
+
+    Float4 Min4(Float4 A, Float4 B) { return { _mm_min_ps(A.V, B.V) }; }
+    Float4 Max4(Float4 A, Float4 B) { return { _mm_max_ps(A.V, B.V) }; }
+    uint32_t Less4(Float4 A, Float4 B) { return static_cast<uint32_t>(_mm_movemask_ps(_mm_cmplt_ps(A.V, B.V))); }
+    uint32_t LessEqual4(Float4 A, Float4 B) { return static_cast<uint32_t>(_mm_movemask_ps(_mm_cmple_ps(A.V, B.V))); }
+#else
+    struct Float4
+    {
+        float V[PACKET_WIDTH];
+
+        static Float4 Set1(float Value) { return { { Value, Value, Value, Value } }; }
+        static Float4 Load(const float* Src) { return { { Src[0], Src[1], Src[2], Src[3] } }; }
+        void Store(float* Dst) const { std::copy(V, V + PACKET_WIDTH, Dst); }
+
+        template<typename Op>
+        static Float4 Apply(const Float4& A, const Float4& B, Op&& Fn)
+        {
+            return { { Fn(A.V[0], B.V[0]), Fn(A.V[1], B.V[1]), Fn(A.V[2], B.V[2]), Fn(A.V[3], B.V[3]) } };
+        }
+
+        Float4 operator+(Float4 Other) const { return Apply(*this, Other, [](float A, float B) { return A + B; }); }
+        Float4 operator-(Float4 Other) const { return Apply(*this, Other, [](float A, float B) { return A - B; }); }
+        Float4 operator*(Float4 Other) const { return Apply(*this, Other, [](float A, float B) { return A * B; }); }
+        Float4 operator/(Float4 Other) const { return Apply(*this, Other, [](float A, float B) { return A / B; }); }
+    };
+
+    Float4 Min4(Float4 A, Float4 B) { return Float4::Apply(A, B, [](float X, float Y) { return X < Y ? X : Y; }); }
+    Float4 Max4(Float4 A, Float4 B) { return Float4::Apply(A, B, [](float X, float Y) { return X > Y ? X : Y; }); }
+
+    uint32_t Less4(Float4 A, Float4 B)
+    {
+        uint32_t Mask = 0;
+        for (uint32_t Lane = 0; Lane < PACKET_WIDTH; Lane++)
+            Mask |= (A.V[Lane] < B.V[Lane] ? 1u : 0u) << Lane;
+        return Mask;
+    }
+
+    uint32_t LessEqual4(Float4 A, Float4 B)
+    {
+        uint32_t Mask = 0;
+        for (uint32_t Lane = 0; Lane < PACKET_WIDTH; Lane++)
+            Mask |= (A.V[Lane] <= B.V[Lane] ? 1u : 0u) << Lane;
+        return Mask;
+    }
+#endif
+
+    struct alignas(16) RayPacket
+    {
+        float Ox[PACKET_WIDTH], Oy[PACKET_WIDTH], Oz[PACKET_WIDTH];
+        float Dx[PACKET_WIDTH], Dy[PACKET_WIDTH], Dz[PACKET_WIDTH];
+        float TMax[PACKET_WIDTH];
+
+        void Set(uint32_t Lane, const glm::vec3& Origin, const glm::vec3& Direction, float Far)
+        {
+            // Zero components would turn slab distances into NaN
+            auto Safe = [](float Value) { return std::fabs(Value) < 1e-9f ? (Value < 0.0f ? -1e-9f : 1e-9f) : Value; };
+
+            Ox[Lane] = Origin.x; Oy[Lane] = Origin.y; Oz[Lane] = Origin.z;
+            Dx[Lane] = Safe(Direction.x); Dy[Lane] = Safe(Direction.y); Dz[Lane] = Safe(Direction.z);
+            TMax[Lane] = Far;
+        }
+    };
+
+    struct alignas(16) PacketHits
+    {
+        float T[PACKET_WIDTH];
+        float U[PACKET_WIDTH];
+        float V[PACKET_WIDTH];
+        uint32_t Triangle[PACKET_WIDTH];
+    };
+
+    // Packet in registers, with reciprocal directions for the slab tests
+    struct PacketLanes
+    {
+        Float4 Ox, Oy, Oz;
+        Float4 Dx, Dy, Dz;
+        Float4 InvDx, InvDy, InvDz;
+
+        explicit PacketLanes(const RayPacket& Rays)
+            : Ox(Float4::Load(Rays.Ox)), Oy(Float4::Load(Rays.Oy)), Oz(Float4::Load(Rays.Oz))
+            , Dx(Float4::Load(Rays.Dx)), Dy(Float4::Load(Rays.Dy)), Dz(Float4::Load(Rays.Dz))
+        {
+            Float4 One = Float4::Set1(1.0f);
+            InvDx = One / Dx;
+            InvDy = One / Dy;
+            InvDz = One / Dz;
+        }
+    };
+
+    struct BvhNode
+    {
+        glm::vec3 Min;
+
+        // First child for inner nodes, the second follows it. First triangle for leaves.
+        uint32_t LeftOrFirst;
+
+        glm::vec3 Max;
+
+        // Triangles, zero for inner nodes
+        uint32_t Count;
+
+        // Axis inner nodes were split along, children go from low to high on it
+        uint32_t Axis;
+    };
+
+    // Laid out for Moller-Trumbore
+    struct BvhTriangle
+    {
+        glm::vec3 V0;
+        glm::vec3 E1;
+        glm::vec3 E2;
+    };
+
+    struct BakeBvh
+    {
+        std::vector<BvhNode> Nodes;
+        std::vector<BvhTriangle> Triangles;
+
+        // Index of each triangle in what Build was given
+        std::vector<uint32_t> Sources;
+
+        // Binned SAH over the triangle centroids. Corners holds three corners per triangle.
+        void Build(const std::vector<glm::vec3>& Corners);
+
+        // Closest hit of every active lane within its TMax
+        void TraceClosest(const RayPacket& Rays, uint32_t Active, PacketHits& OutHits) const;
+
+        // Lanes that hit anything within their TMax
+        uint32_t TraceOcclusion(const RayPacket& Rays, uint32_t Active) const;
+
+    private:
+
+        uint32_t IntersectNode(const BvhNode& Node, const PacketLanes& Lanes, Float4 TMax) const;
+        uint32_t IntersectTriangle(const BvhTriangle& Tri, const PacketLanes& Lanes, Float4 TMax, Float4& OutT, Float4& OutU, Float4& OutV) const;
+    };
+
+    float SurfaceArea(const glm::vec3& Min, const glm::vec3& Max)
+    {
+        glm::vec3 Extent = glm::max(Max - Min, glm::vec3(0.0f));
+        return 2.0f * (Extent.x * Extent.y + Extent.y * Extent.z + Extent.z * Extent.x);
+    }
+
+    void BakeBvh::Build(const std::vector<glm::vec3>& Corners)
+    {
+        uint32_t TriangleCount = static_cast<uint32_t>(Corners.size() / 3);
+        Nodes.clear();
+        Triangles.clear();
+        Sources.clear();
+        if (TriangleCount == 0)
+            return;
+
+        std::vector<glm::vec3> TriMin(TriangleCount), TriMax(TriangleCount), Centroids(TriangleCount);
+        for (uint32_t Tri = 0; Tri < TriangleCount; Tri++)
+        {
+            const glm::vec3* P = &Corners[Tri * 3];
+            TriMin[Tri] = glm::min(P[0], glm::min(P[1], P[2]));
+            TriMax[Tri] = glm::max(P[0], glm::max(P[1], P[2]));
+            Centroids[Tri] = (P[0] + P[1] + P[2]) / 3.0f;
+        }
+
+        Sources.resize(TriangleCount);
+        std::iota(Sources.begin(), Sources.end(), 0u);
+
+        Nodes.reserve(TriangleCount * 2);
+        Nodes.push_back({ glm::vec3(0.0f), 0, glm::vec3(0.0f), TriangleCount, 0 });
+
+        struct PendingNode
+        {
+            uint32_t Node;
+            uint32_t Depth;
+        };
+        std::vector<PendingNode> Pending{ { 0, 0 } };
+
+        while (!Pending.empty())
+        {
+            PendingNode Current = Pending.back();
+            Pending.pop_back();
+
+            uint32_t First = Nodes[Current.Node].LeftOrFirst;
+            uint32_t Count = Nodes[Current.Node].Count;
+
+            glm::vec3 Min(std::numeric_limits<float>::max()), Max(-std::numeric_limits<float>::max());
+            glm::vec3 CentroidMin = Min, CentroidMax = Max;
+            for (uint32_t Index = First; Index < First + Count; Index++)
+            {
+                uint32_t Tri = Sources[Index];
+                Min = glm::min(Min, TriMin[Tri]);
+                Max = glm::max(Max, TriMax[Tri]);
+                CentroidMin = glm::min(CentroidMin, Centroids[Tri]);
+                CentroidMax = glm::max(CentroidMax, Centroids[Tri]);
+            }
+            Nodes[Current.Node].Min = Min;
+            Nodes[Current.Node].Max = Max;
+
+            if (Count <= BVH_MAX_LEAF_TRIANGLES || Current.Depth >= BVH_MAX_DEPTH)
+                continue;
+
+            glm::vec3 CentroidExtent = CentroidMax - CentroidMin;
+            uint32_t Axis = 0;
+            if (CentroidExtent.y > CentroidExtent[Axis])
+                Axis = 1;
+            if (CentroidExtent.z > CentroidExtent[Axis])
+                Axis = 2;
+
+            uint32_t Split = First + Count / 2;
+            if (CentroidExtent[Axis] > 0.0f)
+            {
+                struct Bin
+                {
+                    glm::vec3 Min{ std::numeric_limits<float>::max() };
+                    glm::vec3 Max{ -std::numeric_limits<float>::max() };
+                    uint32_t Count = 0;
+                };
+                Bin Bins[BVH_BINS];
+
+                float BinScale = BVH_BINS / CentroidExtent[Axis];
+                auto GetBin = [&](uint32_t Tri)
+                {
+                    return std::min(static_cast<uint32_t>((Centroids[Tri][Axis] - CentroidMin[Axis]) * BinScale), BVH_BINS - 1);
+                };
+
+                for (uint32_t Index = First; Index < First + Count; Index++)
+                {
+                    uint32_t Tri = Sources[Index];
+                    Bin& Target = Bins[GetBin(Tri)];
+                    Target.Min = glm::min(Target.Min, TriMin[Tri]);
+                    Target.Max = glm::max(Target.Max, TriMax[Tri]);
+                    Target.Count++;
+                }
+
+                // Sweep from the right for the cost of everything above each plane, then from the left
+                float RightArea[BVH_BINS];
+                uint32_t RightCount[BVH_BINS];
+                Bin Accumulated;
+                for (uint32_t BinIndex = BVH_BINS - 1; BinIndex > 0; BinIndex--)
+                {
+                    Accumulated.Min = glm::min(Accumulated.Min, Bins[BinIndex].Min);
+                    Accumulated.Max = glm::max(Accumulated.Max, Bins[BinIndex].Max);
+                    Accumulated.Count += Bins[BinIndex].Count;
+                    RightArea[BinIndex] = Accumulated.Count ? SurfaceArea(Accumulated.Min, Accumulated.Max) : 0.0f;
+                    RightCount[BinIndex] = Accumulated.Count;
+                }
+
+                float BestCost = std::numeric_limits<float>::max();
+                uint32_t BestPlane = 0;
+                Accumulated = Bin{};
+                for (uint32_t Plane = 1; Plane < BVH_BINS; Plane++)
+                {
+                    Accumulated.Min = glm::min(Accumulated.Min, Bins[Plane - 1].Min);
+                    Accumulated.Max = glm::max(Accumulated.Max, Bins[Plane - 1].Max);
+                    Accumulated.Count += Bins[Plane - 1].Count;
+                    if (Accumulated.Count == 0 || RightCount[Plane] == 0)
+                        continue;
+
+                    float Cost = Accumulated.Count * SurfaceArea(Accumulated.Min, Accumulated.Max) + RightCount[Plane] * RightArea[Plane];
+                    if (Cost < BestCost)
+                    {
+                        BestCost = Cost;
+                        BestPlane = Plane;
+                    }
+                }
+
+                // Small nodes that no split improves stay leaves
+                float LeafCost = Count * SurfaceArea(Min, Max);
+                if (BestCost >= LeafCost && Count <= BVH_MAX_LEAF_TRIANGLES * 4)
+                    continue;
+
+                if (BestPlane != 0)
+                {
+                    auto Middle = std::partition(Sources.begin() + First, Sources.begin() + First + Count, [&](uint32_t Tri)
+                    {
+                        return GetBin(Tri) < BestPlane;
+                    });
+                    Split = static_cast<uint32_t>(Middle - Sources.begin());
+                }
+            }
+
+            // Every centroid in one bin, or all in one place. Split the triangles in half instead.
+            if (Split == First || Split == First + Count)
+            {
+                Split = First + Count / 2;
+                std::nth_element(Sources.begin() + First, Sources.begin() + Split, Sources.begin() + First + Count, [&](uint32_t A, uint32_t B)
+                {
+                    return Centroids[A][Axis] < Centroids[B][Axis];
+                });
+            }
+
+            uint32_t Left = static_cast<uint32_t>(Nodes.size());
+            Nodes.push_back({ glm::vec3(0.0f), First, glm::vec3(0.0f), Split - First, 0 });
+            Nodes.push_back({ glm::vec3(0.0f), Split, glm::vec3(0.0f), First + Count - Split, 0 });
+
+            Nodes[Current.Node].LeftOrFirst = Left;
+            Nodes[Current.Node].Count = 0;
+            Nodes[Current.Node].Axis = Axis;
+
+            Pending.push_back({ Left, Current.Depth + 1 });
+            Pending.push_back({ Left + 1, Current.Depth + 1 });
+        }
+
+        Triangles.resize(TriangleCount);
+        for (uint32_t Index = 0; Index < TriangleCount; Index++)
+        {
+            const glm::vec3* P = &Corners[Sources[Index] * 3];
+            Triangles[Index] = { P[0], P[1] - P[0], P[2] - P[0] };
+        }
+    }
+
+    uint32_t BakeBvh::IntersectNode(const BvhNode& Node, const PacketLanes& Lanes, Float4 TMax) const
+    {
+        Float4 X0 = (Float4::Set1(Node.Min.x) - Lanes.Ox) * Lanes.InvDx;
+        Float4 X1 = (Float4::Set1(Node.Max.x) - Lanes.Ox) * Lanes.InvDx;
+        Float4 Y0 = (Float4::Set1(Node.Min.y) - Lanes.Oy) * Lanes.InvDy;
+        Float4 Y1 = (Float4::Set1(Node.Max.y) - Lanes.Oy) * Lanes.InvDy;
+        Float4 Z0 = (Float4::Set1(Node.Min.z) - Lanes.Oz) * Lanes.InvDz;
+        Float4 Z1 = (Float4::Set1(Node.Max.z) - Lanes.Oz) * Lanes.InvDz;
+
+        Float4 Near = Max4(Max4(Min4(X0, X1), Min4(Y0, Y1)), Max4(Min4(Z0, Z1), Float4::Set1(0.0f)));
+        Float4 Far = Min4(Min4(Max4(X0, X1), Max4(Y0, Y1)), Min4(Max4(Z0, Z1), TMax));
+        return LessEqual4(Near, Far);
+    }
+
+    uint32_t BakeBvh::IntersectTriangle(const BvhTriangle& Tri, const PacketLanes& Lanes, Float4 TMax, Float4& OutT, Float4& OutU, Float4& OutV) const
+    {
+        Float4 E1x = Float4::Set1(Tri.E1.x), E1y = Float4::Set1(Tri.E1.y), E1z = Float4::Set1(Tri.E1.z);
+        Float4 E2x = Float4::Set1(Tri.E2.x), E2y = Float4::Set1(Tri.E2.y), E2z = Float4::Set1(Tri.E2.z);
+
+        // P = D x E2
+        Float4 Px = Lanes.Dy * E2z - Lanes.Dz * E2y;
+        Float4 Py = Lanes.Dz * E2x - Lanes.Dx * E2z;
+        Float4 Pz = Lanes.Dx * E2y - Lanes.Dy * E2x;
+        Float4 Det = E1x * Px + E1y * Py + E1z * Pz;
+
+        // Parallel rays divide by zero here, the infinities and NaNs they produce fail the tests below
+        Float4 InvDet = Float4::Set1(1.0f) / Det;
+
+        Float4 Tx = Lanes.Ox - Float4::Set1(Tri.V0.x);
+        Float4 Ty = Lanes.Oy - Float4::Set1(Tri.V0.y);
+        Float4 Tz = Lanes.Oz - Float4::Set1(Tri.V0.z);
+        Float4 U = (Tx * Px + Ty * Py + Tz * Pz) * InvDet;
+
+        // Q = T x E1
+        Float4 Qx = Ty * E1z - Tz * E1y;
+        Float4 Qy = Tz * E1x - Tx * E1z;
+        Float4 Qz = Tx * E1y - Ty * E1x;
+        Float4 V = (Lanes.Dx * Qx + Lanes.Dy * Qy + Lanes.Dz * Qz) * InvDet;
+        Float4 T = (E2x * Qx + E2y * Qy + E2z * Qz) * InvDet;
+
+        Float4 Zero = Float4::Set1(0.0f);
+        Float4 Epsilon = Float4::Set1(1e-12f);
+        uint32_t Hit = (Less4(Epsilon, Det * Det))
+            & LessEqual4(Zero, U) & LessEqual4(Zero, V) & LessEqual4(U + V, Float4::Set1(1.0f))
+            & Less4(Zero, T) & Less4(T, TMax);
+
+        OutT = T;
+        OutU = U;
+        OutV = V;
+        return Hit;
+    }
+
+    void BakeBvh::TraceClosest(const RayPacket& Rays, uint32_t Active, PacketHits& OutHits) const
+    {
+        std::copy(Rays.TMax, Rays.TMax + PACKET_WIDTH, OutHits.T);
+        std::fill(OutHits.Triangle, OutHits.Triangle + PACKET_WIDTH, INVALID_TRIANGLE);
+        if (!Active || Nodes.empty())
+            return;
+
+        PacketLanes Lanes(Rays);
+        Float4 TMax = Float4::Load(OutHits.T);
+        uint32_t Leader = std::countr_zero(Active);
+        const float* Directions[3] = { Rays.Dx, Rays.Dy, Rays.Dz };
+
+        uint32_t Stack[BVH_STACK_SIZE];
+        uint32_t StackSize = 0;
+        Stack[StackSize++] = 0;
+
+        while (StackSize > 0)
+        {
+            const BvhNode& Node = Nodes[Stack[--StackSize]];
+            if (!(IntersectNode(Node, Lanes, TMax) & Active))
+                continue;
+
+            if (Node.Count > 0)
+            {
+                for (uint32_t Index = Node.LeftOrFirst; Index < Node.LeftOrFirst + Node.Count; Index++)
+                {
+                    Float4 T, U, V;
+                    uint32_t Hit = IntersectTriangle(Triangles[Index], Lanes, TMax, T, U, V) & Active;
+                    if (!Hit)
+                        continue;
+
+                    alignas(16) float HitT[PACKET_WIDTH], HitU[PACKET_WIDTH], HitV[PACKET_WIDTH];
+                    T.Store(HitT);
+                    U.Store(HitU);
+                    V.Store(HitV);
+                    while (Hit)
+                    {
+                        uint32_t Lane = std::countr_zero(Hit);
+                        Hit &= Hit - 1;
+                        OutHits.T[Lane] = HitT[Lane];
+                        OutHits.U[Lane] = HitU[Lane];
+                        OutHits.V[Lane] = HitV[Lane];
+                        OutHits.Triangle[Lane] = Index;
+                    }
+                    TMax = Float4::Load(OutHits.T);
+                }
+                continue;
+            }
+
+            // Push the far child first so the near one is visited first, by the direction of the first active ray
+            bool bNegative = Directions[Node.Axis][Leader] < 0.0f;
+            Stack[StackSize++] = Node.LeftOrFirst + (bNegative ? 0 : 1);
+            Stack[StackSize++] = Node.LeftOrFirst + (bNegative ? 1 : 0);
+        }
+
+        // Report source triangles to callers
+        for (uint32_t Lane = 0; Lane < PACKET_WIDTH; Lane++)
+        {
+            if (OutHits.Triangle[Lane] != INVALID_TRIANGLE)
+                OutHits.Triangle[Lane] = Sources[OutHits.Triangle[Lane]];
+        }
+    }
+
+    uint32_t BakeBvh::TraceOcclusion(const RayPacket& Rays, uint32_t Active) const
+    {
+        if (!Active || Nodes.empty())
+            return 0;
+
+        PacketLanes Lanes(Rays);
+        Float4 TMax = Float4::Load(Rays.TMax);
+        uint32_t Occluded = 0;
+
+        uint32_t Stack[BVH_STACK_SIZE];
+        uint32_t StackSize = 0;
+        Stack[StackSize++] = 0;
+
+        while (StackSize > 0)
+        {
+            const BvhNode& Node = Nodes[Stack[--StackSize]];
+            if (!(IntersectNode(Node, Lanes, TMax) & Active))
+                continue;
+
+            if (Node.Count > 0)
+            {
+                for (uint32_t Index = Node.LeftOrFirst; Index < Node.LeftOrFirst + Node.Count; Index++)
+                {
+                    Float4 T, U, V;
+                    uint32_t Hit = IntersectTriangle(Triangles[Index], Lanes, TMax, T, U, V) & Active;
+
+                    // Any hit will do, lanes drop out as soon as they're blocked
+                    Occluded |= Hit;
+                    Active &= ~Hit;
+                    if (!Active)
+                        return Occluded;
+                }
+                continue;
+            }
+
+            Stack[StackSize++] = Node.LeftOrFirst + 1;
+            Stack[StackSize++] = Node.LeftOrFirst;
+        }
+
+        return Occluded;
+    }
+
+    // PCG32, seeded per texel so results don't depend on which thread traced it
+    struct BakeRandom
+    {
+        uint64_t State;
+
+        BakeRandom(uint32_t Seed, uint32_t Stream)
+            : State(0)
+        {
+            mIncrement = (static_cast<uint64_t>(Stream) << 1) | 1u;
+            Next();
+            State += Seed;
+            Next();
+        }
+
+        uint32_t Next()
+        {
+            uint64_t Old = State;
+            State = Old * 6364136223846793005ull + mIncrement;
+            uint32_t Shifted = static_cast<uint32_t>(((Old >> 18u) ^ Old) >> 27u);
+            uint32_t Rotation = static_cast<uint32_t>(Old >> 59u);
+            return (Shifted >> Rotation) | (Shifted << ((32 - Rotation) & 31));
+        }
+
+        float NextFloat()
+        {
+            return (Next() >> 8) * (1.0f / 16777216.0f);
+        }
+
+    private:
+
+        uint64_t mIncrement;
+    };
+
+    // Cosine weighted direction around Normal
+    glm::vec3 SampleHemisphere(const glm::vec3& Normal, BakeRandom& Random)
+    {
+        float Phi = 2.0f * PI * Random.NextFloat();
+        float R2 = Random.NextFloat();
+        float R = std::sqrt(R2);
+
+        // Orthonormal basis without branches on the normal's direction (Duff et al. 2017)
+        float Sign = std::copysign(1.0f, Normal.z);
+        float A = -1.0f / (Sign + Normal.z);
+        float B = Normal.x * Normal.y * A;
+        glm::vec3 Tangent(1.0f + Sign * Normal.x * Normal.x * A, Sign * B, -Sign * Normal.x);
+        glm::vec3 Bitangent(B, Sign + Normal.y * Normal.y * A, -Normal.y);
+
+        return glm::normalize(Tangent * (R * std::cos(Phi)) + Bitangent * (R * std::sin(Phi)) + Normal * std::sqrt(std::max(1.0f - R2, 0.0f)));
+    }
+
+    // A texel a triangle covers, with the surface at its center
+    struct TexelSample
+    {
+        uint32_t Texel;
+        glm::vec3 Position;
+        glm::vec3 Normal;
+        glm::vec3 GeometricNormal;
+    };
+
+    // Where a triangle's corners land in the atlas, in texels
+    struct TriangleChart
+    {
+        glm::vec2 Corners[3];
+        uint32_t Width;
+        uint32_t Height;
+        uint32_t X = 0;
+        uint32_t Y = 0;
+    };
+
+    // Lays the triangle flat with its longest edge along x, so the opposite corner's projection falls on that edge
+    void FlattenTriangle(const glm::vec3* P, glm::vec2 OutCorners[3])
+    {
+        uint32_t Base = 0;
+        float Longest = -1.0f;
+        for (uint32_t Edge = 0; Edge < 3; Edge++)
+        {
+            float Length = glm::length(P[(Edge + 1) % 3] - P[Edge]);
+            if (Length > Longest)
+            {
+                Longest = Length;
+                Base = Edge;
+            }
+        }
+
+        uint32_t I0 = Base, I1 = (Base + 1) % 3, I2 = (Base + 2) % 3;
+        OutCorners[I0] = glm::vec2(0.0f);
+        OutCorners[I1] = glm::vec2(Longest, 0.0f);
+
+        if (Longest <= 0.0f)
+        {
+            OutCorners[I2] = glm::vec2(0.0f);
+            return;
+        }
+
+        glm::vec3 Axis = (P[I1] - P[I0]) / Longest;
+        glm::vec3 ToApex = P[I2] - P[I0];
+        float AlongBase = glm::dot(ToApex, Axis);
+        OutCorners[I2] = glm::vec2(AlongBase, glm::length(ToApex - Axis * AlongBase));
+    }
+
+    // Shelf packs the charts at Density texels per unit, returns the atlas height or UINT32_MAX if a chart is wider
+    // than the atlas
+    uint32_t PackCharts(std::vector<TriangleChart>& Charts, const std::vector<std::array<glm::vec2, 3>>& Flat, float Density, const LightmapBakeSettings& Settings, std::vector<uint32_t>& Order)
+    {
+        uint32_t Border = 1 + 2 * Settings.Padding;
+        for (uint32_t Tri = 0; Tri < Charts.size(); Tri++)
+        {
+            glm::vec2 Extent(0.0f);
+            for (const glm::vec2& Corner : Flat[Tri])
+                Extent = glm::max(Extent, Corner);
+
+            Charts[Tri].Width = static_cast<uint32_t>(std::ceil(Extent.x * Density)) + Border;
+            Charts[Tri].Height = static_cast<uint32_t>(std::ceil(Extent.y * Density)) + Border;
+            if (Charts[Tri].Width > Settings.AtlasWidth)
+                return std::numeric_limits<uint32_t>::max();
+        }
+
+        // Tallest first keeps the shelves full. Ties stay in index order, so packing is deterministic.
+        Order.resize(Charts.size());
+        std::iota(Order.begin(), Order.end(), 0u);
+        std::stable_sort(Order.begin(), Order.end(), [&](uint32_t A, uint32_t B)
+        {
+            return Charts[A].Height > Charts[B].Height;
+        });
+
+        uint32_t X = 0, ShelfY = 0, ShelfHeight = 0;
+        for (uint32_t Tri : Order)
+        {
+            TriangleChart& Chart = Charts[Tri];
+            if (X + Chart.Width > Settings.AtlasWidth)
+            {
+                ShelfY += ShelfHeight;
+                X = 0;
+                ShelfHeight = 0;
+            }
+
+            Chart.X = X;
+            Chart.Y = ShelfY;
+            X += Chart.Width;
+            ShelfHeight = std::max(ShelfHeight, Chart.Height);
+        }
+
+        return ShelfY + ShelfHeight;
+    }
+
+    glm::vec4 SampleAtlas(const LightmapAtlas& Atlas, glm::vec2 UV)
+    {
+        glm::vec2 Texel = UV * glm::vec2(static_cast<float>(Atlas.Width), static_cast<float>(Atlas.Height)) - glm::vec2(0.5f);
+        glm::vec2 Base = glm::floor(Texel);
+        glm::vec2 Fraction = Texel - Base;
+
+        auto Fetch = [&](int32_t X, int32_t Y)
+        {
+            X = std::clamp(X, 0, static_cast<int32_t>(Atlas.Width) - 1);
+            Y = std::clamp(Y, 0, static_cast<int32_t>(Atlas.Height) - 1);
+            return Atlas.Texels[static_cast<size_t>(Y) * Atlas.Width + X];
+        };
+
+        int32_t X = static_cast<int32_t>(Base.x), Y = static_cast<int32_t>(Base.y);
+        glm::vec4 Top = Fetch(X, Y) * (1.0f - Fraction.x) + Fetch(X + 1, Y) * Fraction.x;
+        glm::vec4 Bottom = Fetch(X, Y + 1) * (1.0f - Fraction.x) + Fetch(X + 1, Y + 1) * Fraction.x;
+        return Top * (1.0f - Fraction.y) + Bottom * Fraction.y;
+    }
+}
+
+LightmapAtlas BakeLightmaps(const std::vector<BakeMesh>& Meshes, const LightmapBakeSettings& Settings, JobSystem& Jobs, LightmapBakeStats& OutStats)
+{
+    auto BakeStart = std::chrono::high_resolution_clock::now();
+    OutStats = {};
+
+    // Gather every triangle in world space
+    std::vector<glm::vec3> Corners, CornerNormals;
+    std::vector<uint32_t> TriangleMesh;
+    for (uint32_t MeshIndex = 0; MeshIndex < Meshes.size(); MeshIndex++)
+    {
+        const BakeMesh& Mesh = Meshes[MeshIndex];
+        for (size_t Index = 0; Index + 2 < Mesh.Indices.size(); Index += 3)
+        {
+            for (uint32_t Corner = 0; Corner < 3; Corner++)
+            {
+                uint32_t Vertex = Mesh.Indices[Index + Corner];
+                Corners.push_back(Mesh.Positions[Vertex]);
+                CornerNormals.push_back(Vertex < Mesh.Normals.size() ? Mesh.Normals[Vertex] : glm::vec3(0.0f));
+            }
+            TriangleMesh.push_back(MeshIndex);
+        }
+    }
+
+    uint32_t TriangleCount = static_cast<uint32_t>(TriangleMesh.size());
+    OutStats.Triangles = TriangleCount;
+
+    std::vector<glm::vec3> GeometricNormals(TriangleCount);
+    glm::vec3 SceneMin(std::numeric_limits<float>::max()), SceneMax(-std::numeric_limits<float>::max());
+    for (uint32_t Tri = 0; Tri < TriangleCount; Tri++)
+    {
+        const glm::vec3* P = &Corners[Tri * 3];
+        glm::vec3 Cross = glm::cross(P[1] - P[0], P[2] - P[0]);
+        float Length = glm::length(Cross);
+        GeometricNormals[Tri] = Length > 0.0f ? Cross / Length : glm::vec3(0.0f, 1.0f, 0.0f);
+        SceneMin = glm::min(SceneMin, glm::min(P[0], glm::min(P[1], P[2])));
+        SceneMax = glm::max(SceneMax, glm::max(P[0], glm::max(P[1], P[2])));
+    }
+
+    // Rays leave surfaces this far out, so they don't hit what they started on
+    float Offset = TriangleCount > 0 ? std::max(glm::length(SceneMax - SceneMin) * 1e-5f, 1e-6f) : 0.0f;
+
+    // Unwrap, then lower the density until the charts fit
+    std::vector<std::array<glm::vec2, 3>> Flat(TriangleCount);
+    for (uint32_t Tri = 0; Tri < TriangleCount; Tri++)
+        FlattenTriangle(&Corners[Tri * 3], Flat[Tri].data());
+
+    std::vector<TriangleChart> Charts(TriangleCount);
+    std::vector<uint32_t> Order;
+    float Density = Settings.TexelsPerUnit;
+    uint32_t AtlasHeight = 0;
+    for (uint32_t Attempt = 0; Attempt < 32; Attempt++)
+    {
+        AtlasHeight = PackCharts(Charts, Flat, Density, Settings, Order);
+        if (AtlasHeight <= Settings.MaxAtlasHeight)
+            break;
+
+        float Scale = AtlasHeight == std::numeric_limits<uint32_t>::max() ? 0.5f : std::sqrt(static_cast<float>(Settings.MaxAtlasHeight) / AtlasHeight);
+        Density *= std::min(Scale, 0.95f);
+    }
+
+    // Charts that are all gutter can't fit whatever the density, the atlas grows past the limit rather than fail
+    if (AtlasHeight == std::numeric_limits<uint32_t>::max())
+        AtlasHeight = PackCharts(Charts, Flat, 0.0f, Settings, Order);
+    OutStats.TexelsPerUnit = Density;
+
+    LightmapAtlas Atlas;
+    Atlas.Width = Settings.AtlasWidth;
+    Atlas.Height = std::max((AtlasHeight + 3) / 4 * 4, 4u);
+    Atlas.Texels.assign(static_cast<size_t>(Atlas.Width) * Atlas.Height, glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+
+    glm::vec2 AtlasSize(static_cast<float>(Atlas.Width), static_cast<float>(Atlas.Height));
+    for (uint32_t Tri = 0; Tri < TriangleCount; Tri++)
+    {
+        TriangleChart& Chart = Charts[Tri];
+        glm::vec2 Origin(Chart.X + Settings.Padding + 0.5f, Chart.Y + Settings.Padding + 0.5f);
+        for (uint32_t Corner = 0; Corner < 3; Corner++)
+            Chart.Corners[Corner] = Origin + Flat[Tri][Corner] * Density;
+    }
+
+    Atlas.MeshUVs.resize(Meshes.size());
+    for (uint32_t Tri = 0; Tri < TriangleCount; Tri++)
+    {
+        for (uint32_t Corner = 0; Corner < 3; Corner++)
+            Atlas.MeshUVs[TriangleMesh[Tri]].push_back(Charts[Tri].Corners[Corner] / AtlasSize);
+    }
+
+    // Rasterize the charts, texels whose center is inside a triangle are traced
+    std::vector<TexelSample> Samples;
+    for (uint32_t Tri = 0; Tri < TriangleCount; Tri++)
+    {
+        const TriangleChart& Chart = Charts[Tri];
+        const glm::vec2* C = Chart.Corners;
+        const glm::vec3* P = &Corners[Tri * 3];
+        const glm::vec3* N = &CornerNormals[Tri * 3];
+
+        auto AddSample = [&](uint32_t X, uint32_t Y, float B0, float B1, float B2)
+        {
+            glm::vec3 Normal = N[0] * B0 + N[1] * B1 + N[2] * B2;
+            float Length = glm::length(Normal);
+            Normal = Length > 0.0f ? Normal / Length : GeometricNormals[Tri];
+            Samples.push_back({ Y * Atlas.Width + X, P[0] * B0 + P[1] * B1 + P[2] * B2, Normal, GeometricNormals[Tri] });
+        };
+
+        float Area = (C[1].x - C[0].x) * (C[2].y - C[0].y) - (C[2].x - C[0].x) * (C[1].y - C[0].y);
+        size_t Before = Samples.size();
+        if (std::fabs(Area) > 1e-8f)
+        {
+            for (uint32_t Y = Chart.Y; Y < Chart.Y + Chart.Height; Y++)
+            {
+                for (uint32_t X = Chart.X; X < Chart.X + Chart.Width; X++)
+                {
+                    glm::vec2 Center(X + 0.5f, Y + 0.5f);
+                    float B1 = ((Center.x - C[0].x) * (C[2].y - C[0].y) - (C[2].x - C[0].x) * (Center.y - C[0].y)) / Area;
+                    float B2 = ((C[1].x - C[0].x) * (Center.y - C[0].y) - (Center.x - C[0].x) * (C[1].y - C[0].y)) / Area;
+                    float B0 = 1.0f - B1 - B2;
+                    if (B0 >= -1e-4f && B1 >= -1e-4f && B2 >= -1e-4f)
+                        AddSample(X, Y, B0, B1, B2);
+                }
+            }
+        }
+
+        // Slivers that miss every texel center still get the texel under their centroid
+        if (Samples.size() == Before)
+        {
+            glm::vec2 Centroid = (C[0] + C[1] + C[2]) / 3.0f;
+            AddSample(static_cast<uint32_t>(Centroid.x), static_cast<uint32_t>(Centroid.y), 1.0f / 3.0f, 1.0f / 3.0f, 1.0f / 3.0f);
+        }
+    }
+    OutStats.CoveredTexels = static_cast<uint32_t>(Samples.size());
+
+    BakeBvh Bvh;
+    Bvh.Build(Corners);
+    OutStats.BvhNodes = static_cast<uint32_t>(Bvh.Nodes.size());
+
+    // Path trace every sample. Paths are traced as packets of rays leaving the same texel, which keeps the first
+    // bounce coherent.
+    uint32_t PacketsPerTexel = std::max((Settings.SamplesPerTexel + PACKET_WIDTH - 1) / PACKET_WIDTH, 1u);
+    float SampleWeight = 1.0f / (PacketsPerTexel * PACKET_WIDTH);
+    glm::vec3 SunDirection = glm::normalize(Settings.SunDirection);
+
+    std::vector<glm::vec4> Results(Samples.size());
+    std::atomic<uint64_t> RayCount{0};
+    auto TraceStart = std::chrono::high_resolution_clock::now();
+
+    Jobs.ParallelForRange(static_cast<uint32_t>(Samples.size()), 16, [&](uint32_t Begin, uint32_t End)
+    {
+        uint64_t TracedRays = 0;
+        for (uint32_t SampleIndex = Begin; SampleIndex < End; SampleIndex++)
+        {
+            const TexelSample& Sample = Samples[SampleIndex];
+            BakeRandom Random(Settings.Seed, Sample.Texel);
+
+            glm::vec3 Irradiance(0.0f);
+            uint32_t Occluded = 0;
+
+            for (uint32_t Packet = 0; Packet < PacketsPerTexel; Packet++)
+            {
+                // Texels facing away from their triangle's winding sample the side the smooth normal is on
+                glm::vec3 Facing = glm::dot(Sample.Normal, Sample.GeometricNormal) < 0.0f ? -Sample.GeometricNormal : Sample.GeometricNormal;
+
+                glm::vec3 Origins[PACKET_WIDTH], Normals[PACKET_WIDTH], Throughput[PACKET_WIDTH];
+                for (uint32_t Lane = 0; Lane < PACKET_WIDTH; Lane++)
+                {
+                    Origins[Lane] = Sample.Position + Facing * Offset;
+                    Normals[Lane] = Sample.Normal;
+                    Throughput[Lane] = glm::vec3(1.0f);
+                }
+
+                uint32_t Active = ALL_LANES;
+                for (uint32_t Bounce = 0; Bounce < Settings.Bounces && Active; Bounce++)
+                {
+                    RayPacket Rays;
+                    for (uint32_t Lane = 0; Lane < PACKET_WIDTH; Lane++)
+                    {
+                        glm::vec3 Direction = SampleHemisphere(Normals[Lane], Random);
+
+                        // Keep smooth normal samples on the outside of the surface
+                        if (Bounce == 0 && glm::dot(Direction, Facing) < 0.0f)
+                            Direction -= Facing * (2.0f * glm::dot(Direction, Facing));
+
+                        Rays.Set(Lane, Origins[Lane], Direction, RAY_FAR);
+                    }
+
+                    PacketHits Hits;
+                    Bvh.TraceClosest(Rays, Active, Hits);
+                    TracedRays += std::popcount(Active);
+
+                    if (Bounce == 0)
+                    {
+                        for (uint32_t Lane = 0; Lane < PACKET_WIDTH; Lane++)
+                            Occluded += Hits.Triangle[Lane] != INVALID_TRIANGLE && Hits.T[Lane] < Settings.AoDistance ? 1 : 0;
+                    }
+
+                    // Escaped rays see the sky, the rest pick up the sun where they land
+                    RayPacket Shadow;
+                    uint32_t Lit = 0;
+                    float SunCosine[PACKET_WIDTH] = {};
+                    for (uint32_t Lane = 0; Lane < PACKET_WIDTH; Lane++)
+                    {
+                        Shadow.Set(Lane, Origins[Lane], SunDirection, 0.0f);
+                        if (!(Active & (1u << Lane)))
+                            continue;
+
+                        if (Hits.Triangle[Lane] == INVALID_TRIANGLE)
+                        {
+                            Irradiance += Throughput[Lane] * Settings.SkyIrradiance;
+                            Active &= ~(1u << Lane);
+                            continue;
+                        }
+
+                        uint32_t Tri = Hits.Triangle[Lane];
+                        glm::vec3 Direction(Rays.Dx[Lane], Rays.Dy[Lane], Rays.Dz[Lane]);
+                        glm::vec3 HitNormal = GeometricNormals[Tri];
+                        if (glm::dot(HitNormal, Direction) > 0.0f)
+                            HitNormal = -HitNormal;
+
+                        Origins[Lane] = Origins[Lane] + Direction * Hits.T[Lane] + HitNormal * Offset;
+                        Normals[Lane] = HitNormal;
+                        Throughput[Lane] *= Meshes[TriangleMesh[Tri]].Albedo;
+
+                        SunCosine[Lane] = glm::dot(HitNormal, SunDirection);
+                        if (SunCosine[Lane] > 0.0f)
+                        {
+                            Shadow.Set(Lane, Origins[Lane], SunDirection, RAY_FAR);
+                            Lit |= 1u << Lane;
+                        }
+                    }
+
+                    uint32_t Blocked = Bvh.TraceOcclusion(Shadow, Lit);
+                    TracedRays += std::popcount(Lit);
+
+                    Lit &= ~Blocked;
+                    while (Lit)
+                    {
+                        uint32_t Lane = std::countr_zero(Lit);
+                        Lit &= Lit - 1;
+                        Irradiance += Throughput[Lane] * Settings.SunIrradiance * SunCosine[Lane];
+                    }
+                }
+            }
+
+            Results[SampleIndex] = glm::vec4(Irradiance * SampleWeight, 1.0f - Occluded * SampleWeight);
+        }
+
+        RayCount.fetch_add(TracedRays, std::memory_order_relaxed);
+    });
+
+    OutStats.TraceSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - TraceStart).count();
+    OutStats.Rays = RayCount.load();
+    OutStats.Threads = Jobs.GetThreadCount();
+    OutStats.RaysPerSecondPerCore = OutStats.TraceSeconds > 0.0 ? OutStats.Rays / OutStats.TraceSeconds / OutStats.Threads : 0.0;
+
+    // Denoise by averaging nearby samples that face the same way, wherever they ended up in the atlas. Neighbours are
+    // found through a hash grid with cells the size of the radius.
+    if (Settings.DenoiseRadius > 0.0f && !Samples.empty())
+    {
+        float Radius = Settings.DenoiseRadius;
+        float RadiusSq = Radius * Radius;
+        auto CellKey = [Radius](const glm::vec3& Position, int32_t DX, int32_t DY, int32_t DZ)
+        {
+            uint64_t X = static_cast<uint64_t>(static_cast<int64_t>(std::floor(Position.x / Radius)) + DX) & 0x1FFFFF;
+            uint64_t Y = static_cast<uint64_t>(static_cast<int64_t>(std::floor(Position.y / Radius)) + DY) & 0x1FFFFF;
+            uint64_t Z = static_cast<uint64_t>(static_cast<int64_t>(std::floor(Position.z / Radius)) + DZ) & 0x1FFFFF;
+            return X | (Y << 21) | (Z << 42);
+        };
+
+        std::unordered_map<uint64_t, std::vector<uint32_t>> Grid;
+        for (uint32_t SampleIndex = 0; SampleIndex < Samples.size(); SampleIndex++)
+            Grid[CellKey(Samples[SampleIndex].Position, 0, 0, 0)].push_back(SampleIndex);
+
+        std::vector<glm::vec4> Filtered(Samples.size());
+        Jobs.ParallelFor(static_cast<uint32_t>(Samples.size()), 64, [&](uint32_t SampleIndex)
+        {
+            const TexelSample& Sample = Samples[SampleIndex];
+            glm::vec4 Sum(0.0f);
+            float WeightSum = 0.0f;
+
+            for (int32_t DZ = -1; DZ <= 1; DZ++)
+            for (int32_t DY = -1; DY <= 1; DY++)
+            for (int32_t DX = -1; DX <= 1; DX++)
+            {
+                auto Cell = Grid.find(CellKey(Sample.Position, DX, DY, DZ));
+                if (Cell == Grid.end())
+                    continue;
+
+                for (uint32_t Other : Cell->second)
+                {
+                    glm::vec3 Delta = Samples[Other].Position - Sample.Position;
+                    float DistanceSq = glm::dot(Delta, Delta);
+                    float Alignment = glm::dot(Samples[Other].Normal, Sample.Normal);
+                    if (DistanceSq > RadiusSq || Alignment <= 0.0f)
+                        continue;
+
+                    // Falls off with distance, and sharply with the angle between normals so creases stay crisp
+                    float Alignment2 = Alignment * Alignment;
+                    float Alignment8 = Alignment2 * Alignment2 * Alignment2 * Alignment2;
+                    float Weight = (1.0f - DistanceSq / RadiusSq) * Alignment8 * Alignment8;
+                    Sum += Results[Other] * Weight;
+                    WeightSum += Weight;
+                }
+            }
+
+            // The sample itself always has full weight, so WeightSum is never zero
+            Filtered[SampleIndex] = Sum / WeightSum;
+        });
+
+        Results = std::move(Filtered);
+    }
+
+    std::vector<uint8_t> Covered(Atlas.Texels.size(), 0);
+    for (uint32_t SampleIndex = 0; SampleIndex < Samples.size(); SampleIndex++)
+    {
+        Atlas.Texels[Samples[SampleIndex].Texel] = Results[SampleIndex];
+        Covered[Samples[SampleIndex].Texel] = 1;
+    }
+
+    // Grow the charts into their gutters, one ring of texels per pass, so bilinear filtering at chart edges only
+    // reads the chart's own light
+    for (uint32_t Pass = 0; Pass < Settings.Padding + 1; Pass++)
+    {
+        std::vector<uint8_t> NextCovered = Covered;
+        std::vector<glm::vec4> Next = Atlas.Texels;
+        for (uint32_t Y = 0; Y < Atlas.Height; Y++)
+        {
+            for (uint32_t X = 0; X < Atlas.Width; X++)
+            {
+                size_t Index = static_cast<size_t>(Y) * Atlas.Width + X;
+                if (Covered[Index])
+                    continue;
+
+                glm::vec4 Sum(0.0f);
+                uint32_t Count = 0;
+                for (int32_t DY = -1; DY <= 1; DY++)
+                {
+                    for (int32_t DX = -1; DX <= 1; DX++)
+                    {
+                        int32_t NX = static_cast<int32_t>(X) + DX, NY = static_cast<int32_t>(Y) + DY;
+                        if (NX < 0 || NY < 0 || NX >= static_cast<int32_t>(Atlas.Width) || NY >= static_cast<int32_t>(Atlas.Height))
+                            continue;
+
+                        size_t Neighbour = static_cast<size_t>(NY) * Atlas.Width + NX;
+                        if (Covered[Neighbour])
+                        {
+                            Sum += Atlas.Texels[Neighbour];
+                            Count++;
+                        }
+                    }
+                }
+
+                if (Count > 0)
+                {
+                    Next[Index] = Sum / static_cast<float>(Count);
+                    NextCovered[Index] = 1;
+                }
+            }
+        }
+
+        Atlas.Texels = std::move(Next);
+        Covered = std::move(NextCovered);
+    }
+
+    OutStats.Seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - BakeStart).count();
+    return Atlas;
+}
+
+bool WriteLightmap(const std::string& Path, const LightmapAtlas& Atlas)
+{
+    std::ofstream File(Path, std::ios::binary | std::ios::trunc);
+    if (!File)
+        return false;
+
+    auto Write = [&File](const void* Data, size_t Size)
+    {
+        File.write(static_cast<const char*>(Data), static_cast<std::streamsize>(Size));
+    };
+
+    uint32_t Header[] = { LIGHTMAP_FILE_MAGIC, LIGHTMAP_FILE_VERSION, Atlas.Width, Atlas.Height, static_cast<uint32_t>(Atlas.MeshUVs.size()) };
+    Write(Header, sizeof(Header));
+
+    for (const std::vector<glm::vec2>& UVs : Atlas.MeshUVs)
+    {
+        uint32_t Count = static_cast<uint32_t>(UVs.size());
+        Write(&Count, sizeof(Count));
+        Write(UVs.data(), UVs.size() * sizeof(glm::vec2));
+    }
+
+    Write(Atlas.Texels.data(), Atlas.Texels.size() * sizeof(glm::vec4));
+    return static_cast<bool>(File);
+}
+
+bool ReadLightmap(const std::string& Path, LightmapAtlas& OutAtlas)
+{
+    std::ifstream File(Path, std::ios::binary | std::ios::ate);
+    if (!File)
+        return false;
+
+    // Sizes are checked against what's left of the file before allocating anything
+    uint64_t Remaining = static_cast<uint64_t>(File.tellg());
+    File.seekg(0);
+
+    auto Read = [&File, &Remaining](void* Data, uint64_t Size)
+    {
+        if (Size > Remaining)
+            return false;
+        Remaining -= Size;
+        File.read(static_cast<char*>(Data), static_cast<std::streamsize>(Size));
+        return static_cast<bool>(File);
+    };
+
+    uint32_t Header[5];
+    if (!Read(Header, sizeof(Header)) || Header[0] != LIGHTMAP_FILE_MAGIC || Header[1] != LIGHTMAP_FILE_VERSION)
+        return false;
+
+    // Every mesh takes at least its UV count, and the texels follow them
+    uint64_t TexelCount = static_cast<uint64_t>(Header[2]) * Header[3];
+    if (Header[4] > Remaining / sizeof(uint32_t) || TexelCount > Remaining / sizeof(glm::vec4))
+        return false;
+
+    LightmapAtlas Atlas;
+    Atlas.Width = Header[2];
+    Atlas.Height = Header[3];
+    Atlas.MeshUVs.resize(Header[4]);
+
+    for (std::vector<glm::vec2>& UVs : Atlas.MeshUVs)
+    {
+        uint32_t Count = 0;
+        if (!Read(&Count, sizeof(Count)) || Count > Remaining / sizeof(glm::vec2))
+            return false;
+
+        UVs.resize(Count);
+        if (!Read(UVs.data(), UVs.size() * sizeof(glm::vec2)))
+            return false;
+    }
+
+    if (TexelCount > Remaining / sizeof(glm::vec4))
+        return false;
+
+    Atlas.Texels.resize(TexelCount);
+    if (!Read(Atlas.Texels.data(), Atlas.Texels.size() * sizeof(glm::vec4)))
+        return false;
+
+    OutAtlas = std::move(Atlas);
+    return true;
+}
+
+std::vector<glm::vec4> ResolveLightmapToVertices(const LightmapAtlas& Atlas, uint32_t MeshIndex, std::span<const uint32_t> Indices, uint32_t VertexCount)
+{
+    if (MeshIndex >= Atlas.MeshUVs.size() || Atlas.MeshUVs[MeshIndex].size() != Indices.size() / 3 * 3 || Atlas.Texels.empty())
+        return {};
+
+    const std::vector<glm::vec2>& UVs = Atlas.MeshUVs[MeshIndex];
+    std::vector<glm::vec4> Sum(VertexCount, glm::vec4(0.0f));
+    std::vector<uint32_t> Count(VertexCount, 0);
+    for (size_t Corner = 0; Corner < UVs.size(); Corner++)
+    {
+        uint32_t Vertex = Indices[Corner];
+        if (Vertex >= VertexCount)
+            continue;
+
+        Sum[Vertex] += SampleAtlas(Atlas, UVs[Corner]);
+        Count[Vertex]++;
+    }
+
+    for (uint32_t Vertex = 0; Vertex < VertexCount; Vertex++)
+        Sum[Vertex] = Count[Vertex] ? Sum[Vertex] / static_cast<float>(Count[Vertex]) : glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+
+    return Sum;
+}
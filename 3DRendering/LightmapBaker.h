@@ -0,0 +1,92 @@
+#pragma once
+
+#include "glm/glm.hpp"
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+struct JobSystem;
+
+// Static geometry to bake, in world space
+struct BakeMesh
+{
+    std::vector<glm::vec3> Positions;
+    std::vector<glm::vec3> Normals;
+    std::vector<uint32_t> Indices;
+
+    // Diffuse reflectance bounced light picks up from this mesh
+    glm::vec3 Albedo{0.7f};
+};
+
+struct LightmapBakeSettings
+{
+    uint32_t AtlasWidth = 2048;
+    uint32_t MaxAtlasHeight = 2048;
+
+    // Texel density to aim for. Lowered until the packed charts fit in the atlas.
+    float TexelsPerUnit = 8.0f;
+
+    // Gutter around every chart, filled from the chart's edge so filtering doesn't pick up its neighbours
+    uint32_t Padding = 1;
+
+    // Rounded up to the ray packet width
+    uint32_t SamplesPerTexel = 64;
+    uint32_t Bounces = 2;
+
+    // Occluders further away than this don't count towards ambient occlusion
+    float AoDistance = 1.0f;
+
+    // Direction towards the sun, like the forward shader's directional light
+    glm::vec3 SunDirection = glm::normalize(glm::vec3(-1.0f, -1.0f, 0.0f));
+    glm::vec3 SunIrradiance{1.0f};
+
+    // Irradiance from the whole unoccluded sky
+    glm::vec3 SkyIrradiance{0.15f, 0.18f, 0.22f};
+
+    // World space radius the denoiser averages over, zero disables it
+    float DenoiseRadius = 0.25f;
+
+    uint32_t Seed = 1;
+};
+
+struct LightmapAtlas
+{
+    uint32_t Width = 0;
+    uint32_t Height = 0;
+
+    // Irradiance from bounced light and the sky in rgb, ambient occlusion in a. Direct sunlight isn't included, the
+    // renderer already lights and shadows it at runtime.
+    std::vector<glm::vec4> Texels;
+
+    // Per mesh, atlas coordinates in [0, 1] for the three corners of every triangle in index order
+    std::vector<std::vector<glm::vec2>> MeshUVs;
+};
+
+struct LightmapBakeStats
+{
+    uint32_t Triangles = 0;
+    uint32_t BvhNodes = 0;
+    uint32_t CoveredTexels = 0;
+    float TexelsPerUnit = 0.0f;
+
+    // Whole bake, and just the path tracing the ray rate is measured over
+    double Seconds = 0.0;
+    double TraceSeconds = 0.0;
+
+    uint64_t Rays = 0;
+    uint32_t Threads = 0;
+    double RaysPerSecondPerCore = 0.0;
+};
+
+// Unwraps every triangle into its own chart, packs the charts into an atlas and path traces each covered texel over a
+// BVH of all meshes with packets of rays. The result is denoised in world space and dilated into the chart gutters.
+// Texels are traced in parallel on Jobs and the result doesn't depend on how the work was split.
+LightmapAtlas BakeLightmaps(const std::vector<BakeMesh>& Meshes, const LightmapBakeSettings& Settings, JobSystem& Jobs, LightmapBakeStats& OutStats);
+
+bool WriteLightmap(const std::string& Path, const LightmapAtlas& Atlas);
+bool ReadLightmap(const std::string& Path, LightmapAtlas& OutAtlas);
+
+// Samples the atlas at the corners of every triangle of a mesh and averages them per vertex, for drawing baked light
+// without binding the atlas. Returns nothing if the atlas doesn't have a matching mesh.
+std::vector<glm::vec4> ResolveLightmapToVertices(const LightmapAtlas& Atlas, uint32_t MeshIndex, std::span<const uint32_t> Indices, uint32_t VertexCount);
@@ -0,0 +1,195 @@
+#include "MemoryTracking.h"
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+MemoryTracker gMemory;
+
+const char* GetMemoryCategoryName(MemoryCategory Category)
+{
+    switch (Category)
+    {
+    case MemoryCategory::General: return "General";
+    case MemoryCategory::Scene: return "Scene";
+    case MemoryCategory::MeshBuild: return "MeshBuild";
+    case MemoryCategory::Textures: return "Textures";
+    case MemoryCategory::Draws: return "Draws";
+    case MemoryCategory::Capture: return "Capture";
+    default: return "Unknown";
+    }
+}
+
+const char* GetGpuResourceKindName(GpuResourceKind Kind)
+{
+    switch (Kind)
+    {
+    case GpuResourceKind::VertexBuffer: return "VertexBuffer";
+    case GpuResourceKind::IndexBuffer: return "IndexBuffer";
+    case GpuResourceKind::Texture: return "Texture";
+    case GpuResourceKind::RenderTarget: return "RenderTarget";
+    default: return "Unknown";
+    }
+}
+
+void MemoryTracker::TrackGpuAllocation(GpuResourceKind Kind, const std::string& Asset, uint64_t Bytes)
+{
+    mGpu[static_cast<uint32_t>(Kind)].Add(Bytes);
+    mGpuTotal.Add(Bytes);
+
+    std::lock_guard Lock(mAssetMutex);
+    GpuAssetUsage& Usage = mGpuAssets[Asset];
+    Usage.Asset = Asset;
+    Usage.Bytes[static_cast<uint32_t>(Kind)] += Bytes;
+    Usage.TotalBytes += Bytes;
+    Usage.PeakBytes = std::max(Usage.PeakBytes, Usage.TotalBytes);
+    Usage.Resources++;
+}
+
+void MemoryTracker::TrackGpuRelease(GpuResourceKind Kind, const std::string& Asset, uint64_t Bytes)
+{
+    mGpu[static_cast<uint32_t>(Kind)].Remove(Bytes);
+    mGpuTotal.Remove(Bytes);
+
+    std::lock_guard Lock(mAssetMutex);
+    GpuAssetUsage& Usage = mGpuAssets[Asset];
+    Usage.Asset = Asset;
+    Usage.Bytes[static_cast<uint32_t>(Kind)] -= Bytes;
+    Usage.TotalBytes -= Bytes;
+    Usage.Resources--;
+}
+
+void MemoryTracker::BeginFrame()
+{
+    for (uint32_t Category = 0; Category < MEMORY_CATEGORY_COUNT; Category++)
+    {
+        uint64_t Allocations = mCpu[Category].mAllocations.load(std::memory_order_relaxed);
+
+        // The first frame also counts everything allocated during startup
+        if (mFrames > 0)
+        {
+            mFrameAllocations[Category] = Allocations - mFrameStart[Category];
+            mPeakFrameAllocations[Category] = std::max(mPeakFrameAllocations[Category], mFrameAllocations[Category]);
+        }
+        mFrameStart[Category] = Allocations;
+    }
+
+    mFrames++;
+}
+
+std::vector<GpuAssetUsage> MemoryTracker::GetGpuAssets() const
+{
+    std::vector<GpuAssetUsage> Assets;
+    {
+        std::lock_guard Lock(mAssetMutex);
+        Assets.reserve(mGpuAssets.size());
+        for (const auto& [Name, Usage] : mGpuAssets)
+            Assets.push_back(Usage);
+    }
+
+    std::sort(Assets.begin(), Assets.end(), [](const GpuAssetUsage& A, const GpuAssetUsage& B)
+    {
+        return A.TotalBytes != B.TotalBytes ? A.TotalBytes > B.TotalBytes : A.Asset < B.Asset;
+    });
+
+    return Assets;
+}
+
+static void WriteJsonString(std::ostream& Out, const std::string& Value)
+{
+    Out << '"';
+    for (char Character : Value)
+    {
+        switch (Character)
+        {
+        case '"': Out << "\\\""; break;
+        case '\\': Out << "\\\\"; break;
+        case '\n': Out << "\\n"; break;
+        case '\r': Out << "\\r"; break;
+        case '\t': Out << "\\t"; break;
+        default:
+            if (static_cast<unsigned char>(Character) < 0x20)
+            {
+                const char* Hex = "0123456789abcdef";
+                Out << "\\u00" << Hex[Character >> 4] << Hex[Character & 0xF];
+            }
+            else
+            {
+                Out << Character;
+            }
+        }
+    }
+    Out << '"';
+}
+
+static void WriteJsonCounter(std::ostream& Out, const MemoryCounter& Counter)
+{
+    Out << "{\"bytes\": " << Counter.mBytes.load(std::memory_order_relaxed)
+        << ", \"peakBytes\": " << Counter.mPeakBytes.load(std::memory_order_relaxed)
+        << ", \"allocations\": " << Counter.mAllocations.load(std::memory_order_relaxed)
+        << ", \"frees\": " << Counter.mFrees.load(std::memory_order_relaxed);
+}
+
+std::string MemoryTracker::ToJson() const
+{
+    std::ostringstream Out;
+    Out << "{\n  \"frames\": " << mFrames << ",\n";
+
+    Out << "  \"cpu\": {\n    \"total\": ";
+    WriteJsonCounter(Out, mCpuTotal);
+    Out << "},\n    \"categories\": {";
+    for (uint32_t Category = 0; Category < MEMORY_CATEGORY_COUNT; Category++)
+    {
+        Out << (Category ? ",\n      " : "\n      ");
+        WriteJsonString(Out, GetMemoryCategoryName(static_cast<MemoryCategory>(Category)));
+        Out << ": ";
+        WriteJsonCounter(Out, mCpu[Category]);
+        Out << ", \"lastFrameAllocations\": " << mFrameAllocations[Category]
+            << ", \"peakFrameAllocations\": " << mPeakFrameAllocations[Category] << "}";
+    }
+    Out << "\n    }\n  },\n";
+
+    Out << "  \"gpu\": {\n    \"total\": ";
+    WriteJsonCounter(Out, mGpuTotal);
+    Out << "},\n    \"kinds\": {";
+    for (uint32_t Kind = 0; Kind < GPU_RESOURCE_KIND_COUNT; Kind++)
+    {
+        Out << (Kind ? ",\n      " : "\n      ");
+        WriteJsonString(Out, GetGpuResourceKindName(static_cast<GpuResourceKind>(Kind)));
+        Out << ": ";
+        WriteJsonCounter(Out, mGpu[Kind]);
+        Out << "}";
+    }
+    Out << "\n    },\n    \"assets\": [";
+
+    std::vector<GpuAssetUsage> Assets = GetGpuAssets();
+    for (size_t AssetIndex = 0; AssetIndex < Assets.size(); AssetIndex++)
+    {
+        const GpuAssetUsage& Usage = Assets[AssetIndex];
+        Out << (AssetIndex ? ",\n      " : "\n      ") << "{\"asset\": ";
+        WriteJsonString(Out, Usage.Asset);
+        Out << ", \"bytes\": " << Usage.TotalBytes << ", \"peakBytes\": " << Usage.PeakBytes << ", \"resources\": " << Usage.Resources;
+        for (uint32_t Kind = 0; Kind < GPU_RESOURCE_KIND_COUNT; Kind++)
+        {
+            if (Usage.Bytes[Kind] == 0)
+                continue;
+
+            Out << ", ";
+            WriteJsonString(Out, GetGpuResourceKindName(static_cast<GpuResourceKind>(Kind)));
+            Out << ": " << Usage.Bytes[Kind];
+        }
+        Out << "}";
+    }
+    Out << "\n    ]\n  }\n}\n";
+
+    return Out.str();
+}
+
+bool MemoryTracker::WriteJson(const std::string& Path) const
+{
+    std::ofstream File(Path, std::ios::trunc);
+    if (!File)
+        return false;
+
+    File << ToJson();
+    return static_cast<bool>(File);
+}
@@ -0,0 +1,196 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+enum class MemoryCategory : uint32_t
+{
+    General,
+    Scene,
+    MeshBuild,
+    Textures,
+    Draws,
+    Capture,
+    Count
+};
+
+enum class GpuResourceKind : uint32_t
+{
+    VertexBuffer,
+    IndexBuffer,
+    Texture,
+    RenderTarget,
+    Count
+};
+
+constexpr uint32_t MEMORY_CATEGORY_COUNT = static_cast<uint32_t>(MemoryCategory::Count);
+constexpr uint32_t GPU_RESOURCE_KIND_COUNT = static_cast<uint32_t>(GpuResourceKind::Count);
+
+const char* GetMemoryCategoryName(MemoryCategory Category);
+const char* GetGpuResourceKindName(GpuResourceKind Kind);
+
+// Live bytes and their high-water mark. Safe to update from any thread.
+struct MemoryCounter
+{
+    std::atomic<uint64_t> mBytes{0};
+    std::atomic<uint64_t> mPeakBytes{0};
+    std::atomic<uint64_t> mAllocations{0};
+    std::atomic<uint64_t> mFrees{0};
+
+    void Add(uint64_t Bytes)
+    {
+        mAllocations.fetch_add(1, std::memory_order_relaxed);
+        uint64_t Now = mBytes.fetch_add(Bytes, std::memory_order_relaxed) + Bytes;
+
+        uint64_t Peak = mPeakBytes.load(std::memory_order_relaxed);
+        while (Now > Peak && !mPeakBytes.compare_exchange_weak(Peak, Now, std::memory_order_relaxed))
+        {
+        }
+    }
+
+    void Remove(uint64_t Bytes)
+    {
+        mFrees.fetch_add(1, std::memory_order_relaxed);
+        mBytes.fetch_sub(Bytes, std::memory_order_relaxed);
+    }
+
+    // Allocations minus frees, what a leak shows up in
+    uint64_t GetLiveCount() const
+    {
+        return mAllocations.load(std::memory_order_relaxed) - mFrees.load(std::memory_order_relaxed);
+    }
+};
+
+struct GpuAssetUsage
+{
+    std::string Asset;
+    std::array<uint64_t, GPU_RESOURCE_KIND_COUNT> Bytes{};
+    uint64_t TotalBytes = 0;
+    uint64_t PeakBytes = 0;
+    uint32_t Resources = 0;
+};
+
+// Tagged CPU allocation counters fed by TrackingAllocator, and GPU bytes by resource kind and by asset as reported
+// by whoever creates the resources. The render API doesn't report sizes, so GPU figures are what was requested,
+// without alignment or driver overhead.
+struct MemoryTracker
+{
+    void TrackCpuAllocation(MemoryCategory Category, uint64_t Bytes)
+    {
+        mCpu[static_cast<uint32_t>(Category)].Add(Bytes);
+        mCpuTotal.Add(Bytes);
+    }
+
+    void TrackCpuFree(MemoryCategory Category, uint64_t Bytes)
+    {
+        mCpu[static_cast<uint32_t>(Category)].Remove(Bytes);
+        mCpuTotal.Remove(Bytes);
+    }
+
+    void TrackGpuAllocation(GpuResourceKind Kind, const std::string& Asset, uint64_t Bytes);
+    void TrackGpuRelease(GpuResourceKind Kind, const std::string& Asset, uint64_t Bytes);
+
+    // Closes the allocation counts of the frame that just ended
+    void BeginFrame();
+
+    const MemoryCounter& GetCpu(MemoryCategory Category) const
+    {
+        return mCpu[static_cast<uint32_t>(Category)];
+    }
+
+    const MemoryCounter& GetGpu(GpuResourceKind Kind) const
+    {
+        return mGpu[static_cast<uint32_t>(Kind)];
+    }
+
+    const MemoryCounter& GetCpuTotal() const
+    {
+        return mCpuTotal;
+    }
+
+    const MemoryCounter& GetGpuTotal() const
+    {
+        return mGpuTotal;
+    }
+
+    // CPU allocations made during the last full frame, and the most any frame has made
+    uint64_t GetFrameAllocations(MemoryCategory Category) const
+    {
+        return mFrameAllocations[static_cast<uint32_t>(Category)];
+    }
+
+    uint64_t GetPeakFrameAllocations(MemoryCategory Category) const
+    {
+        return mPeakFrameAllocations[static_cast<uint32_t>(Category)];
+    }
+
+    // Snapshot of every asset that ever held GPU memory, largest first
+    std::vector<GpuAssetUsage> GetGpuAssets() const;
+
+    std::string ToJson() const;
+    bool WriteJson(const std::string& Path) const;
+
+private:
+
+    std::array<MemoryCounter, MEMORY_CATEGORY_COUNT> mCpu;
+    std::array<MemoryCounter, GPU_RESOURCE_KIND_COUNT> mGpu;
+    MemoryCounter mCpuTotal;
+    MemoryCounter mGpuTotal;
+
+    std::array<uint64_t, MEMORY_CATEGORY_COUNT> mFrameStart{};
+    std::array<uint64_t, MEMORY_CATEGORY_COUNT> mFrameAllocations{};
+    std::array<uint64_t, MEMORY_CATEGORY_COUNT> mPeakFrameAllocations{};
+    uint64_t mFrames = 0;
+
+    mutable std::mutex mAssetMutex;
+    std::unordered_map<std::string, GpuAssetUsage> mGpuAssets;
+};
+
+extern MemoryTracker gMemory;
+
+// Standard allocator that reports to gMemory under Category
+template<typename T, MemoryCategory Category>
+struct TrackingAllocator
+{
+    using value_type = T;
+
+    template<typename Other>
+    struct rebind
+    {
+        using other = TrackingAllocator<Other, Category>;
+    };
+
+    TrackingAllocator() = default;
+
+    template<typename Other>
+    TrackingAllocator(const TrackingAllocator<Other, Category>&)
+    {
+    }
+
+    T* allocate(size_t Count)
+    {
+        gMemory.TrackCpuAllocation(Category, Count * sizeof(T));
+        return std::allocator<T>().allocate(Count);
+    }
+
+    void deallocate(T* Memory, size_t Count)
+    {
+        gMemory.TrackCpuFree(Category, Count * sizeof(T));
+        std::allocator<T>().deallocate(Memory, Count);
+    }
+
+    template<typename Other>
+    bool operator==(const TrackingAllocator<Other, Category>&) const
+    {
+        return true;
+    }
+};
+
+template<typename T, MemoryCategory Category>
+using TrackedVector = std::vector<T, TrackingAllocator<T, Category>>;
@@ -0,0 +1,561 @@
+#include "RenderCapture.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <limits>
+
+RenderCaptureRecorder gCapture;
+
+constexpr uint32_t CAPTURE_FILE_MAGIC = 0x50414352; // "RCAP"
+constexpr uint32_t CAPTURE_FILE_VERSION = 1;
+
+// Longest label a capture file may hold, anything longer means the file is corrupt
+constexpr uint32_t MAX_CAPTURE_LABEL = 4096;
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    // Objects, values and whether there's a blob, in the order they're encoded
+    struct CaptureCallLayout
+    {
+        uint32_t ObjectCount;
+        std::array<CaptureObjectKind, 3> Kinds;
+        uint32_t ValueCount;
+        bool bHasData;
+    };
+
+    const CaptureCallLayout& GetCallLayout(CaptureCall Call)
+    {
+        using Kind = CaptureObjectKind;
+        static const CaptureCallLayout Layouts[CAPTURE_CALL_COUNT] = {
+            { 1, { Kind::SwapChain }, 2, false },                                           // BeginFrame
+            { 1, { Kind::SwapChain }, 2, false },                                           // EndFrame
+            { 1, { Kind::CommandBuffer }, 0, false },                                       // ResetCommandBuffer
+            { 1, { Kind::CommandBuffer }, 0, false },                                       // BeginCommandBuffer
+            { 1, { Kind::CommandBuffer }, 0, false },                                       // EndCommandBuffer
+            { 2, { Kind::SwapChain, Kind::CommandBuffer }, 0, false },                      // SubmitCommandBuffer
+            { 3, { Kind::CommandBuffer, Kind::RenderGraph, Kind::FrameBuffer }, 0, true },  // BeginRenderGraph
+            { 2, { Kind::CommandBuffer, Kind::SwapChain }, 0, true },                       // BeginSwapChainRenderGraph
+            { 1, { Kind::CommandBuffer }, 0, false },                                       // EndRenderGraph
+            { 2, { Kind::CommandBuffer, Kind::Pipeline }, 0, false },                       // BindPipeline
+            { 2, { Kind::CommandBuffer, Kind::ResourceSet }, 0, false },                    // BindResources
+            { 1, { Kind::CommandBuffer }, 4, false },                                       // SetViewport
+            { 1, { Kind::CommandBuffer }, 4, false },                                       // SetScissor
+            { 2, { Kind::ResourceSet, Kind::SwapChain }, 1, true },                         // UpdateUniformBuffer
+            { 3, { Kind::ResourceSet, Kind::SwapChain, Kind::FrameBuffer }, 2, false },     // UpdateAttachmentResource
+            { 2, { Kind::CommandBuffer, Kind::FrameBuffer }, 3, false },                    // TransitionAttachment
+            { 2, { Kind::CommandBuffer, Kind::VertexBuffer }, 1, false }                    // DrawVertexBufferIndexed
+        };
+        return Layouts[static_cast<uint32_t>(Call)];
+    }
+
+    uint64_t HashBytes(std::span<const uint8_t> Data)
+    {
+        uint64_t Hash = 0xcbf29ce484222325ull ^ Data.size();
+
+        size_t Offset = 0;
+        for (; Offset + sizeof(uint64_t) <= Data.size(); Offset += sizeof(uint64_t))
+        {
+            uint64_t Word;
+            std::memcpy(&Word, Data.data() + Offset, sizeof(Word));
+            Hash = (Hash ^ Word) * 0x100000001b3ull;
+            Hash ^= Hash >> 32;
+        }
+        for (; Offset < Data.size(); Offset++)
+            Hash = (Hash ^ Data[Offset]) * 0x100000001b3ull;
+
+        return Hash;
+    }
+
+    bool ReadVarint(const std::vector<uint8_t>& Stream, size_t& Offset, uint32_t& OutValue)
+    {
+        uint32_t Value = 0;
+        for (uint32_t Shift = 0; Shift < 35; Shift += 7)
+        {
+            if (Offset >= Stream.size())
+                return false;
+
+            uint8_t Byte = Stream[Offset++];
+            Value |= static_cast<uint32_t>(Byte & 0x7F) << Shift;
+            if (!(Byte & 0x80))
+            {
+                OutValue = Value;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Decodes the call at Offset and moves past it. Fails if the stream ends early or refers to objects or blobs the
+    // capture doesn't have, so once a stream decodes in full every call in it can be issued as is.
+    bool DecodeCall(const RenderCapture& Capture, size_t& Offset, CaptureCallArgs& OutArgs)
+    {
+        if (Offset >= Capture.Commands.size() || Capture.Commands[Offset] >= CAPTURE_CALL_COUNT)
+            return false;
+
+        CaptureCallArgs Args;
+        Args.Call = static_cast<CaptureCall>(Capture.Commands[Offset++]);
+        const CaptureCallLayout& Layout = GetCallLayout(Args.Call);
+
+        for (uint32_t ObjectIndex = 0; ObjectIndex < Layout.ObjectCount; ObjectIndex++)
+        {
+            CaptureObject Object;
+            if (!ReadVarint(Capture.Commands, Offset, Object) || Object >= Capture.Objects.size() || Capture.Objects[Object].Kind != Layout.Kinds[ObjectIndex])
+                return false;
+            Args.Objects[ObjectIndex] = Object;
+        }
+
+        for (uint32_t ValueIndex = 0; ValueIndex < Layout.ValueCount; ValueIndex++)
+        {
+            if (!ReadVarint(Capture.Commands, Offset, Args.Values[ValueIndex]))
+                return false;
+        }
+
+        if (Layout.bHasData)
+        {
+            uint32_t Blob;
+            if (!ReadVarint(Capture.Commands, Offset, Blob) || Blob >= Capture.Blobs.size())
+                return false;
+            Args.Data = Capture.Blobs[Blob];
+        }
+
+        OutArgs = Args;
+        return true;
+    }
+
+    std::span<const uint8_t> GetBlob(const RenderCapture& Capture, uint32_t Blob)
+    {
+        if (Blob == INVALID_CAPTURE_BLOB)
+            return {};
+        return Capture.Blobs[Blob];
+    }
+
+    // Smallest of many back to back clock reads, about what timing an empty call costs
+    double MeasureTimerOverhead()
+    {
+        double Best = std::numeric_limits<double>::max();
+        for (uint32_t Sample = 0; Sample < 1000; Sample++)
+        {
+            Clock::time_point Start = Clock::now();
+            Clock::time_point End = Clock::now();
+            Best = std::min(Best, std::chrono::duration<double>(End - Start).count());
+        }
+        return Best;
+    }
+}
+
+const char* GetCaptureCallName(CaptureCall Call)
+{
+    switch (Call)
+    {
+    case CaptureCall::BeginFrame: return "BeginFrame";
+    case CaptureCall::EndFrame: return "EndFrame";
+    case CaptureCall::ResetCommandBuffer: return "Reset";
+    case CaptureCall::BeginCommandBuffer: return "Begin";
+    case CaptureCall::EndCommandBuffer: return "End";
+    case CaptureCall::SubmitCommandBuffer: return "SubmitSwapCommandBuffer";
+    case CaptureCall::BeginRenderGraph: return "BeginRenderGraph";
+    case CaptureCall::BeginSwapChainRenderGraph: return "BeginRenderGraph (swapchain)";
+    case CaptureCall::EndRenderGraph: return "EndRenderGraph";
+    case CaptureCall::BindPipeline: return "BindPipeline";
+    case CaptureCall::BindResources: return "BindResources";
+    case CaptureCall::SetViewport: return "SetViewport";
+    case CaptureCall::SetScissor: return "SetScissor";
+    case CaptureCall::UpdateUniformBuffer: return "UpdateUniformBuffer";
+    case CaptureCall::UpdateAttachmentResource: return "UpdateAttachmentResource";
+    case CaptureCall::TransitionAttachment: return "TransitionFrameBufferColorAttachment";
+    case CaptureCall::DrawVertexBufferIndexed: return "DrawVertexBufferIndexed";
+    default: return "Unknown";
+    }
+}
+
+const char* GetCaptureObjectKindName(CaptureObjectKind Kind)
+{
+    switch (Kind)
+    {
+    case CaptureObjectKind::SwapChain: return "SwapChain";
+    case CaptureObjectKind::CommandBuffer: return "CommandBuffer";
+    case CaptureObjectKind::RenderGraph: return "RenderGraph";
+    case CaptureObjectKind::FrameBuffer: return "FrameBuffer";
+    case CaptureObjectKind::Pipeline: return "Pipeline";
+    case CaptureObjectKind::ResourceSet: return "ResourceSet";
+    case CaptureObjectKind::VertexBuffer: return "VertexBuffer";
+    default: return "Unknown";
+    }
+}
+
+uint64_t RenderCapture::GetSize() const
+{
+    uint64_t Size = sizeof(uint32_t) * 5 + sizeof(uint64_t) + Commands.size();
+    for (const CaptureObjectInfo& Object : Objects)
+        Size += sizeof(uint32_t) * 4 + Object.Label.size();
+    for (const std::vector<uint8_t>& Blob : Blobs)
+        Size += sizeof(uint64_t) + Blob.size();
+    return Size;
+}
+
+bool WriteRenderCapture(const std::string& Path, const RenderCapture& Capture)
+{
+    std::ofstream File(Path, std::ios::binary | std::ios::trunc);
+    if (!File)
+        return false;
+
+    auto Write = [&File](const void* Data, size_t Size)
+    {
+        File.write(static_cast<const char*>(Data), static_cast<std::streamsize>(Size));
+    };
+
+    uint32_t Header[] = { CAPTURE_FILE_MAGIC, CAPTURE_FILE_VERSION, Capture.Frames, static_cast<uint32_t>(Capture.Objects.size()), static_cast<uint32_t>(Capture.Blobs.size()) };
+    Write(Header, sizeof(Header));
+
+    for (const CaptureObjectInfo& Object : Capture.Objects)
+    {
+        uint32_t Fields[] = { static_cast<uint32_t>(Object.Kind), Object.VertexBlob, Object.IndexBlob, static_cast<uint32_t>(Object.Label.size()) };
+        Write(Fields, sizeof(Fields));
+        Write(Object.Label.data(), Object.Label.size());
+    }
+
+    for (const std::vector<uint8_t>& Blob : Capture.Blobs)
+    {
+        uint64_t Size = Blob.size();
+        Write(&Size, sizeof(Size));
+        Write(Blob.data(), Blob.size());
+    }
+
+    uint64_t CommandBytes = Capture.Commands.size();
+    Write(&CommandBytes, sizeof(CommandBytes));
+    Write(Capture.Commands.data(), Capture.Commands.size());
+    return static_cast<bool>(File);
+}
+
+bool ReadRenderCapture(const std::string& Path, RenderCapture& OutCapture)
+{
+    std::ifstream File(Path, std::ios::binary | std::ios::ate);
+    if (!File)
+        return false;
+
+    // Sizes are checked against what's left of the file before allocating anything
+    uint64_t Remaining = static_cast<uint64_t>(File.tellg());
+    File.seekg(0);
+
+    auto Read = [&File, &Remaining](void* Data, uint64_t Size)
+    {
+        if (Size > Remaining)
+            return false;
+        Remaining -= Size;
+        File.read(static_cast<char*>(Data), static_cast<std::streamsize>(Size));
+        return static_cast<bool>(File);
+    };
+
+    uint32_t Header[5];
+    if (!Read(Header, sizeof(Header)) || Header[0] != CAPTURE_FILE_MAGIC || Header[1] != CAPTURE_FILE_VERSION)
+        return false;
+
+    // Every object and blob takes at least its fixed fields
+    if (Header[3] > Remaining / (sizeof(uint32_t) * 4) || Header[4] > Remaining / sizeof(uint64_t))
+        return false;
+
+    RenderCapture Capture;
+    Capture.Frames = Header[2];
+    Capture.Objects.resize(Header[3]);
+    Capture.Blobs.resize(Header[4]);
+
+    for (CaptureObjectInfo& Object : Capture.Objects)
+    {
+        uint32_t Fields[4];
+        if (!Read(Fields, sizeof(Fields)) || Fields[0] >= CAPTURE_OBJECT_KIND_COUNT || Fields[3] > MAX_CAPTURE_LABEL)
+            return false;
+
+        Object.Kind = static_cast<CaptureObjectKind>(Fields[0]);
+        Object.VertexBlob = Fields[1];
+        Object.IndexBlob = Fields[2];
+        Object.Label.resize(Fields[3]);
+        if (!Read(Object.Label.data(), Object.Label.size()))
+            return false;
+    }
+
+    for (std::vector<uint8_t>& Blob : Capture.Blobs)
+    {
+        uint64_t Size = 0;
+        if (!Read(&Size, sizeof(Size)) || Size > Remaining)
+            return false;
+
+        Blob.resize(Size);
+        if (!Read(Blob.data(), Size))
+            return false;
+    }
+
+    for (const CaptureObjectInfo& Object : Capture.Objects)
+    {
+        bool bValidVertices = Object.VertexBlob == INVALID_CAPTURE_BLOB || Object.VertexBlob < Capture.Blobs.size();
+        bool bValidIndices = Object.IndexBlob == INVALID_CAPTURE_BLOB || Object.IndexBlob < Capture.Blobs.size();
+        if (!bValidVertices || !bValidIndices)
+            return false;
+    }
+
+    uint64_t CommandBytes = 0;
+    if (!Read(&CommandBytes, sizeof(CommandBytes)) || CommandBytes > Remaining)
+        return false;
+
+    Capture.Commands.resize(CommandBytes);
+    if (!Read(Capture.Commands.data(), CommandBytes))
+        return false;
+
+    OutCapture = std::move(Capture);
+    return true;
+}
+
+void RenderCaptureRecorder::NameObject(CaptureObjectKind Kind, uint64_t Key, std::string Label)
+{
+    uint32_t KindIndex = static_cast<uint32_t>(Kind);
+
+    auto Previous = mNames[KindIndex].find(Key);
+    if (Previous != mNames[KindIndex].end())
+    {
+        auto Named = mLabels[KindIndex].find(Previous->second);
+        if (Named != mLabels[KindIndex].end() && Named->second == Key)
+            mLabels[KindIndex].erase(Named);
+    }
+
+    mLabels[KindIndex][Label] = Key;
+    mNames[KindIndex][Key] = std::move(Label);
+}
+
+bool RenderCaptureRecorder::FindNamedObject(CaptureObjectKind Kind, const std::string& Label, uint64_t& OutKey) const
+{
+    const std::unordered_map<std::string, uint64_t>& Labels = mLabels[static_cast<uint32_t>(Kind)];
+
+    auto Named = Labels.find(Label);
+    if (Named == Labels.end())
+        return false;
+
+    OutKey = Named->second;
+    return true;
+}
+
+void RenderCaptureRecorder::SetBufferContents(uint64_t Key, std::span<const uint8_t> Vertices, std::span<const uint8_t> Indices)
+{
+    if (!bRetainBufferContents)
+        return;
+
+    BufferContents& Contents = mBufferContents[Key];
+    Contents.Vertices.assign(Vertices.begin(), Vertices.end());
+    Contents.Indices.assign(Indices.begin(), Indices.end());
+}
+
+void RenderCaptureRecorder::ForgetObject(CaptureObjectKind Kind, uint64_t Key)
+{
+    uint32_t KindIndex = static_cast<uint32_t>(Kind);
+
+    auto Name = mNames[KindIndex].find(Key);
+    if (Name != mNames[KindIndex].end())
+    {
+        // Another object may have taken the label since
+        auto Label = mLabels[KindIndex].find(Name->second);
+        if (Label != mLabels[KindIndex].end() && Label->second == Key)
+            mLabels[KindIndex].erase(Label);
+
+        mNames[KindIndex].erase(Name);
+    }
+
+    if (Kind == CaptureObjectKind::VertexBuffer)
+        mBufferContents.erase(Key);
+}
+
+void RenderCaptureRecorder::Start(uint32_t FrameCount)
+{
+    mCapture = {};
+    for (std::unordered_map<uint64_t, CaptureObject>& Objects : mObjects)
+        Objects.clear();
+    mObjectKeys.clear();
+    mBlobsByHash.clear();
+
+    mFrameCount = std::max(FrameCount, 1u);
+    mRecordedFrames = 0;
+    mRecordedCalls = 0;
+    mState = State::Pending;
+}
+
+void RenderCaptureRecorder::Record(CaptureCall Call, std::initializer_list<uint64_t> Keys, std::initializer_list<uint32_t> Values, std::span<const uint8_t> Data)
+{
+    // Captures only ever hold whole frames
+    if (mState == State::Pending && Call == CaptureCall::BeginFrame)
+        mState = State::Recording;
+
+    if (mState != State::Recording)
+        return;
+
+    const CaptureCallLayout& Layout = GetCallLayout(Call);
+
+    mCapture.Commands.push_back(static_cast<uint8_t>(Call));
+
+    uint32_t ObjectIndex = 0;
+    for (uint64_t Key : Keys)
+        WriteVarint(GetObject(Layout.Kinds[ObjectIndex++], Key));
+
+    for (uint32_t Value : Values)
+        WriteVarint(Value);
+
+    if (Layout.bHasData)
+        WriteVarint(AddBlob(Data));
+
+    mRecordedCalls++;
+
+    if (Call == CaptureCall::EndFrame && ++mRecordedFrames == mFrameCount)
+    {
+        // Buffers are drawn long after they were filled, their contents only join the capture now
+        for (CaptureObject Object = 0; Object < mCapture.Objects.size(); Object++)
+        {
+            CaptureObjectInfo& Info = mCapture.Objects[Object];
+            if (Info.Kind != CaptureObjectKind::VertexBuffer)
+                continue;
+
+            auto Contents = mBufferContents.find(mObjectKeys[Object]);
+            if (Contents == mBufferContents.end())
+                continue;
+
+            Info.VertexBlob = AddBlob(Contents->second.Vertices);
+            Info.IndexBlob = AddBlob(Contents->second.Indices);
+        }
+
+        mCapture.Frames = mRecordedFrames;
+        mState = State::Finished;
+    }
+}
+
+bool RenderCaptureRecorder::TakeCapture(RenderCapture& OutCapture)
+{
+    if (mState != State::Finished)
+        return false;
+
+    OutCapture = std::move(mCapture);
+    mCapture = {};
+    for (std::unordered_map<uint64_t, CaptureObject>& Objects : mObjects)
+        Objects.clear();
+    mObjectKeys.clear();
+    mBlobsByHash.clear();
+
+    mState = State::Idle;
+    return true;
+}
+
+CaptureObject RenderCaptureRecorder::GetObject(CaptureObjectKind Kind, uint64_t Key)
+{
+    uint32_t KindIndex = static_cast<uint32_t>(Kind);
+
+    auto [Found, bAdded] = mObjects[KindIndex].try_emplace(Key, static_cast<CaptureObject>(mCapture.Objects.size()));
+    if (bAdded)
+    {
+        CaptureObjectInfo& Info = mCapture.Objects.emplace_back();
+        Info.Kind = Kind;
+
+        auto Name = mNames[KindIndex].find(Key);
+        if (Name != mNames[KindIndex].end())
+            Info.Label = Name->second;
+
+        mObjectKeys.push_back(Key);
+    }
+
+    return Found->second;
+}
+
+uint32_t RenderCaptureRecorder::AddBlob(std::span<const uint8_t> Data)
+{
+    std::vector<uint32_t>& Candidates = mBlobsByHash[HashBytes(Data)];
+    for (uint32_t Blob : Candidates)
+    {
+        const std::vector<uint8_t>& Existing = mCapture.Blobs[Blob];
+        if (Existing.size() == Data.size() && std::equal(Data.begin(), Data.end(), Existing.begin()))
+            return Blob;
+    }
+
+    uint32_t Blob = static_cast<uint32_t>(mCapture.Blobs.size());
+    mCapture.Blobs.emplace_back(Data.begin(), Data.end());
+    Candidates.push_back(Blob);
+    return Blob;
+}
+
+void RenderCaptureRecorder::WriteVarint(uint32_t Value)
+{
+    while (Value >= 0x80)
+    {
+        mCapture.Commands.push_back(static_cast<uint8_t>(Value | 0x80));
+        Value >>= 7;
+    }
+    mCapture.Commands.push_back(static_cast<uint8_t>(Value));
+}
+
+CaptureReplayBackend MakeNullReplayBackend()
+{
+    CaptureReplayBackend Backend;
+    Backend.mCreateObject = [](CaptureObject, const CaptureObjectInfo&, std::span<const uint8_t>, std::span<const uint8_t>)
+    {
+        return true;
+    };
+    Backend.mIssue = [](const CaptureCallArgs&)
+    {
+    };
+    return Backend;
+}
+
+bool ReplayCapture(const RenderCapture& Capture, const CaptureReplayBackend& Backend, uint32_t Iterations, CaptureReplayStats& OutStats)
+{
+    OutStats = {};
+    if (!Backend.mIssue)
+        return false;
+
+    // Nothing is issued unless all of it can be
+    size_t Offset = 0;
+    CaptureCallArgs Args;
+    while (Offset < Capture.Commands.size())
+    {
+        if (!DecodeCall(Capture, Offset, Args))
+            return false;
+    }
+
+    Clock::time_point ReplayStart = Clock::now();
+
+    for (CaptureObject Object = 0; Object < Capture.Objects.size(); Object++)
+    {
+        const CaptureObjectInfo& Info = Capture.Objects[Object];
+        if (Backend.mCreateObject && !Backend.mCreateObject(Object, Info, GetBlob(Capture, Info.VertexBlob), GetBlob(Capture, Info.IndexBlob)))
+            return false;
+    }
+
+    Clock::time_point CreateEnd = Clock::now();
+    OutStats.CreateSeconds = std::chrono::duration<double>(CreateEnd - ReplayStart).count();
+    OutStats.TimerOverheadSeconds = MeasureTimerOverhead();
+    OutStats.FrameSeconds.reserve(static_cast<size_t>(Capture.Frames) * Iterations);
+
+    Clock::time_point IssueStart = Clock::now();
+    for (uint32_t Iteration = 0; Iteration < Iterations; Iteration++)
+    {
+        Clock::time_point FrameStart = Clock::now();
+
+        Offset = 0;
+        while (Offset < Capture.Commands.size())
+        {
+            DecodeCall(Capture, Offset, Args);
+
+            Clock::time_point CallStart = Clock::now();
+            Backend.mIssue(Args);
+            Clock::time_point CallEnd = Clock::now();
+
+            double Seconds = std::max(std::chrono::duration<double>(CallEnd - CallStart).count() - OutStats.TimerOverheadSeconds, 0.0);
+            CaptureCallTiming& Timing = OutStats.Calls[static_cast<uint32_t>(Args.Call)];
+            Timing.Count++;
+            Timing.TotalSeconds += Seconds;
+            Timing.MaxSeconds = std::max(Timing.MaxSeconds, Seconds);
+
+            if (Args.Call == CaptureCall::BeginFrame)
+                FrameStart = CallStart;
+            else if (Args.Call == CaptureCall::EndFrame)
+                OutStats.FrameSeconds.push_back(std::chrono::duration<double>(CallEnd - FrameStart).count());
+        }
+    }
+    OutStats.TotalSeconds = std::chrono::duration<double>(Clock::now() - IssueStart).count();
+
+    return true;
+}
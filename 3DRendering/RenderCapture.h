@@ -0,0 +1,223 @@
+#pragma once
+
+#include "MemoryTracking.h"
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Render API calls a capture records. Stored as a byte in the stream, so new calls only ever go at the end.
+enum class CaptureCall : uint8_t
+{
+    BeginFrame,
+    EndFrame,
+    ResetCommandBuffer,
+    BeginCommandBuffer,
+    EndCommandBuffer,
+    SubmitCommandBuffer,
+    BeginRenderGraph,
+    BeginSwapChainRenderGraph,
+    EndRenderGraph,
+    BindPipeline,
+    BindResources,
+    SetViewport,
+    SetScissor,
+    UpdateUniformBuffer,
+    UpdateAttachmentResource,
+    TransitionAttachment,
+    DrawVertexBufferIndexed,
+    Count
+};
+
+enum class CaptureObjectKind : uint8_t
+{
+    SwapChain,
+    CommandBuffer,
+    RenderGraph,
+    FrameBuffer,
+    Pipeline,
+    ResourceSet,
+    VertexBuffer,
+    Count
+};
+
+constexpr uint32_t CAPTURE_CALL_COUNT = static_cast<uint32_t>(CaptureCall::Count);
+constexpr uint32_t CAPTURE_OBJECT_KIND_COUNT = static_cast<uint32_t>(CaptureObjectKind::Count);
+
+const char* GetCaptureCallName(CaptureCall Call);
+const char* GetCaptureObjectKindName(CaptureObjectKind Kind);
+
+// Render API objects are numbered in the order a capture first saw them
+using CaptureObject = uint32_t;
+constexpr CaptureObject INVALID_CAPTURE_OBJECT = ~0u;
+constexpr uint32_t INVALID_CAPTURE_BLOB = ~0u;
+
+struct CaptureObjectInfo
+{
+    CaptureObjectKind Kind;
+
+    // What the application named the object, empty if it wasn't
+    std::string Label;
+
+    // Contents of vertex buffers, as blobs
+    uint32_t VertexBlob = INVALID_CAPTURE_BLOB;
+    uint32_t IndexBlob = INVALID_CAPTURE_BLOB;
+};
+
+// One decoded call. Which objects and values are used depends on the call:
+//   BeginFrame, EndFrame                (SwapChain) Width, Height
+//   Reset/Begin/EndCommandBuffer        (CommandBuffer)
+//   SubmitCommandBuffer                 (SwapChain, CommandBuffer)
+//   BeginRenderGraph                    (CommandBuffer, RenderGraph, FrameBuffer) pass info in Data
+//   BeginSwapChainRenderGraph           (CommandBuffer, SwapChain) pass info in Data
+//   EndRenderGraph                      (CommandBuffer)
+//   BindPipeline                        (CommandBuffer, Pipeline)
+//   BindResources                       (CommandBuffer, ResourceSet)
+//   SetViewport, SetScissor             (CommandBuffer) X, Y, Width, Height
+//   UpdateUniformBuffer                 (ResourceSet, SwapChain) Binding, contents in Data
+//   UpdateAttachmentResource            (ResourceSet, SwapChain, FrameBuffer) Attachment, Binding
+//   TransitionAttachment                (CommandBuffer, FrameBuffer) Attachment, Before, After
+//   DrawVertexBufferIndexed             (CommandBuffer, VertexBuffer) IndexCount
+struct CaptureCallArgs
+{
+    CaptureCall Call;
+    std::array<CaptureObject, 3> Objects{ INVALID_CAPTURE_OBJECT, INVALID_CAPTURE_OBJECT, INVALID_CAPTURE_OBJECT };
+    std::array<uint32_t, 4> Values{};
+    std::span<const uint8_t> Data;
+};
+
+// Frames of render API calls. Calls are packed into a byte stream of varints, and everything they upload is stored
+// once as a blob no matter how many calls uploaded the same bytes.
+struct RenderCapture
+{
+    uint32_t Frames = 0;
+    std::vector<CaptureObjectInfo> Objects;
+    std::vector<std::vector<uint8_t>> Blobs;
+    std::vector<uint8_t> Commands;
+
+    // Bytes it takes up on disk
+    uint64_t GetSize() const;
+};
+
+bool WriteRenderCapture(const std::string& Path, const RenderCapture& Capture);
+bool ReadRenderCapture(const std::string& Path, RenderCapture& OutCapture);
+
+// Records render API calls as the application makes them. Objects are told apart by opaque 64 bit keys, which the
+// application derives from its handles. Not thread safe, like the render API calls it records.
+struct RenderCaptureRecorder
+{
+    // Names an object so a replay can find its counterpart, naming the same key again renames it
+    void NameObject(CaptureObjectKind Kind, uint64_t Key, std::string Label);
+
+    // Finds the last object of a kind given Label
+    bool FindNamedObject(CaptureObjectKind Kind, const std::string& Label, uint64_t& OutKey) const;
+
+    // Keeps a copy of what was uploaded to a vertex buffer, for captures of frames that draw it later. Does nothing
+    // unless bRetainBufferContents is set, which has to happen before the buffers are created.
+    void SetBufferContents(uint64_t Key, std::span<const uint8_t> Vertices, std::span<const uint8_t> Indices);
+
+    // Drops the name and retained contents of an object the application no longer uses
+    void ForgetObject(CaptureObjectKind Kind, uint64_t Key);
+
+    // Records FrameCount frames, starting at the next BeginFrame
+    void Start(uint32_t FrameCount);
+
+    // Whether calls should be handed to Record, from Start until the last frame ended
+    bool IsActive() const
+    {
+        return mState == State::Pending || mState == State::Recording;
+    }
+
+    bool IsFinished() const
+    {
+        return mState == State::Finished;
+    }
+
+    // Keys are in the order CaptureCallArgs lists the call's objects
+    void Record(CaptureCall Call, std::initializer_list<uint64_t> Keys, std::initializer_list<uint32_t> Values = {}, std::span<const uint8_t> Data = {});
+
+    // Hands out the finished capture and goes back to idle
+    bool TakeCapture(RenderCapture& OutCapture);
+
+    // Copies of every vertex buffer double the memory geometry takes, so they're only kept when asked for. Captures
+    // taken without them can still be replayed on the null backend.
+    bool bRetainBufferContents = false;
+
+    // Stats
+    uint32_t mRecordedFrames = 0;
+    uint64_t mRecordedCalls = 0;
+
+private:
+
+    enum class State : uint8_t
+    {
+        Idle,
+        Pending,
+        Recording,
+        Finished
+    };
+
+    CaptureObject GetObject(CaptureObjectKind Kind, uint64_t Key);
+    uint32_t AddBlob(std::span<const uint8_t> Data);
+    void WriteVarint(uint32_t Value);
+
+    struct BufferContents
+    {
+        TrackedVector<uint8_t, MemoryCategory::Capture> Vertices;
+        TrackedVector<uint8_t, MemoryCategory::Capture> Indices;
+    };
+
+    State mState = State::Idle;
+    uint32_t mFrameCount = 0;
+
+    std::array<std::unordered_map<uint64_t, std::string>, CAPTURE_OBJECT_KIND_COUNT> mNames;
+    std::array<std::unordered_map<std::string, uint64_t>, CAPTURE_OBJECT_KIND_COUNT> mLabels;
+    std::unordered_map<uint64_t, BufferContents> mBufferContents;
+
+    // The capture being recorded, and the keys of its objects
+    RenderCapture mCapture;
+    std::array<std::unordered_map<uint64_t, CaptureObject>, CAPTURE_OBJECT_KIND_COUNT> mObjects;
+    std::vector<uint64_t> mObjectKeys;
+    std::unordered_map<uint64_t, std::vector<uint32_t>> mBlobsByHash;
+};
+
+extern RenderCaptureRecorder gCapture;
+
+// Where a replay sends the calls. Backends map captured objects to their own in CreateObject, which runs once per
+// object before any call is issued and can refuse objects it has no counterpart for.
+struct CaptureReplayBackend
+{
+    std::function<bool(CaptureObject Object, const CaptureObjectInfo& Info, std::span<const uint8_t> Vertices, std::span<const uint8_t> Indices)> mCreateObject;
+    std::function<void(const CaptureCallArgs& Args)> mIssue;
+};
+
+// Accepts every object and does nothing with the calls, what's left is the cost of decoding and dispatching them
+CaptureReplayBackend MakeNullReplayBackend();
+
+struct CaptureCallTiming
+{
+    uint64_t Count = 0;
+    double TotalSeconds = 0.0;
+    double MaxSeconds = 0.0;
+};
+
+struct CaptureReplayStats
+{
+    std::array<CaptureCallTiming, CAPTURE_CALL_COUNT> Calls{};
+
+    // BeginFrame to EndFrame of every replayed frame, including decoding
+    std::vector<double> FrameSeconds;
+
+    double CreateSeconds = 0.0;
+    double TotalSeconds = 0.0;
+
+    // Cost of reading the clock twice, already taken out of every call's time
+    double TimerOverheadSeconds = 0.0;
+};
+
+// Validates the whole stream, creates the objects and then issues every call Iterations times, timing each call on
+// its own. Returns false without issuing anything if the capture is malformed or the backend refused an object.
+bool ReplayCapture(const RenderCapture& Capture, const CaptureReplayBackend& Backend, uint32_t Iterations, CaptureReplayStats& OutStats);
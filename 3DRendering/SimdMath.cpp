@@ -0,0 +1,579 @@
+#include "SimdMath.h"
+#include "SimdMathKernels.h"
+#include "glm/gtc/matrix_transform.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <random>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SIMD_MATH_USE_SSE 1
+#include <emmintrin.h>
+#else
+#define SIMD_MATH_USE_SSE 0
+#endif
+
+#if SIMD_MATH_USE_SSE && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace
+{
+    struct ScalarLanes
+    {
+        using Reg = float;
+        using Mask = bool;
+        static constexpr uint32_t WIDTH = 1;
+
+        static Reg Load(const float* Src) { return *Src; }
+        static void Store(float* Dst, Reg Value) { *Dst = Value; }
+        static Reg Set1(float Value) { return Value; }
+        static Reg Add(Reg A, Reg B) { return A + B; }
+        static Reg Sub(Reg A, Reg B) { return A - B; }
+        static Reg Mul(Reg A, Reg B) { return A * B; }
+        static Reg MulAdd(Reg A, Reg B, Reg C) { return A * B + C; }
+        static Reg Div(Reg A, Reg B) { return A / B; }
+        static Reg Abs(Reg A) { return std::fabs(A); }
+        static Reg Min(Reg A, Reg B) { return std::min(A, B); }
+        static Reg Max(Reg A, Reg B) { return std::max(A, B); }
+        static Mask CmpGE(Reg A, Reg B) { return A >= B; }
+        static Mask And(Mask A, Mask B) { return A && B; }
+        static Mask AllTrue() { return true; }
+        static uint32_t MaskBits(Mask Value) { return Value ? 1 : 0; }
+    };
+
+#if SIMD_MATH_USE_SSE
+    struct Sse2Lanes
+    {
+        using Reg = __m128;
+        using Mask = __m128;
+        static constexpr uint32_t WIDTH = 4;
+
+        static Reg Load(const float* Src) { return _mm_loadu_ps(Src); }
+        static void Store(float* Dst, Reg Value) { _mm_storeu_ps(Dst, Value); }
+        static Reg Set1(float Value) { return _mm_set1_ps(Value); }
+        static Reg Add(Reg A, Reg B) { return _mm_add_ps(A, B); }
+        static Reg Sub(Reg A, Reg B) { return _mm_sub_ps(A, B); }
+        static Reg Mul(Reg A, Reg B) { return _mm_mul_ps(A, B); }
+        static Reg MulAdd(Reg A, Reg B, Reg C) { return _mm_add_ps(_mm_mul_ps(A, B), C); }
+        static Reg Div(Reg A, Reg B) { return _mm_div_ps(A, B); }
+        static Reg Abs(Reg A) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), A); }
+        static Reg Min(Reg A, Reg B) { return _mm_min_ps(A, B); }
+        static Reg Max(Reg A, Reg B) { return _mm_max_ps(A, B); }
+        static Mask CmpGE(Reg A, Reg B) { return _mm_cmpge_ps(A, B); }
+        static Mask And(Mask A, Mask B) { return _mm_and_ps(A, B); }
+        static Mask AllTrue() { return _mm_castsi128_ps(_mm_set1_epi32(-1)); }
+        static uint32_t MaskBits(Mask Value) { return static_cast<uint32_t>(_mm_movemask_ps(Value)); }
+    };
+#endif
+}
+
+SimdKernelTable GetScalarKernels()
+{
+    return SimdKernels<ScalarLanes>::MakeTable();
+}
+
+SimdKernelTable GetSse2Kernels()
+{
+#if SIMD_MATH_USE_SSE
+    return SimdKernels<Sse2Lanes>::MakeTable();
+#else
+    return {};
+#endif
+}
+
+const char* GetSimdLevelName(SimdLevel Level)
+{
+    switch (Level)
+    {
+    case SimdLevel::Scalar: return "Scalar";
+    case SimdLevel::SSE2: return "SSE2";
+    case SimdLevel::AVX2: return "AVX2";
+    }
+
+    return "Unknown";
+}
+
+static bool CpuSupportsAvx2()
+{
+#if SIMD_MATH_USE_SSE && defined(_MSC_VER)
+    int Info[4];
+    __cpuid(Info, 0);
+    if (Info[0] < 7)
+        return false;
+
+    // AVX state has to be enabled by the OS as well as present on the CPU
+    __cpuid(Info, 1);
+    bool bFma = (Info[2] & (1 << 12)) != 0;
+    bool bOsxsave = (Info[2] & (1 << 27)) != 0;
+    if (!bFma || !bOsxsave || (_xgetbv(0) & 0x6) != 0x6)
+        return false;
+
+    __cpuidex(Info, 7, 0);
+    return (Info[1] & (1 << 5)) != 0;
+#elif SIMD_MATH_USE_SSE && (defined(__GNUC__) || defined(__clang__))
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#else
+    return false;
+#endif
+}
+
+SimdLevel GetSupportedSimdLevel()
+{
+    static const SimdLevel Supported = []()
+    {
+        // The AVX2 table is empty when its translation unit wasn't built with AVX2 enabled
+        if (CpuSupportsAvx2() && GetAvx2Kernels().Multiply)
+            return SimdLevel::AVX2;
+        if (GetSse2Kernels().Multiply)
+            return SimdLevel::SSE2;
+        return SimdLevel::Scalar;
+    }();
+
+    return Supported;
+}
+
+struct SimdDispatch
+{
+    SimdLevel Level;
+    SimdKernelTable Kernels;
+};
+
+static SimdKernelTable GetKernels(SimdLevel Level)
+{
+    switch (Level)
+    {
+    case SimdLevel::AVX2: return GetAvx2Kernels();
+    case SimdLevel::SSE2: return GetSse2Kernels();
+    default: return GetScalarKernels();
+    }
+}
+
+static SimdDispatch& GetDispatch()
+{
+    static SimdDispatch Dispatch{ GetSupportedSimdLevel(), GetKernels(GetSupportedSimdLevel()) };
+    return Dispatch;
+}
+
+SimdLevel GetSimdLevel()
+{
+    return GetDispatch().Level;
+}
+
+void SetSimdLevel(SimdLevel Level)
+{
+    SimdLevel Supported = GetSupportedSimdLevel();
+    if (static_cast<uint32_t>(Level) > static_cast<uint32_t>(Supported))
+        Level = Supported;
+
+    GetDispatch() = { Level, GetKernels(Level) };
+}
+
+static uint32_t PadToBatch(uint32_t Count)
+{
+    return (Count + SIMD_BATCH_ALIGNMENT - 1) / SIMD_BATCH_ALIGNMENT * SIMD_BATCH_ALIGNMENT;
+}
+
+void Matrix4Batch::Resize(uint32_t NewCount)
+{
+    uint32_t Padded = PadToBatch(NewCount);
+    for (uint32_t Element = 0; Element < 16; Element++)
+    {
+        float Identity = (Element % 5 == 0) ? 1.0f : 0.0f;
+        Elements[Element].resize(Padded);
+        std::fill(Elements[Element].begin() + NewCount, Elements[Element].end(), Identity);
+    }
+
+    mCount = NewCount;
+}
+
+void Matrix4Batch::Set(uint32_t Index, const glm::mat4& Matrix)
+{
+    for (uint32_t Column = 0; Column < 4; Column++)
+    {
+        for (uint32_t Row = 0; Row < 4; Row++)
+            Elements[Column * 4 + Row][Index] = Matrix[Column][Row];
+    }
+}
+
+glm::mat4 Matrix4Batch::Get(uint32_t Index) const
+{
+    glm::mat4 Matrix;
+    for (uint32_t Column = 0; Column < 4; Column++)
+    {
+        for (uint32_t Row = 0; Row < 4; Row++)
+            Matrix[Column][Row] = Elements[Column * 4 + Row][Index];
+    }
+
+    return Matrix;
+}
+
+void BoundsBatch::Resize(uint32_t NewCount)
+{
+    uint32_t Padded = PadToBatch(NewCount);
+    for (std::vector<float>* Lane : { &MinX, &MinY, &MinZ, &MaxX, &MaxY, &MaxZ })
+    {
+        Lane->resize(Padded);
+        std::fill(Lane->begin() + NewCount, Lane->end(), 0.0f);
+    }
+
+    mCount = NewCount;
+}
+
+void BoundsBatch::Set(uint32_t Index, const glm::vec3& Min, const glm::vec3& Max)
+{
+    MinX[Index] = Min.x; MinY[Index] = Min.y; MinZ[Index] = Min.z;
+    MaxX[Index] = Max.x; MaxY[Index] = Max.y; MaxZ[Index] = Max.z;
+}
+
+void BoundsBatch::Get(uint32_t Index, glm::vec3& OutMin, glm::vec3& OutMax) const
+{
+    OutMin = glm::vec3(MinX[Index], MinY[Index], MinZ[Index]);
+    OutMax = glm::vec3(MaxX[Index], MaxY[Index], MaxZ[Index]);
+}
+
+void SphereBatch::Resize(uint32_t NewCount)
+{
+    uint32_t Padded = PadToBatch(NewCount);
+    for (std::vector<float>* Lane : { &X, &Y, &Z, &Radius })
+    {
+        Lane->resize(Padded);
+        std::fill(Lane->begin() + NewCount, Lane->end(), Lane == &Radius ? 1.0f : 0.0f);
+    }
+
+    mCount = NewCount;
+}
+
+void SphereBatch::Set(uint32_t Index, const glm::vec3& Center, float SphereRadius)
+{
+    X[Index] = Center.x;
+    Y[Index] = Center.y;
+    Z[Index] = Center.z;
+    Radius[Index] = SphereRadius;
+}
+
+static void GetElementPointers(const Matrix4Batch& Batch, const float* Out[16])
+{
+    for (uint32_t Element = 0; Element < 16; Element++)
+        Out[Element] = Batch.Elements[Element].data();
+}
+
+static void GetElementPointers(Matrix4Batch& Batch, float* Out[16])
+{
+    for (uint32_t Element = 0; Element < 16; Element++)
+        Out[Element] = Batch.Elements[Element].data();
+}
+
+void MultiplyMatrices(const Matrix4Batch& A, const Matrix4Batch& B, Matrix4Batch& Out)
+{
+    uint32_t Count = std::min(A.GetCount(), B.GetCount());
+    Out.Resize(Count);
+
+    const float* APtrs[16];
+    const float* BPtrs[16];
+    float* OutPtrs[16];
+    GetElementPointers(A, APtrs);
+    GetElementPointers(B, BPtrs);
+    GetElementPointers(Out, OutPtrs);
+
+    GetDispatch().Kernels.Multiply(APtrs, BPtrs, OutPtrs, PadToBatch(Count));
+}
+
+void MultiplyMatrices(const glm::mat4& A, const Matrix4Batch& B, Matrix4Batch& Out)
+{
+    uint32_t Count = B.GetCount();
+    Out.Resize(Count);
+
+    const float* BPtrs[16];
+    float* OutPtrs[16];
+    GetElementPointers(B, BPtrs);
+    GetElementPointers(Out, OutPtrs);
+
+    GetDispatch().Kernels.MultiplyUniform(&A[0][0], BPtrs, OutPtrs, PadToBatch(Count));
+}
+
+void InverseAffine(const Matrix4Batch& In, Matrix4Batch& Out)
+{
+    uint32_t Count = In.GetCount();
+    Out.Resize(Count);
+
+    const float* InPtrs[16];
+    float* OutPtrs[16];
+    GetElementPointers(In, InPtrs);
+    GetElementPointers(Out, OutPtrs);
+
+    GetDispatch().Kernels.InverseAffine(InPtrs, OutPtrs, PadToBatch(Count));
+}
+
+void TransformBounds(const Matrix4Batch& Transforms, const BoundsBatch& In, BoundsBatch& Out)
+{
+    uint32_t Count = std::min(Transforms.GetCount(), In.GetCount());
+    Out.Resize(Count);
+
+    const float* MPtrs[16];
+    GetElementPointers(Transforms, MPtrs);
+    const float* InPtrs[6] = { In.MinX.data(), In.MinY.data(), In.MinZ.data(), In.MaxX.data(), In.MaxY.data(), In.MaxZ.data() };
+    float* OutPtrs[6] = { Out.MinX.data(), Out.MinY.data(), Out.MinZ.data(), Out.MaxX.data(), Out.MaxY.data(), Out.MaxZ.data() };
+
+    GetDispatch().Kernels.TransformBounds(MPtrs, InPtrs, OutPtrs, PadToBatch(Count));
+}
+
+uint32_t TestSpheresAgainstPlanes(const SphereBatch& Spheres, const glm::vec4* Planes, uint32_t PlaneCount, uint8_t* OutInside)
+{
+    return TestSpheresAgainstPlanes(Spheres, 0, Spheres.GetCount(), Planes, PlaneCount, OutInside);
+}
+
+uint32_t TestSpheresAgainstPlanes(const SphereBatch& Spheres, uint32_t First, uint32_t Count, const glm::vec4* Planes, uint32_t PlaneCount, uint8_t* OutInside)
+{
+    if (First >= Spheres.GetCount())
+        return 0;
+    Count = std::min(Count, Spheres.GetCount() - First);
+
+    const float* SpherePtrs[4] = { Spheres.X.data() + First, Spheres.Y.data() + First, Spheres.Z.data() + First, Spheres.Radius.data() + First };
+    return GetDispatch().Kernels.TestSpheres(SpherePtrs, Planes, PlaneCount, OutInside, Count);
+}
+
+void ComputePointBounds(const glm::vec3* Points, uint32_t Count, uint32_t Stride, glm::vec3& OutMin, glm::vec3& OutMax)
+{
+    const uint8_t* Bytes = reinterpret_cast<const uint8_t*>(Points);
+    glm::vec3 Min(std::numeric_limits<float>::max());
+    glm::vec3 Max(-std::numeric_limits<float>::max());
+    uint32_t Index = 0;
+
+#if SIMD_MATH_USE_SSE
+    // Each load takes a fourth float past the point, so the last point is left to the scalar loop to avoid reading
+    // past the end. Two accumulators hide the min/max latency.
+    if (Count > 2)
+    {
+        __m128 MinA = _mm_set1_ps(Min.x), MinB = MinA;
+        __m128 MaxA = _mm_set1_ps(Max.x), MaxB = MaxA;
+
+        for (; Index + 2 < Count; Index += 2)
+        {
+            __m128 P0 = _mm_loadu_ps(reinterpret_cast<const float*>(Bytes + static_cast<size_t>(Index) * Stride));
+            __m128 P1 = _mm_loadu_ps(reinterpret_cast<const float*>(Bytes + static_cast<size_t>(Index + 1) * Stride));
+            MinA = _mm_min_ps(MinA, P0); MaxA = _mm_max_ps(MaxA, P0);
+            MinB = _mm_min_ps(MinB, P1); MaxB = _mm_max_ps(MaxB, P1);
+        }
+
+        alignas(16) float MinOut[4], MaxOut[4];
+        _mm_store_ps(MinOut, _mm_min_ps(MinA, MinB));
+        _mm_store_ps(MaxOut, _mm_max_ps(MaxA, MaxB));
+        Min = glm::vec3(MinOut[0], MinOut[1], MinOut[2]);
+        Max = glm::vec3(MaxOut[0], MaxOut[1], MaxOut[2]);
+    }
+#endif
+
+    for (; Index < Count; Index++)
+    {
+        const glm::vec3& Point = *reinterpret_cast<const glm::vec3*>(Bytes + static_cast<size_t>(Index) * Stride);
+        Min = glm::min(Min, Point);
+        Max = glm::max(Max, Point);
+    }
+
+    OutMin = Min;
+    OutMax = Max;
+}
+
+glm::mat4 MultiplyMatrix(const glm::mat4& A, const glm::mat4& B)
+{
+#if SIMD_MATH_USE_SSE
+    // Each result column is A's columns weighted by that column of B
+    const float* APtr = &A[0][0];
+    __m128 A0 = _mm_loadu_ps(APtr), A1 = _mm_loadu_ps(APtr + 4), A2 = _mm_loadu_ps(APtr + 8), A3 = _mm_loadu_ps(APtr + 12);
+
+    glm::mat4 Result;
+    for (uint32_t Column = 0; Column < 4; Column++)
+    {
+        const glm::vec4& BColumn = B[Column];
+        __m128 Sum = _mm_add_ps(
+            _mm_add_ps(_mm_mul_ps(A0, _mm_set1_ps(BColumn.x)), _mm_mul_ps(A1, _mm_set1_ps(BColumn.y))),
+            _mm_add_ps(_mm_mul_ps(A2, _mm_set1_ps(BColumn.z)), _mm_mul_ps(A3, _mm_set1_ps(BColumn.w))));
+        _mm_storeu_ps(&Result[Column][0], Sum);
+    }
+
+    return Result;
+#else
+    return A * B;
+#endif
+}
+
+glm::mat4 InverseAffine(const glm::mat4& Transform)
+{
+    glm::vec3 C0(Transform[0]), C1(Transform[1]), C2(Transform[2]), T(Transform[3]);
+
+    glm::vec3 R0 = glm::cross(C1, C2);
+    glm::vec3 R1 = glm::cross(C2, C0);
+    glm::vec3 R2 = glm::cross(C0, C1);
+
+    float InvDet = 1.0f / glm::dot(C0, R0);
+    R0 *= InvDet;
+    R1 *= InvDet;
+    R2 *= InvDet;
+
+    return glm::mat4(
+        glm::vec4(R0.x, R1.x, R2.x, 0.0f),
+        glm::vec4(R0.y, R1.y, R2.y, 0.0f),
+        glm::vec4(R0.z, R1.z, R2.z, 0.0f),
+        glm::vec4(-glm::dot(R0, T), -glm::dot(R1, T), -glm::dot(R2, T), 1.0f));
+}
+
+static glm::mat4 RandomAffine(std::mt19937& Rng)
+{
+    std::uniform_real_distribution<float> Offset(-100.0f, 100.0f);
+    std::uniform_real_distribution<float> Angle(0.0f, 6.2831853f);
+    std::uniform_real_distribution<float> Scale(0.5f, 2.0f);
+
+    glm::vec3 Axis = glm::normalize(glm::vec3(Offset(Rng), Offset(Rng), Offset(Rng)) + glm::vec3(0.0f, 0.0f, 1e-3f));
+    glm::mat4 Transform = glm::translate(glm::mat4(1.0f), glm::vec3(Offset(Rng), Offset(Rng), Offset(Rng)));
+    Transform = glm::rotate(Transform, Angle(Rng), Axis);
+    return glm::scale(Transform, glm::vec3(Scale(Rng), Scale(Rng), Scale(Rng)));
+}
+
+// Best time of Iterations runs, in nanoseconds per element
+template<typename Fn>
+static double TimeBest(uint32_t Count, uint32_t Iterations, Fn&& Run)
+{
+    double Best = std::numeric_limits<double>::max();
+    for (uint32_t Iteration = 0; Iteration < Iterations; Iteration++)
+    {
+        auto Start = std::chrono::high_resolution_clock::now();
+        Run();
+        double Ns = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now() - Start).count());
+        Best = std::min(Best, Ns / std::max(Count, 1u));
+    }
+
+    return Best;
+}
+
+std::vector<SimdMathBenchmark> RunSimdMathBenchmarks(uint32_t Count, uint32_t Iterations)
+{
+    std::mt19937 Rng(1234);
+    std::uniform_real_distribution<float> Coord(-200.0f, 200.0f);
+    std::uniform_real_distribution<float> Size(0.1f, 10.0f);
+
+    std::vector<glm::mat4> Transforms(Count), Others(Count), Results(Count);
+    std::vector<glm::vec3> Mins(Count), Maxs(Count);
+    std::vector<glm::vec4> Spheres(Count);
+    Matrix4Batch TransformBatch, OtherBatch, ResultBatch;
+    BoundsBatch Bounds, BoundsOut;
+    SphereBatch SphereData;
+    TransformBatch.Resize(Count);
+    OtherBatch.Resize(Count);
+    Bounds.Resize(Count);
+    SphereData.Resize(Count);
+
+    for (uint32_t Index = 0; Index < Count; Index++)
+    {
+        Transforms[Index] = RandomAffine(Rng);
+        Others[Index] = RandomAffine(Rng);
+        TransformBatch.Set(Index, Transforms[Index]);
+        OtherBatch.Set(Index, Others[Index]);
+
+        glm::vec3 Center(Coord(Rng), Coord(Rng), Coord(Rng));
+        glm::vec3 Extent(Size(Rng), Size(Rng), Size(Rng));
+        Mins[Index] = Center - Extent;
+        Maxs[Index] = Center + Extent;
+        Bounds.Set(Index, Mins[Index], Maxs[Index]);
+
+        Spheres[Index] = glm::vec4(Center, Size(Rng));
+        SphereData.Set(Index, Center, Spheres[Index].w);
+    }
+
+    glm::mat4 ViewProjection = glm::perspective(glm::radians(70.0f), 16.0f / 9.0f, 0.1f, 500.0f);
+    glm::vec4 Planes[6];
+    {
+        // Inward facing planes of the view projection, as Gribb and Hartmann extract them
+        for (uint32_t Axis = 0; Axis < 3; Axis++)
+        {
+            glm::vec4 Row(ViewProjection[0][Axis], ViewProjection[1][Axis], ViewProjection[2][Axis], ViewProjection[3][Axis]);
+            glm::vec4 W(ViewProjection[0][3], ViewProjection[1][3], ViewProjection[2][3], ViewProjection[3][3]);
+            Planes[Axis * 2] = W + Row;
+            Planes[Axis * 2 + 1] = W - Row;
+        }
+    }
+
+    std::vector<uint8_t> Inside(Count);
+    volatile float Sink = 0.0f;
+
+    struct Baseline
+    {
+        const char* Name;
+        double Ns;
+    };
+
+    // glm one element at a time, the way the code did this before the batch kernels
+    Baseline Baselines[] =
+    {
+        { "Multiply", TimeBest(Count, Iterations, [&]()
+        {
+            for (uint32_t Index = 0; Index < Count; Index++)
+                Results[Index] = Transforms[Index] * Others[Index];
+            Sink = Results[Count / 2][3][0];
+        }) },
+        { "MultiplyUniform", TimeBest(Count, Iterations, [&]()
+        {
+            for (uint32_t Index = 0; Index < Count; Index++)
+                Results[Index] = ViewProjection * Transforms[Index];
+            Sink = Results[Count / 2][3][0];
+        }) },
+        { "InverseAffine", TimeBest(Count, Iterations, [&]()
+        {
+            for (uint32_t Index = 0; Index < Count; Index++)
+                Results[Index] = glm::inverse(Transforms[Index]);
+            Sink = Results[Count / 2][3][0];
+        }) },
+        { "TransformBounds", TimeBest(Count, Iterations, [&]()
+        {
+            float Total = 0.0f;
+            for (uint32_t Index = 0; Index < Count; Index++)
+            {
+                glm::vec3 Min(std::numeric_limits<float>::max()), Max(-std::numeric_limits<float>::max());
+                for (uint32_t Corner = 0; Corner < 8; Corner++)
+                {
+                    glm::vec3 Local((Corner & 1) ? Maxs[Index].x : Mins[Index].x, (Corner & 2) ? Maxs[Index].y : Mins[Index].y, (Corner & 4) ? Maxs[Index].z : Mins[Index].z);
+                    glm::vec3 World(Transforms[Index] * glm::vec4(Local, 1.0f));
+                    Min = glm::min(Min, World);
+                    Max = glm::max(Max, World);
+                }
+                Total += Min.x + Max.y;
+            }
+            Sink = Total;
+        }) },
+        { "SpherePlanes", TimeBest(Count, Iterations, [&]()
+        {
+            for (uint32_t Index = 0; Index < Count; Index++)
+            {
+                bool bInside = true;
+                for (const glm::vec4& Plane : Planes)
+                    bInside = bInside && glm::dot(glm::vec3(Plane), glm::vec3(Spheres[Index])) + Plane.w >= -Spheres[Index].w;
+                Inside[Index] = bInside ? 1 : 0;
+            }
+            Sink = Inside[Count / 2];
+        }) },
+    };
+
+    std::vector<SimdMathBenchmark> Benchmarks;
+    SimdLevel Previous = GetSimdLevel();
+    for (uint32_t LevelIndex = 0; LevelIndex <= static_cast<uint32_t>(GetSupportedSimdLevel()); LevelIndex++)
+    {
+        SimdLevel Level = static_cast<SimdLevel>(LevelIndex);
+        SetSimdLevel(Level);
+
+        double Timings[] =
+        {
+            TimeBest(Count, Iterations, [&]() { MultiplyMatrices(TransformBatch, OtherBatch, ResultBatch); }),
+            TimeBest(Count, Iterations, [&]() { MultiplyMatrices(ViewProjection, TransformBatch, ResultBatch); }),
+            TimeBest(Count, Iterations, [&]() { InverseAffine(TransformBatch, ResultBatch); }),
+            TimeBest(Count, Iterations, [&]() { TransformBounds(TransformBatch, Bounds, BoundsOut); }),
+            TimeBest(Count, Iterations, [&]() { Sink = static_cast<float>(TestSpheresAgainstPlanes(SphereData, Planes, 6, Inside.data())); }),
+        };
+
+        for (uint32_t Kernel = 0; Kernel < std::size(Timings); Kernel++)
+            Benchmarks.push_back({ Baselines[Kernel].Name, Level, Timings[Kernel], Baselines[Kernel].Ns / std::max(Timings[Kernel], 1e-3) });
+    }
+
+    SetSimdLevel(Previous);
+    return Benchmarks;
+}
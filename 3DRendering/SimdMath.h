@@ -0,0 +1,125 @@
+#pragma once
+
+#include "glm/glm.hpp"
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Batches are padded to this many elements so kernels never need a scalar tail. Padding lanes hold identity
+// matrices, zero sized bounds and unit spheres at the origin, so they stay finite through every kernel.
+constexpr uint32_t SIMD_BATCH_ALIGNMENT = 8;
+
+enum class SimdLevel : uint32_t
+{
+    Scalar,
+    SSE2,
+    AVX2
+};
+
+const char* GetSimdLevelName(SimdLevel Level);
+
+// Best level the CPU supports, detected once
+SimdLevel GetSupportedSimdLevel();
+
+// Level the batch kernels dispatch to. Defaults to the supported level, lowering it is for comparing paths.
+SimdLevel GetSimdLevel();
+void SetSimdLevel(SimdLevel Level);
+
+// Many 4x4 matrices stored element major. Elements[Column * 4 + Row] holds that element of every matrix, which keeps
+// glm's column major indexing.
+struct Matrix4Batch
+{
+    std::array<std::vector<float>, 16> Elements;
+
+    void Resize(uint32_t NewCount);
+    void Set(uint32_t Index, const glm::mat4& Matrix);
+    glm::mat4 Get(uint32_t Index) const;
+
+    uint32_t GetCount() const
+    {
+        return mCount;
+    }
+
+private:
+
+    uint32_t mCount = 0;
+};
+
+struct BoundsBatch
+{
+    std::vector<float> MinX, MinY, MinZ;
+    std::vector<float> MaxX, MaxY, MaxZ;
+
+    void Resize(uint32_t NewCount);
+    void Set(uint32_t Index, const glm::vec3& Min, const glm::vec3& Max);
+    void Get(uint32_t Index, glm::vec3& OutMin, glm::vec3& OutMax) const;
+
+    uint32_t GetCount() const
+    {
+        return mCount;
+    }
+
+private:
+
+    uint32_t mCount = 0;
+};
+
+struct SphereBatch
+{
+    std::vector<float> X, Y, Z, Radius;
+
+    void Resize(uint32_t NewCount);
+    void Set(uint32_t Index, const glm::vec3& Center, float SphereRadius);
+
+    uint32_t GetCount() const
+    {
+        return mCount;
+    }
+
+private:
+
+    uint32_t mCount = 0;
+};
+
+// Out[i] = A[i] * B[i]. Out may alias either input.
+void MultiplyMatrices(const Matrix4Batch& A, const Matrix4Batch& B, Matrix4Batch& Out);
+
+// Out[i] = A * B[i], e.g. a view projection applied to every world transform
+void MultiplyMatrices(const glm::mat4& A, const Matrix4Batch& B, Matrix4Batch& Out);
+
+// Inverts transforms whose last row is (0, 0, 0, 1), which is cheaper than a general inverse. Singular matrices
+// come out as garbage, like they would from glm::inverse. Out may alias In.
+void InverseAffine(const Matrix4Batch& In, Matrix4Batch& Out);
+
+// Axis aligned bounds of each box after its transform, which must be affine. Out may alias In.
+void TransformBounds(const Matrix4Batch& Transforms, const BoundsBatch& In, BoundsBatch& Out);
+
+// OutInside[i] is 1 if sphere i is on the inner side of, or touching, every plane. Planes are (normal, distance)
+// with the normal pointing inwards. Returns the number of spheres inside.
+uint32_t TestSpheresAgainstPlanes(const SphereBatch& Spheres, const glm::vec4* Planes, uint32_t PlaneCount, uint8_t* OutInside);
+
+// Same as above over spheres [First, First + Count), with OutInside[0] for sphere First. First must be a multiple of
+// SIMD_BATCH_ALIGNMENT so the last load stays within the padding, which lets threads test disjoint ranges of a batch.
+uint32_t TestSpheresAgainstPlanes(const SphereBatch& Spheres, uint32_t First, uint32_t Count, const glm::vec4* Planes, uint32_t PlaneCount, uint8_t* OutInside);
+
+// Bounds of Count points spaced Stride bytes apart
+void ComputePointBounds(const glm::vec3* Points, uint32_t Count, uint32_t Stride, glm::vec3& OutMin, glm::vec3& OutMax);
+
+// Single matrix helpers, with no dispatch overhead
+glm::mat4 MultiplyMatrix(const glm::mat4& A, const glm::mat4& B);
+glm::mat4 InverseAffine(const glm::mat4& Transform);
+
+struct SimdMathBenchmark
+{
+    std::string Name;
+    SimdLevel Level;
+    double NsPerElement;
+
+    // Against the glm baseline of the same operation
+    double Speedup;
+};
+
+// Times every kernel at each supported level against the same work done one element at a time through glm, and
+// leaves the dispatch level at what it was.
+std::vector<SimdMathBenchmark> RunSimdMathBenchmarks(uint32_t Count, uint32_t Iterations);
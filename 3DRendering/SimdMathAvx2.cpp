@@ -0,0 +1,44 @@
+// Built with AVX2 and FMA enabled, see CMakeLists.txt. Nothing here may run before GetSupportedSimdLevel has checked
+// the CPU, so this file only hands out its kernel table.
+#include "SimdMathKernels.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+
+namespace
+{
+    struct Avx2Lanes
+    {
+        using Reg = __m256;
+        using Mask = __m256;
+        static constexpr uint32_t WIDTH = 8;
+
+        static Reg Load(const float* Src) { return _mm256_loadu_ps(Src); }
+        static void Store(float* Dst, Reg Value) { _mm256_storeu_ps(Dst, Value); }
+        static Reg Set1(float Value) { return _mm256_set1_ps(Value); }
+        static Reg Add(Reg A, Reg B) { return _mm256_add_ps(A, B); }
+        static Reg Sub(Reg A, Reg B) { return _mm256_sub_ps(A, B); }
+        static Reg Mul(Reg A, Reg B) { return _mm256_mul_ps(A, B); }
+        static Reg MulAdd(Reg A, Reg B, Reg C) { return _mm256_fmadd_ps(A, B, C); }
+        static Reg Div(Reg A, Reg B) { return _mm256_div_ps(A, B); }
+        static Reg Abs(Reg A) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), A); }
+        static Reg Min(Reg A, Reg B) { return _mm256_min_ps(A, B); }
+        static Reg Max(Reg A, Reg B) { return _mm256_max_ps(A, B); }
+        static Mask CmpGE(Reg A, Reg B) { return _mm256_cmp_ps(A, B, _CMP_GE_OQ); }
+        static Mask And(Mask A, Mask B) { return _mm256_and_ps(A, B); }
+        static Mask AllTrue() { return _mm256_castsi256_ps(_mm256_set1_epi32(-1)); }
+        static uint32_t MaskBits(Mask Value) { return static_cast<uint32_t>(_mm256_movemask_ps(Value)); }
+    };
+}
+
+SimdKernelTable GetAvx2Kernels()
+{
+    return SimdKernels<Avx2Lanes>::MakeTable();
+}
+#else
+// Not built for AVX2, dispatch stays on SSE2
+SimdKernelTable GetAvx2Kernels()
+{
+    return {};
+}
+#endif
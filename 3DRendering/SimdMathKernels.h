@@ -0,0 +1,184 @@
+#pragma once
+
+// Batch kernels written once against a lane type, and instantiated by each instruction set's translation unit with
+// its own lane type. Lane types live in anonymous namespaces, which gives every instantiation internal linkage, so
+// code built for AVX2 can't be merged into the SSE2 or scalar paths by the linker.
+//
+// A lane type provides Reg and Mask, WIDTH, Load, Store, Set1, Add, Sub, Mul, MulAdd, Div, Abs, Min, Max, CmpGE,
+// And, AllTrue and MaskBits.
+
+#include "glm/glm.hpp"
+#include <cstdint>
+
+struct SimdKernelTable
+{
+    void (*Multiply)(const float* const A[16], const float* const B[16], float* const Out[16], uint32_t Count);
+    void (*MultiplyUniform)(const float A[16], const float* const B[16], float* const Out[16], uint32_t Count);
+    void (*InverseAffine)(const float* const In[16], float* const Out[16], uint32_t Count);
+    void (*TransformBounds)(const float* const M[16], const float* const In[6], float* const Out[6], uint32_t Count);
+    uint32_t (*TestSpheres)(const float* const Spheres[4], const glm::vec4* Planes, uint32_t PlaneCount, uint8_t* OutInside, uint32_t Count);
+};
+
+SimdKernelTable GetScalarKernels();
+SimdKernelTable GetSse2Kernels();
+SimdKernelTable GetAvx2Kernels();
+
+// Counts passed to the kernels are padded to SIMD_BATCH_ALIGNMENT, except for TestSpheres which only writes the
+// first Count results
+template<typename L>
+struct SimdKernels
+{
+    using Reg = typename L::Reg;
+
+    static void Multiply(const float* const A[16], const float* const B[16], float* const Out[16], uint32_t Count)
+    {
+        for (uint32_t Base = 0; Base < Count; Base += L::WIDTH)
+        {
+            Reg ARegs[16], BRegs[16];
+            for (uint32_t Element = 0; Element < 16; Element++)
+            {
+                ARegs[Element] = L::Load(A[Element] + Base);
+                BRegs[Element] = L::Load(B[Element] + Base);
+            }
+
+            StoreProduct(ARegs, BRegs, Out, Base);
+        }
+    }
+
+    static void MultiplyUniform(const float A[16], const float* const B[16], float* const Out[16], uint32_t Count)
+    {
+        Reg ARegs[16];
+        for (uint32_t Element = 0; Element < 16; Element++)
+            ARegs[Element] = L::Set1(A[Element]);
+
+        for (uint32_t Base = 0; Base < Count; Base += L::WIDTH)
+        {
+            Reg BRegs[16];
+            for (uint32_t Element = 0; Element < 16; Element++)
+                BRegs[Element] = L::Load(B[Element] + Base);
+
+            StoreProduct(ARegs, BRegs, Out, Base);
+        }
+    }
+
+    static void InverseAffine(const float* const In[16], float* const Out[16], uint32_t Count)
+    {
+        for (uint32_t Base = 0; Base < Count; Base += L::WIDTH)
+        {
+            Reg C0x = L::Load(In[0] + Base), C0y = L::Load(In[1] + Base), C0z = L::Load(In[2] + Base);
+            Reg C1x = L::Load(In[4] + Base), C1y = L::Load(In[5] + Base), C1z = L::Load(In[6] + Base);
+            Reg C2x = L::Load(In[8] + Base), C2y = L::Load(In[9] + Base), C2z = L::Load(In[10] + Base);
+            Reg Tx = L::Load(In[12] + Base), Ty = L::Load(In[13] + Base), Tz = L::Load(In[14] + Base);
+
+            // Rows of the inverse are the cross products of pairs of columns, over the determinant
+            Reg R0x = L::Sub(L::Mul(C1y, C2z), L::Mul(C1z, C2y));
+            Reg R0y = L::Sub(L::Mul(C1z, C2x), L::Mul(C1x, C2z));
+            Reg R0z = L::Sub(L::Mul(C1x, C2y), L::Mul(C1y, C2x));
+            Reg R1x = L::Sub(L::Mul(C2y, C0z), L::Mul(C2z, C0y));
+            Reg R1y = L::Sub(L::Mul(C2z, C0x), L::Mul(C2x, C0z));
+            Reg R1z = L::Sub(L::Mul(C2x, C0y), L::Mul(C2y, C0x));
+            Reg R2x = L::Sub(L::Mul(C0y, C1z), L::Mul(C0z, C1y));
+            Reg R2y = L::Sub(L::Mul(C0z, C1x), L::Mul(C0x, C1z));
+            Reg R2z = L::Sub(L::Mul(C0x, C1y), L::Mul(C0y, C1x));
+
+            Reg InvDet = L::Div(L::Set1(1.0f), L::MulAdd(C0x, R0x, L::MulAdd(C0y, R0y, L::Mul(C0z, R0z))));
+            R0x = L::Mul(R0x, InvDet); R0y = L::Mul(R0y, InvDet); R0z = L::Mul(R0z, InvDet);
+            R1x = L::Mul(R1x, InvDet); R1y = L::Mul(R1y, InvDet); R1z = L::Mul(R1z, InvDet);
+            R2x = L::Mul(R2x, InvDet); R2y = L::Mul(R2y, InvDet); R2z = L::Mul(R2z, InvDet);
+
+            Reg Zero = L::Set1(0.0f);
+            L::Store(Out[0] + Base, R0x); L::Store(Out[1] + Base, R1x); L::Store(Out[2] + Base, R2x); L::Store(Out[3] + Base, Zero);
+            L::Store(Out[4] + Base, R0y); L::Store(Out[5] + Base, R1y); L::Store(Out[6] + Base, R2y); L::Store(Out[7] + Base, Zero);
+            L::Store(Out[8] + Base, R0z); L::Store(Out[9] + Base, R1z); L::Store(Out[10] + Base, R2z); L::Store(Out[11] + Base, Zero);
+
+            // Translation is minus the inverse applied to the old translation
+            L::Store(Out[12] + Base, L::Sub(Zero, L::MulAdd(R0x, Tx, L::MulAdd(R0y, Ty, L::Mul(R0z, Tz)))));
+            L::Store(Out[13] + Base, L::Sub(Zero, L::MulAdd(R1x, Tx, L::MulAdd(R1y, Ty, L::Mul(R1z, Tz)))));
+            L::Store(Out[14] + Base, L::Sub(Zero, L::MulAdd(R2x, Tx, L::MulAdd(R2y, Ty, L::Mul(R2z, Tz)))));
+            L::Store(Out[15] + Base, L::Set1(1.0f));
+        }
+    }
+
+    static void TransformBounds(const float* const M[16], const float* const In[6], float* const Out[6], uint32_t Count)
+    {
+        Reg Half = L::Set1(0.5f);
+        for (uint32_t Base = 0; Base < Count; Base += L::WIDTH)
+        {
+            Reg Center[3], Extent[3];
+            for (uint32_t Axis = 0; Axis < 3; Axis++)
+            {
+                Reg Min = L::Load(In[Axis] + Base);
+                Reg Max = L::Load(In[Axis + 3] + Base);
+                Center[Axis] = L::Mul(L::Add(Min, Max), Half);
+                Extent[Axis] = L::Mul(L::Sub(Max, Min), Half);
+            }
+
+            // The new extent along each axis is the old extents projected onto it, through the absolute rotation
+            for (uint32_t Row = 0; Row < 3; Row++)
+            {
+                Reg M0 = L::Load(M[Row] + Base), M1 = L::Load(M[4 + Row] + Base), M2 = L::Load(M[8 + Row] + Base);
+                Reg NewCenter = L::MulAdd(M0, Center[0], L::MulAdd(M1, Center[1], L::MulAdd(M2, Center[2], L::Load(M[12 + Row] + Base))));
+                Reg NewExtent = L::MulAdd(L::Abs(M0), Extent[0], L::MulAdd(L::Abs(M1), Extent[1], L::Mul(L::Abs(M2), Extent[2])));
+
+                L::Store(Out[Row] + Base, L::Sub(NewCenter, NewExtent));
+                L::Store(Out[Row + 3] + Base, L::Add(NewCenter, NewExtent));
+            }
+        }
+    }
+
+    static uint32_t TestSpheres(const float* const Spheres[4], const glm::vec4* Planes, uint32_t PlaneCount, uint8_t* OutInside, uint32_t Count)
+    {
+        uint32_t Inside = 0;
+        for (uint32_t Base = 0; Base < Count; Base += L::WIDTH)
+        {
+            Reg X = L::Load(Spheres[0] + Base), Y = L::Load(Spheres[1] + Base), Z = L::Load(Spheres[2] + Base);
+            Reg NegRadius = L::Sub(L::Set1(0.0f), L::Load(Spheres[3] + Base));
+
+            typename L::Mask bInside = L::AllTrue();
+            for (uint32_t PlaneIndex = 0; PlaneIndex < PlaneCount; PlaneIndex++)
+            {
+                const glm::vec4& Plane = Planes[PlaneIndex];
+                Reg Distance = L::MulAdd(L::Set1(Plane.x), X, L::MulAdd(L::Set1(Plane.y), Y, L::MulAdd(L::Set1(Plane.z), Z, L::Set1(Plane.w))));
+                bInside = L::And(bInside, L::CmpGE(Distance, NegRadius));
+            }
+
+            uint32_t Bits = L::MaskBits(bInside);
+            uint32_t Valid = Count - Base < L::WIDTH ? Count - Base : L::WIDTH;
+            for (uint32_t Lane = 0; Lane < Valid; Lane++)
+            {
+                uint8_t bLaneInside = (Bits >> Lane) & 1;
+                OutInside[Base + Lane] = bLaneInside;
+                Inside += bLaneInside;
+            }
+        }
+
+        return Inside;
+    }
+
+    static SimdKernelTable MakeTable()
+    {
+        return { &Multiply, &MultiplyUniform, &InverseAffine, &TransformBounds, &TestSpheres };
+    }
+
+private:
+
+    // (A * B)[Column][Row] = sum over K of A[K][Row] * B[Column][K]. Everything is computed before storing, so Out may
+    // alias A or B.
+    static void StoreProduct(const Reg A[16], const Reg B[16], float* const Out[16], uint32_t Base)
+    {
+        Reg Result[16];
+        for (uint32_t Column = 0; Column < 4; Column++)
+        {
+            for (uint32_t Row = 0; Row < 4; Row++)
+            {
+                Result[Column * 4 + Row] = L::MulAdd(A[Row], B[Column * 4],
+                    L::MulAdd(A[4 + Row], B[Column * 4 + 1],
+                    L::MulAdd(A[8 + Row], B[Column * 4 + 2],
+                    L::Mul(A[12 + Row], B[Column * 4 + 3]))));
+            }
+        }
+
+        for (uint32_t Element = 0; Element < 16; Element++)
+            L::Store(Out[Element] + Base, Result[Element]);
+    }
+};
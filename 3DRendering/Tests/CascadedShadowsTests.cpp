@@ -0,0 +1,168 @@
+#include "../CascadedShadows.h"
+#include "TestChecks.h"
+#include "glm/gtc/matrix_transform.hpp"
+#include <cstring>
+
+// Fits cascades on the CPU and checks snapping, caster culling and when cached cascades get redrawn. Returns
+// non-zero if any check failed.
+
+static const float FieldOfView = 1.0472f;
+static const float Aspect = 16.0f / 9.0f;
+static const float NearClip = 0.1f;
+static const float FarClip = 1000.0f;
+static const glm::vec3 LightDirection = glm::normalize(glm::vec3(0.3f, -1.0f, 0.2f));
+
+static glm::mat4 CameraAt(glm::vec3 Position)
+{
+    return glm::translate(glm::mat4(1.0f), Position);
+}
+
+static float GetTexelSize(const CascadedShadowMap& Map, const ShadowCascade& Cascade)
+{
+    return 2.0f * Cascade.Radius / Map.mSettings.Resolution;
+}
+
+static bool IsWholeTexels(float Value, float TexelSize)
+{
+    float Texels = Value / TexelSize;
+    return std::abs(Texels - std::round(Texels)) < 1e-2f;
+}
+
+static void TestSplitsCoverTheShadowDistance()
+{
+    std::array<float, SHADOW_CASCADE_COUNT> Splits = ComputeCascadeSplits(NearClip, FarClip, 0.75f);
+    CHECK(Splits[0] > NearClip);
+    for (uint32_t Cascade = 1; Cascade < SHADOW_CASCADE_COUNT; Cascade++)
+        CHECK(Splits[Cascade] > Splits[Cascade - 1]);
+    CHECK_NEAR(Splits[SHADOW_CASCADE_COUNT - 1], FarClip, 1e-2f);
+}
+
+static void TestStableUnderSubTexelMotion()
+{
+    std::vector<ShadowCaster> Casters = { { glm::vec3(-1.0f, 0.0f, -11.0f), glm::vec3(1.0f, 2.0f, -9.0f) } };
+    glm::vec3 Position(3.0f, 2.0f, 5.0f);
+
+    CascadedShadowMap Map;
+    Map.Update(CameraAt(Position), FieldOfView, Aspect, NearClip, FarClip, LightDirection, Casters, 1);
+    CHECK(Map.mRedrawnCascades == SHADOW_CASCADE_COUNT);
+
+    std::array<ShadowCascade, SHADOW_CASCADE_COUNT> First = Map.mCascades;
+    for (const ShadowCascade& Cascade : First)
+    {
+        float TexelSize = GetTexelSize(Map, Cascade);
+        CHECK(IsWholeTexels(Cascade.LightSpaceCenter.x, TexelSize));
+        CHECK(IsWholeTexels(Cascade.LightSpaceCenter.y, TexelSize));
+    }
+
+    // A quarter texel of the smallest cascade keeps every cascade where it was, matrices included
+    glm::vec3 Nudge(GetTexelSize(Map, First[0]) * 0.25f, 0.0f, 0.0f);
+    Map.Update(CameraAt(Position + Nudge), FieldOfView, Aspect, NearClip, FarClip, LightDirection, Casters, 1);
+    CHECK(Map.mRedrawnCascades == 0);
+    CHECK(Map.mCachedCascades == SHADOW_CASCADE_COUNT);
+    CHECK(Map.GetDrawCount() == 0);
+    for (uint32_t CascadeIndex = 0; CascadeIndex < SHADOW_CASCADE_COUNT; CascadeIndex++)
+        CHECK(std::memcmp(&Map.mCascades[CascadeIndex].ViewProjection, &First[CascadeIndex].ViewProjection, sizeof(glm::mat4)) == 0);
+
+    // Forcing a refit after the same motion can only move the cascades by whole texels, never by a fraction of one
+    Map.Invalidate();
+    Map.Update(CameraAt(Position + Nudge), FieldOfView, Aspect, NearClip, FarClip, LightDirection, Casters, 1);
+    for (uint32_t CascadeIndex = 0; CascadeIndex < SHADOW_CASCADE_COUNT; CascadeIndex++)
+    {
+        const ShadowCascade& Cascade = Map.mCascades[CascadeIndex];
+        float TexelSize = GetTexelSize(Map, Cascade);
+        glm::vec3 Moved = Cascade.LightSpaceCenter - First[CascadeIndex].LightSpaceCenter;
+
+        CHECK(Cascade.Radius == First[CascadeIndex].Radius);
+        CHECK(IsWholeTexels(Moved.x, TexelSize));
+        CHECK(IsWholeTexels(Moved.y, TexelSize));
+        CHECK(std::abs(Moved.x) <= TexelSize * 1.01f);
+        CHECK(std::abs(Moved.y) <= TexelSize * 1.01f);
+    }
+}
+
+static void TestKeepsCastersTowardsTheLight()
+{
+    // Light travelling down -z has no rotation, so light depth is -z and the light is on the +z side
+    glm::mat4 LightRotation = CreateLightRotation(glm::vec3(0.0f, 0.0f, -1.0f));
+    glm::vec2 ReceiverMin(-10.0f), ReceiverMax(10.0f);
+    float ReceiverNear = 0.0f, ReceiverFar = 20.0f;
+
+    std::vector<ShadowCaster> Casters = {
+        { glm::vec3(-1.0f, -1.0f, -6.0f), glm::vec3(1.0f, 1.0f, -4.0f) },   // Inside the receivers
+        { glm::vec3(-1.0f, -1.0f, 50.0f), glm::vec3(1.0f, 1.0f, 52.0f) },   // Outside, between them and the light
+        { glm::vec3(-1.0f, -1.0f, -60.0f), glm::vec3(1.0f, 1.0f, -58.0f) }, // Beyond the far side
+        { glm::vec3(30.0f, -1.0f, -6.0f), glm::vec3(32.0f, 1.0f, -4.0f) },  // Beside the receivers
+        { glm::vec3(9.0f, -1.0f, 50.0f), glm::vec3(12.0f, 1.0f, 52.0f) },   // Overlapping an edge, towards the light
+    };
+
+    std::vector<uint32_t> Kept;
+    float NearestDepth = CullShadowCasters(LightRotation, ReceiverMin, ReceiverMax, ReceiverNear, ReceiverFar, Casters, Kept);
+    CHECK((Kept == std::vector<uint32_t>{ 0, 1, 4 }));
+    CHECK_NEAR(NearestDepth, -52.0f, 1e-4f);
+
+    // Through a full update with the light straight down, a caster high above the first cascade still lands in it
+    // and pulls its near plane up, while one far below is dropped
+    glm::mat4 Camera = CameraAt(glm::vec3(0.0f, 2.0f, 0.0f));
+    CascadedShadowMap Map;
+    float FirstSplit = ComputeCascadeSplits(NearClip, FarClip, Map.mSettings.SplitLambda)[0];
+    glm::vec3 SliceCenter = glm::vec3(ComputeFrustumSliceSphere(Camera, FieldOfView, Aspect, NearClip, FirstSplit));
+
+    std::vector<ShadowCaster> Overhead = {
+        { glm::vec3(SliceCenter.x - 1.0f, 499.0f, SliceCenter.z - 1.0f), glm::vec3(SliceCenter.x + 1.0f, 501.0f, SliceCenter.z + 1.0f) },
+        { glm::vec3(SliceCenter.x - 1.0f, -501.0f, SliceCenter.z - 1.0f), glm::vec3(SliceCenter.x + 1.0f, -499.0f, SliceCenter.z + 1.0f) },
+    };
+    Map.Update(Camera, FieldOfView, Aspect, NearClip, FarClip, glm::vec3(0.0f, -1.0f, 0.0f), Overhead, 1);
+    CHECK((Map.mCascades[0].Casters == std::vector<uint32_t>{ 0 }));
+    CHECK(Map.mCascades[0].NearDepth <= -500.0f);
+}
+
+static void TestRedrawsOnlyWhenInputsChange()
+{
+    std::vector<ShadowCaster> Casters = {
+        { glm::vec3(-1.0f, 0.0f, -11.0f), glm::vec3(1.0f, 2.0f, -9.0f) },
+        { glm::vec3(4.0f, 0.0f, -31.0f), glm::vec3(6.0f, 8.0f, -29.0f) },
+    };
+    glm::mat4 Camera = CameraAt(glm::vec3(0.0f, 2.0f, 0.0f));
+
+    CascadedShadowMap Map;
+    Map.Update(Camera, FieldOfView, Aspect, NearClip, FarClip, LightDirection, Casters, 1);
+    CHECK(Map.mRedrawnCascades == SHADOW_CASCADE_COUNT);
+    CHECK(Map.GetDrawCount() > 0);
+
+    // Same light, camera and casters
+    Map.Update(Camera, FieldOfView, Aspect, NearClip, FarClip, LightDirection, Casters, 1);
+    CHECK(Map.mRedrawnCascades == 0);
+    CHECK(Map.mCachedCascades == SHADOW_CASCADE_COUNT);
+    CHECK(Map.GetDrawCount() == 0);
+
+    // Moved casters are announced with a new scene version, which redraws every cascade even though the fit stays
+    Casters[1].BoundsMin.y += 1.0f;
+    Casters[1].BoundsMax.y += 1.0f;
+    std::array<ShadowCascade, SHADOW_CASCADE_COUNT> Before = Map.mCascades;
+    Map.Update(Camera, FieldOfView, Aspect, NearClip, FarClip, LightDirection, Casters, 2);
+    CHECK(Map.mRedrawnCascades == SHADOW_CASCADE_COUNT);
+    for (uint32_t CascadeIndex = 0; CascadeIndex < SHADOW_CASCADE_COUNT; CascadeIndex++)
+        CHECK(Map.mCascades[CascadeIndex].LightSpaceCenter == Before[CascadeIndex].LightSpaceCenter);
+
+    Map.Update(Camera, FieldOfView, Aspect, NearClip, FarClip, LightDirection, Casters, 2);
+    CHECK(Map.mRedrawnCascades == 0);
+
+    // A new light direction refits and redraws everything
+    Map.Update(Camera, FieldOfView, Aspect, NearClip, FarClip, glm::normalize(glm::vec3(-0.3f, -1.0f, 0.2f)), Casters, 2);
+    CHECK(Map.mRedrawnCascades == SHADOW_CASCADE_COUNT);
+
+    // As does invalidating, for when the shadow maps were recreated
+    Map.Invalidate();
+    Map.Update(Camera, FieldOfView, Aspect, NearClip, FarClip, glm::normalize(glm::vec3(-0.3f, -1.0f, 0.2f)), Casters, 2);
+    CHECK(Map.mRedrawnCascades == SHADOW_CASCADE_COUNT);
+}
+
+int main()
+{
+    TestSplitsCoverTheShadowDistance();
+    TestStableUnderSubTexelMotion();
+    TestKeepsCastersTowardsTheLight();
+    TestRedrawsOnlyWhenInputsChange();
+
+    return ReportChecks("cascaded shadow");
+}
@@ -0,0 +1,243 @@
+#include "../FrameGraph.h"
+#include "TestChecks.h"
+
+// Compiles small graphs on the CPU and checks culling, ordering, barriers and aliasing. Returns non-zero if any
+// check failed.
+
+static const FrameGraphTextureDesc ColorDesc{ 1920, 1080, 1, 4 };
+static const FrameGraphTextureDesc DepthDesc{ 1920, 1080, 2, 4 };
+
+static void TestCullsUnreadProducers()
+{
+    FrameGraph Graph;
+    FrameGraphResource Swap = Graph.ImportTexture("Swap", FrameGraphState::Undefined, FrameGraphState::ShaderRead);
+    FrameGraphResource Unused = Graph.CreateTexture("Unused", ColorDesc);
+    FrameGraphResource Color = Graph.CreateTexture("Color", ColorDesc);
+
+    uint32_t Dead = Graph.AddPass("Dead", nullptr);
+    Graph.Write(Dead, Unused, FrameGraphState::ColorAttachment);
+
+    uint32_t Scene = Graph.AddPass("Scene", nullptr);
+    Graph.Write(Scene, Color, FrameGraphState::ColorAttachment);
+
+    uint32_t Final = Graph.AddPass("Final", nullptr);
+    Graph.Read(Final, Color);
+    Graph.Write(Final, Swap, FrameGraphState::ColorAttachment);
+
+    CHECK(Graph.Compile());
+    CHECK(Graph.IsPassCulled(Dead));
+    CHECK(!Graph.IsPassCulled(Scene));
+    CHECK(!Graph.IsPassCulled(Final));
+    CHECK(Graph.mCulledPasses == 1);
+}
+
+static void TestCullsChainsThroughPassesWithoutWrites()
+{
+    FrameGraph Graph;
+    FrameGraphResource Swap = Graph.ImportTexture("Swap", FrameGraphState::Undefined, FrameGraphState::ShaderRead);
+    FrameGraphResource Debug = Graph.CreateTexture("Debug", ColorDesc);
+    FrameGraphResource Color = Graph.CreateTexture("Color", ColorDesc);
+
+    // Producer only feeds a pass that writes nothing, so both go
+    uint32_t Producer = Graph.AddPass("Producer", nullptr);
+    Graph.Write(Producer, Debug, FrameGraphState::ColorAttachment);
+
+    uint32_t Consumer = Graph.AddPass("Consumer", nullptr);
+    Graph.Read(Consumer, Debug);
+
+    uint32_t Scene = Graph.AddPass("Scene", nullptr);
+    Graph.Write(Scene, Color, FrameGraphState::ColorAttachment);
+
+    uint32_t Final = Graph.AddPass("Final", nullptr);
+    Graph.Read(Final, Color);
+    Graph.Write(Final, Swap, FrameGraphState::ColorAttachment);
+
+    Graph.Compile();
+    CHECK(Graph.IsPassCulled(Consumer));
+    CHECK(Graph.IsPassCulled(Producer));
+    CHECK(!Graph.IsPassCulled(Scene));
+    CHECK(Graph.mCulledPasses == 2);
+
+    // With side effects the consumer and everything it reads stay
+    FrameGraph SideEffects;
+    FrameGraphResource Target = SideEffects.CreateTexture("Target", ColorDesc);
+    uint32_t Writer = SideEffects.AddPass("Writer", nullptr);
+    SideEffects.Write(Writer, Target, FrameGraphState::ColorAttachment);
+    uint32_t Readback = SideEffects.AddPass("Readback", nullptr, true);
+    SideEffects.Read(Readback, Target);
+
+    SideEffects.Compile();
+    CHECK(!SideEffects.IsPassCulled(Writer));
+    CHECK(!SideEffects.IsPassCulled(Readback));
+}
+
+static void TestKeepsWritersOfImportedResources()
+{
+    FrameGraph Graph;
+    FrameGraphResource Kept = Graph.ImportTexture("Kept", FrameGraphState::Undefined, FrameGraphState::ShaderRead);
+    FrameGraphResource Scratch = Graph.ImportTexture("Scratch", FrameGraphState::Undefined, FrameGraphState::Undefined);
+
+    uint32_t WritesKept = Graph.AddPass("WritesKept", nullptr);
+    Graph.Write(WritesKept, Kept, FrameGraphState::ColorAttachment);
+
+    uint32_t WritesScratch = Graph.AddPass("WritesScratch", nullptr);
+    Graph.Write(WritesScratch, Scratch, FrameGraphState::ColorAttachment);
+
+    Graph.Compile();
+    CHECK(!Graph.IsPassCulled(WritesKept));
+    CHECK(Graph.IsPassCulled(WritesScratch));
+}
+
+static void TestRunsPassesInOrder()
+{
+    FrameGraph Graph;
+    FrameGraphResource Swap = Graph.ImportTexture("Swap", FrameGraphState::Undefined, FrameGraphState::ShaderRead);
+    FrameGraphResource Shadow = Graph.CreateTexture("Shadow", DepthDesc);
+    FrameGraphResource Unused = Graph.CreateTexture("Unused", ColorDesc);
+
+    std::vector<uint32_t> Ran;
+    uint32_t ShadowPass = Graph.AddPass("Shadow", [&]() { Ran.push_back(0); });
+    Graph.Write(ShadowPass, Shadow, FrameGraphState::DepthStencilAttachment);
+
+    uint32_t DeadPass = Graph.AddPass("Dead", [&]() { Ran.push_back(1); });
+    Graph.Write(DeadPass, Unused, FrameGraphState::ColorAttachment);
+
+    uint32_t FinalPass = Graph.AddPass("Final", [&]() { Ran.push_back(2); });
+    Graph.Read(FinalPass, Shadow);
+    Graph.Write(FinalPass, Swap, FrameGraphState::ColorAttachment);
+
+    Graph.Execute([](const FrameGraphBarrier&) {});
+    CHECK((Ran == std::vector<uint32_t>{ 0, 2 }));
+
+    const std::vector<FrameGraphCompiledPass>& Schedule = Graph.GetSchedule();
+    CHECK(Schedule.size() == 2);
+    CHECK(Schedule.size() == 2 && Schedule[0].Pass == ShadowPass && Schedule[1].Pass == FinalPass);
+
+    // Executing again reuses the compiled graph until something changes
+    CHECK(!Graph.Compile());
+    CHECK(Graph.mCompileCount == 1);
+    Graph.SetTextureDesc(Shadow, DepthDesc);
+    CHECK(!Graph.Compile());
+    Graph.SetTextureDesc(Shadow, { 1024, 1024, 2, 4 });
+    CHECK(Graph.Compile());
+    CHECK(Graph.mCompileCount == 2);
+}
+
+static bool HasBarrier(const std::vector<FrameGraphBarrier>& Barriers, FrameGraphResource Resource, FrameGraphState Before, FrameGraphState After)
+{
+    for (const FrameGraphBarrier& Barrier : Barriers)
+    {
+        if (Barrier.Resource == Resource && Barrier.Before == Before && Barrier.After == After)
+            return true;
+    }
+    return false;
+}
+
+static void TestBuildsBarriers()
+{
+    FrameGraph Graph;
+    FrameGraphResource Swap = Graph.ImportTexture("Swap", FrameGraphState::Undefined, FrameGraphState::ShaderRead);
+    FrameGraphResource Shadow = Graph.CreateTexture("Shadow", DepthDesc);
+    FrameGraphResource Color = Graph.CreateTexture("Color", ColorDesc);
+
+    uint32_t ShadowPass = Graph.AddPass("Shadow", nullptr);
+    Graph.Write(ShadowPass, Shadow, FrameGraphState::DepthStencilAttachment);
+
+    uint32_t Scene = Graph.AddPass("Scene", nullptr);
+    Graph.Read(Scene, Shadow);
+    Graph.Write(Scene, Color, FrameGraphState::ColorAttachment);
+
+    // Reads the shadow map again in the state it's already in, so no barrier
+    uint32_t Final = Graph.AddPass("Final", nullptr);
+    Graph.Read(Final, Color);
+    Graph.Read(Final, Shadow);
+    Graph.Write(Final, Swap, FrameGraphState::ColorAttachment);
+
+    Graph.Compile();
+    const std::vector<FrameGraphCompiledPass>& Schedule = Graph.GetSchedule();
+    CHECK(Schedule.size() == 3);
+    if (Schedule.size() != 3)
+        return;
+
+    CHECK(Schedule[0].Barriers.size() == 1);
+    CHECK(HasBarrier(Schedule[0].Barriers, Shadow, FrameGraphState::Undefined, FrameGraphState::DepthStencilAttachment));
+
+    CHECK(Schedule[1].Barriers.size() == 2);
+    CHECK(HasBarrier(Schedule[1].Barriers, Shadow, FrameGraphState::DepthStencilAttachment, FrameGraphState::ShaderRead));
+    CHECK(HasBarrier(Schedule[1].Barriers, Color, FrameGraphState::Undefined, FrameGraphState::ColorAttachment));
+
+    CHECK(Schedule[2].Barriers.size() == 2);
+    CHECK(HasBarrier(Schedule[2].Barriers, Color, FrameGraphState::ColorAttachment, FrameGraphState::ShaderRead));
+    CHECK(HasBarrier(Schedule[2].Barriers, Swap, FrameGraphState::Undefined, FrameGraphState::ColorAttachment));
+
+    // The final transition of the imported swapchain image comes after every pass
+    std::vector<FrameGraphBarrier> Applied;
+    Graph.Execute([&](const FrameGraphBarrier& Barrier) { Applied.push_back(Barrier); });
+    CHECK(Applied.size() == 6);
+    CHECK(!Applied.empty() && Applied.back().Resource == Swap && Applied.back().Before == FrameGraphState::ColorAttachment && Applied.back().After == FrameGraphState::ShaderRead);
+}
+
+static void TestAliasesTransients()
+{
+    FrameGraph Graph;
+    FrameGraphResource Swap = Graph.ImportTexture("Swap", FrameGraphState::Undefined, FrameGraphState::ShaderRead);
+    FrameGraphResource A = Graph.CreateTexture("A", ColorDesc);
+    FrameGraphResource B = Graph.CreateTexture("B", ColorDesc);
+    FrameGraphResource C = Graph.CreateTexture("C", ColorDesc);
+    FrameGraphResource Depth = Graph.CreateTexture("Depth", DepthDesc);
+
+    // A lives over passes 0-1, B over 1-2 and C over 2-3, so A and C can share memory but B overlaps both. Depth
+    // is free by the time C is created but has a different format.
+    uint32_t Pass0 = Graph.AddPass("0", nullptr);
+    Graph.Write(Pass0, A, FrameGraphState::ColorAttachment);
+    Graph.Write(Pass0, Depth, FrameGraphState::DepthStencilAttachment);
+
+    uint32_t Pass1 = Graph.AddPass("1", nullptr);
+    Graph.Read(Pass1, A);
+    Graph.Read(Pass1, Depth);
+    Graph.Write(Pass1, B, FrameGraphState::ColorAttachment);
+
+    uint32_t Pass2 = Graph.AddPass("2", nullptr);
+    Graph.Read(Pass2, B);
+    Graph.Write(Pass2, C, FrameGraphState::ColorAttachment);
+
+    uint32_t Pass3 = Graph.AddPass("3", nullptr);
+    Graph.Read(Pass3, C);
+    Graph.Write(Pass3, Swap, FrameGraphState::ColorAttachment);
+
+    Graph.Compile();
+    CHECK(Graph.GetPhysicalSlot(A) == Graph.GetPhysicalSlot(C));
+    CHECK(Graph.GetPhysicalSlot(A) != Graph.GetPhysicalSlot(B));
+    CHECK(Graph.GetPhysicalSlot(Depth) != Graph.GetPhysicalSlot(C));
+    CHECK(Graph.GetPhysicalSlotCount() == 3);
+    CHECK(Graph.GetPhysicalSlotDesc(Graph.GetPhysicalSlot(Depth)) == DepthDesc);
+
+    CHECK(Graph.mTransientBytes == ColorDesc.GetSize() * 3 + DepthDesc.GetSize());
+    CHECK(Graph.mAliasedBytes == ColorDesc.GetSize() * 2 + DepthDesc.GetSize());
+
+    // Culled passes don't extend lifetimes or take slots
+    FrameGraph Culled;
+    FrameGraphResource Out = Culled.ImportTexture("Out", FrameGraphState::Undefined, FrameGraphState::ShaderRead);
+    FrameGraphResource Dead = Culled.CreateTexture("Dead", ColorDesc);
+    uint32_t DeadPass = Culled.AddPass("Dead", nullptr);
+    Culled.Write(DeadPass, Dead, FrameGraphState::ColorAttachment);
+    uint32_t LivePass = Culled.AddPass("Live", nullptr);
+    Culled.Write(LivePass, Out, FrameGraphState::ColorAttachment);
+
+    Culled.Compile();
+    CHECK(Culled.GetPhysicalSlot(Dead) == ~0u);
+    CHECK(Culled.GetPhysicalSlotCount() == 0);
+    CHECK(Culled.mTransientBytes == 0);
+}
+
+int main()
+{
+    TestCullsUnreadProducers();
+    TestCullsChainsThroughPassesWithoutWrites();
+    TestKeepsWritersOfImportedResources();
+    TestRunsPassesInOrder();
+    TestBuildsBarriers();
+    TestAliasesTransients();
+
+    return ReportChecks("frame graph");
+}
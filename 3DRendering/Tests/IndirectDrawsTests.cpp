@@ -0,0 +1,178 @@
+#include "../IndirectDraws.h"
+#include "../JobSystem.h"
+#include "TestChecks.h"
+#include "glm/gtc/matrix_transform.hpp"
+#include <cstring>
+
+// Builds indirect draws on the CPU and checks grouping, ordering, culling and that the output doesn't depend on how
+// the work was split. Returns non-zero if any check failed.
+
+// Camera at the origin looking down -z
+static DrawView MakeView()
+{
+    DrawView View;
+    View.ViewProjection = glm::perspective(glm::radians(60.0f), 1.0f, 0.1f, 100.0f);
+    View.PixelsPerUnit = 1000.0f / (2.0f * std::tan(glm::radians(60.0f) * 0.5f));
+    return View;
+}
+
+static DrawSource MakeSource(glm::vec3 Center, float HalfExtent, uint32_t PipelineIndex, std::array<float, MAX_DRAW_LODS> MinScreenSizes)
+{
+    DrawSource Source;
+    Source.BoundsMin = Center - glm::vec3(HalfExtent);
+    Source.BoundsMax = Center + glm::vec3(HalfExtent);
+    Source.PipelineIndex = PipelineIndex;
+    Source.MaterialIndex = PipelineIndex + 10;
+    Source.LodCount = MAX_DRAW_LODS;
+    for (uint32_t Lod = 0; Lod < MAX_DRAW_LODS; Lod++)
+        Source.Lods[Lod] = { Lod * 1000, 300u >> Lod, static_cast<int32_t>(Lod * 100), MinScreenSizes[Lod] };
+    return Source;
+}
+
+// Every pipeline's draws are contiguous, in pipeline order and in source order, and every command points at its own
+// per draw data
+static void CheckLayout(const IndirectDrawBuilder& Builder, const std::vector<DrawSource>& Sources, uint32_t PipelineCount)
+{
+    CHECK(Builder.mPipelineFirst.size() == PipelineCount);
+    CHECK(Builder.mPipelineCount.size() == PipelineCount);
+    CHECK(Builder.mCommands.size() == Builder.mDrawData.size());
+
+    uint32_t Expected = 0;
+    for (uint32_t PipelineIndex = 0; PipelineIndex < PipelineCount; PipelineIndex++)
+    {
+        CHECK(Builder.mPipelineFirst[PipelineIndex] == Expected);
+        for (uint32_t DrawIndex = Expected; DrawIndex < Expected + Builder.mPipelineCount[PipelineIndex]; DrawIndex++)
+        {
+            const DrawInstanceData& Data = Builder.mDrawData[DrawIndex];
+            CHECK(Sources[Data.SourceIndex].PipelineIndex == PipelineIndex);
+            if (DrawIndex > Expected)
+                CHECK(Data.SourceIndex > Builder.mDrawData[DrawIndex - 1].SourceIndex);
+        }
+        Expected += Builder.mPipelineCount[PipelineIndex];
+    }
+    CHECK(Expected == Builder.mCommands.size());
+
+    for (uint32_t DrawIndex = 0; DrawIndex < Builder.mCommands.size(); DrawIndex++)
+    {
+        const DrawIndexedIndirectCommand& Command = Builder.mCommands[DrawIndex];
+        const DrawInstanceData& Data = Builder.mDrawData[DrawIndex];
+        const DrawSource& Source = Sources[Data.SourceIndex];
+        const DrawLod& Level = Source.Lods[Data.Lod];
+
+        CHECK(Command.FirstInstance == DrawIndex);
+        CHECK(Command.InstanceCount == 1);
+        CHECK(Command.IndexCount == Level.IndexCount);
+        CHECK(Command.FirstIndex == Level.FirstIndex);
+        CHECK(Command.VertexOffset == Level.VertexOffset);
+        CHECK(Data.MaterialIndex == Source.MaterialIndex);
+    }
+
+    uint32_t LodDraws = 0;
+    for (uint32_t Draws : Builder.mLodDraws)
+        LodDraws += Draws;
+    CHECK(LodDraws == Builder.mCommands.size());
+    CHECK(LodDraws + Builder.mFrustumCulled + Builder.mContributionCulled == Sources.size());
+}
+
+static void TestCullsAndPicksLevels(JobSystem& Jobs)
+{
+    std::array<float, MAX_DRAW_LODS> Levels = { 64.0f, 32.0f, 16.0f, 8.0f };
+    std::vector<DrawSource> Sources = {
+        MakeSource({ 0.0f, 0.0f, -10.0f }, 0.5f, 0, Levels),                              // Close, finest level
+        MakeSource({ 0.0f, 2.0f, -10.0f }, 0.5f, 1, { 1000.0f, 100.0f, 16.0f, 8.0f }),    // Close, second level
+        MakeSource({ 0.0f, 0.0f, 10.0f }, 0.5f, 0, Levels),                               // Behind the camera
+        MakeSource({ 0.0f, 0.0f, -90.0f }, 0.05f, 1, Levels),                             // Too small to draw
+        MakeSource({ 0.0f, 0.0f, -10.0f }, 0.5f, 5, Levels),                              // No such pipeline
+        MakeSource({ 2.0f, 0.0f, -20.0f }, 0.5f, 0, Levels),                              // Further, still finest
+        MakeSource({ -200.0f, 0.0f, -10.0f }, 0.5f, 1, Levels),                           // Far off to the side
+    };
+
+    IndirectDrawBuilder Builder;
+    Builder.Build(Sources, 2, MakeView(), Jobs);
+    CheckLayout(Builder, Sources, 2);
+
+    CHECK(Builder.mFrustumCulled == 3);
+    CHECK(Builder.mContributionCulled == 1);
+    CHECK((Builder.mLodDraws == std::array<uint32_t, MAX_DRAW_LODS>{ 2, 1, 0, 0 }));
+
+    CHECK(Builder.mPipelineCount[0] == 2);
+    CHECK(Builder.mPipelineCount[1] == 1);
+    CHECK(Builder.mDrawData.size() == 3);
+    if (Builder.mDrawData.size() == 3)
+    {
+        CHECK(Builder.mDrawData[0].SourceIndex == 0);
+        CHECK(Builder.mDrawData[1].SourceIndex == 5);
+        CHECK(Builder.mDrawData[2].SourceIndex == 1);
+        CHECK(Builder.mDrawData[2].Lod == 1);
+    }
+}
+
+static void TestNothingToDraw(JobSystem& Jobs)
+{
+    std::vector<DrawSource> Sources = ScatterDrawSources(100, 2, { -10.0f, -10.0f, -50.0f }, { 10.0f, 10.0f, -5.0f }, 7);
+
+    IndirectDrawBuilder Builder;
+    Builder.Build(Sources, 2, MakeView(), Jobs);
+    CHECK(!Builder.mCommands.empty());
+
+    // No pipelines culls everything, and no sources clears the previous build
+    Builder.Build(Sources, 0, MakeView(), Jobs);
+    CHECK(Builder.mCommands.empty());
+    CHECK(Builder.mDrawData.empty());
+    CHECK(Builder.mPipelineFirst.empty());
+    CHECK(Builder.mFrustumCulled == 100);
+
+    Builder.Build({}, 3, MakeView(), Jobs);
+    CHECK(Builder.mCommands.empty());
+    CHECK(Builder.mPipelineCount.size() == 3);
+    CHECK(Builder.mPipelineCount[0] == 0 && Builder.mPipelineCount[1] == 0 && Builder.mPipelineCount[2] == 0);
+    CHECK(Builder.mFrustumCulled == 0);
+    CHECK(Builder.mContributionCulled == 0);
+}
+
+static void TestSameOutputForAnyThreadCount(JobSystem& Jobs)
+{
+    // Not a multiple of the chunk size, so the last chunk is partial
+    DrawView View = MakeView();
+    std::vector<DrawSource> Sources = ScatterDrawSources(20 * IndirectDrawBuilder::CHUNK_SIZE + 37, 3, { -60.0f, -20.0f, -100.0f }, { 60.0f, 20.0f, 20.0f }, 1337);
+
+    Jobs.Start(0);
+    IndirectDrawBuilder Single;
+    Single.Build(Sources, 3, View, Jobs);
+    CheckLayout(Single, Sources, 3);
+    CHECK(Single.mFrustumCulled > 0);
+    CHECK(!Single.mCommands.empty());
+
+    for (uint32_t Workers : { 1u, 3u, 7u })
+    {
+        Jobs.Start(Workers);
+        IndirectDrawBuilder Parallel;
+        Parallel.Build(Sources, 3, View, Jobs);
+
+        CHECK(Parallel.mCommands.size() == Single.mCommands.size());
+        CHECK(Parallel.mDrawData.size() == Single.mDrawData.size());
+        if (Parallel.mCommands.size() == Single.mCommands.size() && Parallel.mDrawData.size() == Single.mDrawData.size())
+        {
+            CHECK(std::memcmp(Parallel.mCommands.data(), Single.mCommands.data(), Single.mCommands.size() * sizeof(DrawIndexedIndirectCommand)) == 0);
+            CHECK(std::memcmp(Parallel.mDrawData.data(), Single.mDrawData.data(), Single.mDrawData.size() * sizeof(DrawInstanceData)) == 0);
+        }
+        CHECK(Parallel.mPipelineFirst == Single.mPipelineFirst);
+        CHECK(Parallel.mPipelineCount == Single.mPipelineCount);
+        CHECK(Parallel.mFrustumCulled == Single.mFrustumCulled);
+        CHECK(Parallel.mContributionCulled == Single.mContributionCulled);
+        CHECK(Parallel.mLodDraws == Single.mLodDraws);
+    }
+}
+
+int main()
+{
+    JobSystem Jobs;
+    Jobs.Start(2);
+
+    TestCullsAndPicksLevels(Jobs);
+    TestNothingToDraw(Jobs);
+    TestSameOutputForAnyThreadCount(Jobs);
+
+    Jobs.Stop();
+    return ReportChecks("indirect draw");
+}
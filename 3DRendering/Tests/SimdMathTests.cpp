@@ -0,0 +1,279 @@
+#include "../SimdMath.h"
+#include "TestChecks.h"
+#include "glm/gtc/matrix_transform.hpp"
+#include <algorithm>
+#include <limits>
+#include <random>
+#include <vector>
+
+// Runs every batch kernel at each supported level against glm, over counts that leave padding lanes and with the
+// output aliasing an input. Returns non-zero if any check failed.
+
+// None are a multiple of the batch size except 16, so most runs end in padding lanes
+static const uint32_t Counts[] = { 1, 5, 8, 13, 16, 37 };
+
+// Relative to the magnitude of the expected value. The kernels fuse multiply-adds where glm doesn't.
+static bool IsNear(float Actual, float Expected)
+{
+    return std::abs(Actual - Expected) <= 1e-4f * (1.0f + std::abs(Expected));
+}
+
+static bool IsNear(const glm::mat4& Actual, const glm::mat4& Expected)
+{
+    for (uint32_t Column = 0; Column < 4; Column++)
+    {
+        for (uint32_t Row = 0; Row < 4; Row++)
+        {
+            if (!IsNear(Actual[Column][Row], Expected[Column][Row]))
+                return false;
+        }
+    }
+
+    return true;
+}
+
+static bool IsNear(const glm::vec3& Actual, const glm::vec3& Expected)
+{
+    return IsNear(Actual.x, Expected.x) && IsNear(Actual.y, Expected.y) && IsNear(Actual.z, Expected.z);
+}
+
+static glm::mat4 RandomAffine(std::mt19937& Rng)
+{
+    std::uniform_real_distribution<float> Offset(-100.0f, 100.0f);
+    std::uniform_real_distribution<float> Angle(0.0f, 6.2831853f);
+    std::uniform_real_distribution<float> Scale(0.5f, 2.0f);
+
+    glm::vec3 Axis = glm::normalize(glm::vec3(Offset(Rng), Offset(Rng), Offset(Rng)) + glm::vec3(0.0f, 0.0f, 1e-3f));
+    glm::mat4 Transform = glm::translate(glm::mat4(1.0f), glm::vec3(Offset(Rng), Offset(Rng), Offset(Rng)));
+    Transform = glm::rotate(Transform, Angle(Rng), Axis);
+    return glm::scale(Transform, glm::vec3(Scale(Rng), Scale(Rng), Scale(Rng)));
+}
+
+static Matrix4Batch RandomBatch(std::mt19937& Rng, uint32_t Count)
+{
+    Matrix4Batch Batch;
+    Batch.Resize(Count);
+    for (uint32_t Index = 0; Index < Count; Index++)
+        Batch.Set(Index, RandomAffine(Rng));
+    return Batch;
+}
+
+// Padding lanes must come out as identity matrices so the next kernel can run over them too
+static bool HasIdentityPadding(const Matrix4Batch& Batch)
+{
+    for (uint32_t Element = 0; Element < 16; Element++)
+    {
+        float Identity = (Element % 5 == 0) ? 1.0f : 0.0f;
+        const std::vector<float>& Lane = Batch.Elements[Element];
+        if (Lane.size() % SIMD_BATCH_ALIGNMENT != 0 || Lane.size() < Batch.GetCount())
+            return false;
+        for (size_t Index = Batch.GetCount(); Index < Lane.size(); Index++)
+        {
+            if (!IsNear(Lane[Index], Identity))
+                return false;
+        }
+    }
+
+    return true;
+}
+
+static void TestMultiply(std::mt19937& Rng, uint32_t Count)
+{
+    Matrix4Batch A = RandomBatch(Rng, Count);
+    Matrix4Batch B = RandomBatch(Rng, Count);
+    std::vector<glm::mat4> Expected(Count);
+    for (uint32_t Index = 0; Index < Count; Index++)
+        Expected[Index] = A.Get(Index) * B.Get(Index);
+
+    Matrix4Batch Out;
+    MultiplyMatrices(A, B, Out);
+    CHECK(Out.GetCount() == Count);
+    CHECK(HasIdentityPadding(Out));
+    for (uint32_t Index = 0; Index < Count; Index++)
+        CHECK(IsNear(Out.Get(Index), Expected[Index]));
+
+    // Into each input in turn
+    Matrix4Batch IntoA = A;
+    MultiplyMatrices(IntoA, B, IntoA);
+    Matrix4Batch IntoB = B;
+    MultiplyMatrices(A, IntoB, IntoB);
+    for (uint32_t Index = 0; Index < Count; Index++)
+    {
+        CHECK(IsNear(IntoA.Get(Index), Expected[Index]));
+        CHECK(IsNear(IntoB.Get(Index), Expected[Index]));
+    }
+}
+
+static void TestMultiplyUniform(std::mt19937& Rng, uint32_t Count)
+{
+    glm::mat4 ViewProjection = glm::perspective(glm::radians(70.0f), 1.5f, 0.1f, 500.0f) * RandomAffine(Rng);
+    Matrix4Batch B = RandomBatch(Rng, Count);
+    std::vector<glm::mat4> Expected(Count);
+    for (uint32_t Index = 0; Index < Count; Index++)
+        Expected[Index] = ViewProjection * B.Get(Index);
+
+    Matrix4Batch Out;
+    MultiplyMatrices(ViewProjection, B, Out);
+    CHECK(Out.GetCount() == Count);
+    for (uint32_t Index = 0; Index < Count; Index++)
+        CHECK(IsNear(Out.Get(Index), Expected[Index]));
+
+    MultiplyMatrices(ViewProjection, B, B);
+    for (uint32_t Index = 0; Index < Count; Index++)
+        CHECK(IsNear(B.Get(Index), Expected[Index]));
+}
+
+static void TestInverseAffine(std::mt19937& Rng, uint32_t Count)
+{
+    Matrix4Batch In = RandomBatch(Rng, Count);
+    std::vector<glm::mat4> Expected(Count);
+    for (uint32_t Index = 0; Index < Count; Index++)
+        Expected[Index] = glm::inverse(In.Get(Index));
+
+    Matrix4Batch Out;
+    InverseAffine(In, Out);
+    CHECK(Out.GetCount() == Count);
+    CHECK(HasIdentityPadding(Out));
+    for (uint32_t Index = 0; Index < Count; Index++)
+    {
+        CHECK(IsNear(Out.Get(Index), Expected[Index]));
+        CHECK(IsNear(InverseAffine(In.Get(Index)), Expected[Index]));
+    }
+
+    InverseAffine(In, In);
+    CHECK(HasIdentityPadding(In));
+    for (uint32_t Index = 0; Index < Count; Index++)
+        CHECK(IsNear(In.Get(Index), Expected[Index]));
+}
+
+static void TestTransformBounds(std::mt19937& Rng, uint32_t Count)
+{
+    std::uniform_real_distribution<float> Coordinate(-10.0f, 10.0f);
+    Matrix4Batch Transforms = RandomBatch(Rng, Count);
+    BoundsBatch In;
+    In.Resize(Count);
+
+    // Reference is the bounds of the eight transformed corners
+    std::vector<glm::vec3> ExpectedMin(Count), ExpectedMax(Count);
+    for (uint32_t Index = 0; Index < Count; Index++)
+    {
+        glm::vec3 A(Coordinate(Rng), Coordinate(Rng), Coordinate(Rng));
+        glm::vec3 B(Coordinate(Rng), Coordinate(Rng), Coordinate(Rng));
+        glm::vec3 Min = glm::min(A, B), Max = glm::max(A, B);
+        In.Set(Index, Min, Max);
+
+        glm::mat4 Transform = Transforms.Get(Index);
+        ExpectedMin[Index] = glm::vec3(std::numeric_limits<float>::max());
+        ExpectedMax[Index] = glm::vec3(-std::numeric_limits<float>::max());
+        for (uint32_t Corner = 0; Corner < 8; Corner++)
+        {
+            glm::vec3 Point((Corner & 1) ? Max.x : Min.x, (Corner & 2) ? Max.y : Min.y, (Corner & 4) ? Max.z : Min.z);
+            glm::vec3 Transformed = glm::vec3(Transform * glm::vec4(Point, 1.0f));
+            ExpectedMin[Index] = glm::min(ExpectedMin[Index], Transformed);
+            ExpectedMax[Index] = glm::max(ExpectedMax[Index], Transformed);
+        }
+    }
+
+    BoundsBatch Out;
+    TransformBounds(Transforms, In, Out);
+    CHECK(Out.GetCount() == Count);
+    for (uint32_t Index = 0; Index < Count; Index++)
+    {
+        glm::vec3 Min, Max;
+        Out.Get(Index, Min, Max);
+        CHECK(IsNear(Min, ExpectedMin[Index]));
+        CHECK(IsNear(Max, ExpectedMax[Index]));
+    }
+
+    TransformBounds(Transforms, In, In);
+    for (uint32_t Index = 0; Index < Count; Index++)
+    {
+        glm::vec3 Min, Max;
+        In.Get(Index, Min, Max);
+        CHECK(IsNear(Min, ExpectedMin[Index]));
+        CHECK(IsNear(Max, ExpectedMax[Index]));
+    }
+}
+
+static void TestSpheres(std::mt19937& Rng, uint32_t Count)
+{
+    // Inward facing planes of a box, so a fair share of random spheres land on each side
+    std::vector<glm::vec4> Planes = {
+        { 1.0f, 0.0f, 0.0f, 20.0f }, { -1.0f, 0.0f, 0.0f, 20.0f },
+        { 0.0f, 1.0f, 0.0f, 20.0f }, { 0.0f, -1.0f, 0.0f, 20.0f },
+        { 0.0f, 0.0f, 1.0f, 20.0f }, { 0.0f, 0.0f, -1.0f, 20.0f },
+    };
+
+    std::uniform_real_distribution<float> Coordinate(-40.0f, 40.0f);
+    std::uniform_real_distribution<float> Radius(0.0f, 10.0f);
+    SphereBatch Spheres;
+    Spheres.Resize(Count);
+
+    std::vector<uint8_t> Expected(Count);
+    uint32_t ExpectedInside = 0;
+    for (uint32_t Index = 0; Index < Count; Index++)
+    {
+        glm::vec3 Center(Coordinate(Rng), Coordinate(Rng), Coordinate(Rng));
+        float SphereRadius = Radius(Rng);
+
+        // The first sphere just touches a plane from outside, which counts as inside
+        if (Index == 0)
+        {
+            Center = glm::vec3(-24.0f, 0.0f, 0.0f);
+            SphereRadius = 4.0f;
+        }
+        Spheres.Set(Index, Center, SphereRadius);
+
+        bool bInside = true;
+        for (const glm::vec4& Plane : Planes)
+            bInside = bInside && glm::dot(glm::vec3(Plane), Center) + Plane.w >= -SphereRadius;
+        Expected[Index] = bInside ? 1 : 0;
+        ExpectedInside += Expected[Index];
+    }
+
+    // Results past Count must be left alone
+    std::vector<uint8_t> Inside(Count + SIMD_BATCH_ALIGNMENT, 0xAA);
+    uint32_t InsideCount = TestSpheresAgainstPlanes(Spheres, Planes.data(), static_cast<uint32_t>(Planes.size()), Inside.data());
+    CHECK(InsideCount == ExpectedInside);
+    CHECK(Inside[0] == 1);
+    CHECK(std::equal(Expected.begin(), Expected.end(), Inside.begin()));
+    CHECK(std::all_of(Inside.begin() + Count, Inside.end(), [](uint8_t Value) { return Value == 0xAA; }));
+
+    // A range starting on a batch boundary, as the draw builder's chunks test theirs
+    if (Count > SIMD_BATCH_ALIGNMENT)
+    {
+        uint32_t RangeCount = Count - SIMD_BATCH_ALIGNMENT;
+        std::vector<uint8_t> RangeInside(RangeCount);
+        uint32_t RangeInsideCount = TestSpheresAgainstPlanes(Spheres, SIMD_BATCH_ALIGNMENT, RangeCount, Planes.data(), static_cast<uint32_t>(Planes.size()), RangeInside.data());
+        CHECK(RangeInsideCount == static_cast<uint32_t>(std::count(Expected.begin() + SIMD_BATCH_ALIGNMENT, Expected.end(), 1)));
+        CHECK(std::equal(RangeInside.begin(), RangeInside.end(), Expected.begin() + SIMD_BATCH_ALIGNMENT));
+    }
+}
+
+int main()
+{
+    SimdLevel Supported = GetSupportedSimdLevel();
+    for (uint32_t LevelIndex = 0; LevelIndex <= static_cast<uint32_t>(Supported); LevelIndex++)
+    {
+        SimdLevel Level = static_cast<SimdLevel>(LevelIndex);
+        SetSimdLevel(Level);
+        CHECK(GetSimdLevel() == Level);
+        std::printf("Checking %s kernels\n", GetSimdLevelName(Level));
+
+        std::mt19937 Rng(1337 + LevelIndex);
+        for (uint32_t Count : Counts)
+        {
+            TestMultiply(Rng, Count);
+            TestMultiplyUniform(Rng, Count);
+            TestInverseAffine(Rng, Count);
+            TestTransformBounds(Rng, Count);
+            TestSpheres(Rng, Count);
+        }
+    }
+
+    // Levels above what the CPU supports are clamped
+    SetSimdLevel(SimdLevel::AVX2);
+    CHECK(GetSimdLevel() == Supported);
+
+    return ReportChecks("SIMD math");
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+
+// Shared by the CPU test executables. A failed check prints where it was and is counted, so every check still runs.
+
+inline uint32_t gFailures = 0;
+
+#define CHECK(Condition) \
+    do \
+    { \
+        if (!(Condition)) \
+        { \
+            std::printf("%s:%d: %s\n", __FILE__, __LINE__, #Condition); \
+            gFailures++; \
+        } \
+    } while (false)
+
+#define CHECK_NEAR(A, B, Tolerance) \
+    do \
+    { \
+        if (!(std::abs((A) - (B)) <= (Tolerance))) \
+        { \
+            std::printf("%s:%d: %s (%g) != %s (%g)\n", __FILE__, __LINE__, #A, static_cast<double>(A), #B, static_cast<double>(B)); \
+            gFailures++; \
+        } \
+    } while (false)
+
+// Prints a summary and returns the process exit code
+inline int ReportChecks(const char* Name)
+{
+    if (gFailures > 0)
+    {
+        std::printf("%u %s checks failed\n", gFailures, Name);
+        return 1;
+    }
+
+    std::printf("All %s checks passed\n", Name);
+    return 0;
+}
@@ -0,0 +1,412 @@
+#include "TextureStreaming.h"
+#include "stb_image.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+
+void TextureStreamer::Start()
+{
+    bStopping = false;
+
+    for (uint32_t Thread = 0; Thread < std::max(mSettings.IOThreads, 1u); Thread++)
+        mThreads.emplace_back(&TextureStreamer::IOMain, this);
+
+    for (uint32_t Thread = 0; Thread < std::max(mSettings.DecodeThreads, 1u); Thread++)
+        mThreads.emplace_back(&TextureStreamer::DecodeMain, this);
+}
+
+void TextureStreamer::Stop()
+{
+    if (mThreads.empty())
+        return;
+
+    {
+        std::scoped_lock Lock(mIOQueue.Mutex, mDecodeQueue.Mutex);
+        bStopping = true;
+    }
+    mIOQueue.Condition.notify_all();
+    mDecodeQueue.Condition.notify_all();
+
+    for (std::thread& Thread : mThreads)
+        Thread.join();
+    mThreads.clear();
+
+    // Nothing will complete anymore
+    for (StreamedTexture& Texture : mTextures)
+    {
+        Texture.bInFlight = false;
+        Texture.ReservedBytes = 0;
+    }
+    mIOQueue.Items.clear();
+    mDecodeQueue.Items.clear();
+    mReservedBytes = 0;
+    mPendingRequests = 0;
+}
+
+StreamedTextureId TextureStreamer::Register(std::string Path)
+{
+    auto Found = mPathToTexture.find(Path);
+    if (Found != mPathToTexture.end())
+        return Found->second;
+
+    StreamedTextureId Id = static_cast<StreamedTextureId>(mTextures.size());
+    mPathToTexture.emplace(Path, Id);
+    mTextures.emplace_back().Path = std::move(Path);
+
+    Issue(Id, LOW_MIP);
+
+    return Id;
+}
+
+void TextureStreamer::Reload(StreamedTextureId Id)
+{
+    StreamedTexture& Texture = mTextures[Id];
+    Texture.Generation++;
+    Texture.bFailed = false;
+
+    // Whatever is loading now is stale, the reload is issued once it comes back
+    if (Texture.bInFlight)
+    {
+        Texture.bReloadQueued = true;
+        return;
+    }
+
+    Texture.Width = 0;
+    Texture.ResidentLevel = LOW_MIP;
+    Issue(Id, LOW_MIP);
+}
+
+void TextureStreamer::RequestResolution(StreamedTextureId Id, float TexelsAcross, uint64_t Frame)
+{
+    StreamedTexture& Texture = mTextures[Id];
+    if (Texture.Width == 0)
+        return;
+
+    // Finest level whose size still covers the request
+    float FullSize = static_cast<float>(std::max(Texture.Width, Texture.Height));
+    float Wanted = std::max(TexelsAcross * mSettings.TexelsPerPixel, 1.0f);
+    uint32_t Level = static_cast<uint32_t>(std::max(std::floor(std::log2(FullSize / Wanted)), 0.0f));
+    Level = std::min(Level, Texture.LowLevel);
+
+    if (Texture.RequestFrame != Frame)
+    {
+        Texture.RequestFrame = Frame;
+        Texture.WantedLevel = Level;
+    }
+    else
+    {
+        Texture.WantedLevel = std::min(Texture.WantedLevel, Level);
+    }
+
+    // Only counts as used if the detail it has is actually being looked at
+    if (Texture.WantedLevel <= Texture.ResidentLevel)
+        Texture.LastUsedFrame = Frame;
+}
+
+void TextureStreamer::Update(uint64_t Frame)
+{
+    std::vector<LoadResult> Results;
+    {
+        std::lock_guard Lock(mResultMutex);
+        Results.swap(mResults);
+    }
+
+    for (LoadResult& Result : Results)
+        Upload(Result);
+
+    // Low mips are made resident regardless of the budget, whatever detail they pushed over it has to go
+    if (mResidentBytes + mReservedBytes > mSettings.BudgetBytes)
+        EvictFor(0, Frame, INVALID_STREAMED_TEXTURE, true);
+
+    // Textures nobody asked for in a while fall back to their low mip
+    for (StreamedTexture& Texture : mTextures)
+    {
+        if (Texture.RequestFrame + mSettings.UnusedFrames < Frame)
+            Texture.WantedLevel = Texture.LowLevel;
+    }
+
+    std::vector<StreamedTextureId> Candidates;
+    for (StreamedTextureId Id = 0; Id < mTextures.size(); Id++)
+    {
+        const StreamedTexture& Texture = mTextures[Id];
+        if (Texture.Width != 0 && !Texture.bInFlight && !Texture.bFailed && Texture.WantedLevel < Texture.ResidentLevel)
+            Candidates.push_back(Id);
+    }
+
+    // Largest shortfall in detail first, ties go to whatever was wanted most recently
+    std::sort(Candidates.begin(), Candidates.end(), [this](StreamedTextureId A, StreamedTextureId B)
+    {
+        uint32_t DeficitA = mTextures[A].ResidentLevel - mTextures[A].WantedLevel;
+        uint32_t DeficitB = mTextures[B].ResidentLevel - mTextures[B].WantedLevel;
+        if (DeficitA != DeficitB)
+            return DeficitA > DeficitB;
+        return mTextures[A].RequestFrame > mTextures[B].RequestFrame;
+    });
+
+    for (StreamedTextureId Id : Candidates)
+    {
+        if (mPendingRequests >= MAX_IN_FLIGHT)
+            break;
+
+        StreamedTexture& Texture = mTextures[Id];
+
+        // Settle for a coarser level than wanted if the budget can't fit it even after evicting
+        for (uint32_t Level = Texture.WantedLevel; Level < Texture.ResidentLevel; Level++)
+        {
+            uint64_t Bytes = GetLevelBytes(Texture.Width, Texture.Height, Level);
+            uint64_t Growth = Bytes - Texture.ResidentBytes;
+            if (mResidentBytes + mReservedBytes + Growth > mSettings.BudgetBytes && !EvictFor(Growth, Frame, Id))
+                continue;
+
+            Texture.ReservedBytes = Growth;
+            mReservedBytes += Growth;
+            Issue(Id, Level);
+            break;
+        }
+    }
+}
+
+uint64_t TextureStreamer::GetLevelBytes(uint32_t Width, uint32_t Height, uint32_t Level)
+{
+    return static_cast<uint64_t>(std::max(Width >> Level, 1u)) * std::max(Height >> Level, 1u) * 4;
+}
+
+void TextureStreamer::Issue(StreamedTextureId Id, uint32_t Level)
+{
+    StreamedTexture& Texture = mTextures[Id];
+    Texture.bInFlight = true;
+    mPendingRequests++;
+
+    {
+        std::lock_guard Lock(mIOQueue.Mutex);
+        mIOQueue.Items.push_back({ Id, Texture.Generation, Texture.Path, Level, mSettings.LowMipSize, {} });
+    }
+    mIOQueue.Condition.notify_one();
+}
+
+bool TextureStreamer::EvictFor(uint64_t Bytes, uint64_t Frame, StreamedTextureId Requester, bool bForce)
+{
+    // Only detail that isn't being looked at right now is up for eviction unless forced, oldest first
+    std::vector<StreamedTextureId> Victims;
+    for (StreamedTextureId Id = 0; Id < mTextures.size(); Id++)
+    {
+        const StreamedTexture& Texture = mTextures[Id];
+        bool bHasDetail = Texture.ResidentLevel < Texture.LowLevel;
+        bool bUnused = bForce || Texture.LastUsedFrame < Frame || Texture.WantedLevel > Texture.ResidentLevel;
+        if (Id != Requester && bHasDetail && bUnused && !Texture.bInFlight)
+            Victims.push_back(Id);
+    }
+
+    std::sort(Victims.begin(), Victims.end(), [this](StreamedTextureId A, StreamedTextureId B)
+    {
+        return mTextures[A].LastUsedFrame < mTextures[B].LastUsedFrame;
+    });
+
+    auto Fits = [&]()
+    {
+        return mResidentBytes + mReservedBytes + Bytes <= mSettings.BudgetBytes;
+    };
+
+    // Don't evict anything unless it's enough to make room
+    uint64_t Reclaimable = 0;
+    for (StreamedTextureId Id : Victims)
+        Reclaimable += mTextures[Id].ResidentBytes - GetLevelBytes(mTextures[Id].Width, mTextures[Id].Height, mTextures[Id].LowLevel);
+    if (mResidentBytes - Reclaimable + mReservedBytes + Bytes > mSettings.BudgetBytes)
+        return false;
+
+    for (StreamedTextureId Id : Victims)
+    {
+        if (Fits())
+            break;
+
+        StreamedTexture& Texture = mTextures[Id];
+        ReplaceResident(Texture, Texture.LowLevel, std::max(Texture.Width >> Texture.LowLevel, 1u), std::max(Texture.Height >> Texture.LowLevel, 1u), Texture.LowMipPixels.data());
+        mEvictions++;
+    }
+
+    return Fits();
+}
+
+void TextureStreamer::ReplaceResident(StreamedTexture& Texture, uint32_t Level, uint32_t Width, uint32_t Height, const uint8_t* Pixels)
+{
+    uint64_t Handle = mCreateTexture(Texture.Path, Width, Height, Pixels);
+    if (Texture.Handle != 0)
+        mReleaseTexture(Texture.Handle);
+
+    uint64_t Bytes = static_cast<uint64_t>(Width) * Height * 4;
+    mResidentBytes = mResidentBytes - Texture.ResidentBytes + Bytes;
+
+    Texture.Handle = Handle;
+    Texture.ResidentLevel = Level;
+    Texture.ResidentBytes = Bytes;
+}
+
+void TextureStreamer::Upload(LoadResult& Result)
+{
+    StreamedTexture& Texture = mTextures[Result.Id];
+    Texture.bInFlight = false;
+    mReservedBytes -= Texture.ReservedBytes;
+    Texture.ReservedBytes = 0;
+    mPendingRequests--;
+
+    if (Texture.bReloadQueued)
+    {
+        Texture.bReloadQueued = false;
+        Texture.Width = 0;
+        Texture.ResidentLevel = LOW_MIP;
+        Issue(Result.Id, LOW_MIP);
+        return;
+    }
+
+    if (Result.Generation != Texture.Generation)
+        return;
+
+    if (!Result.bSucceeded)
+    {
+        Texture.bFailed = true;
+        mFailedLoads++;
+        return;
+    }
+
+    mStreamedBytes += Result.FileBytes;
+
+    if (Texture.Width == 0)
+    {
+        Texture.Width = Result.FullWidth;
+        Texture.Height = Result.FullHeight;
+        Texture.LowLevel = Result.LowLevel;
+        Texture.WantedLevel = Result.LowLevel;
+        Texture.LowMipPixels = Result.Pixels;
+    }
+
+    // It may have been evicted or stopped mattering while it was loading
+    if (Result.Level >= Texture.ResidentLevel)
+        return;
+
+    ReplaceResident(Texture, Result.Level, Result.Width, Result.Height, Result.Pixels.data());
+    mUploads++;
+}
+
+void TextureStreamer::IOMain()
+{
+    while (true)
+    {
+        LoadRequest Request;
+        {
+            std::unique_lock Lock(mIOQueue.Mutex);
+            mIOQueue.Condition.wait(Lock, [this]() { return bStopping || !mIOQueue.Items.empty(); });
+            if (bStopping)
+                return;
+
+            Request = std::move(mIOQueue.Items.front());
+            mIOQueue.Items.pop_front();
+        }
+
+        std::ifstream File(Request.Path, std::ios::binary | std::ios::ate);
+        if (File)
+        {
+            Request.FileData.resize(static_cast<size_t>(File.tellg()));
+            File.seekg(0);
+            File.read(reinterpret_cast<char*>(Request.FileData.data()), Request.FileData.size());
+        }
+
+        {
+            std::lock_guard Lock(mDecodeQueue.Mutex);
+            mDecodeQueue.Items.push_back(std::move(Request));
+        }
+        mDecodeQueue.Condition.notify_one();
+    }
+}
+
+void TextureStreamer::DecodeMain()
+{
+    while (true)
+    {
+        LoadRequest Request;
+        {
+            std::unique_lock Lock(mDecodeQueue.Mutex);
+            mDecodeQueue.Condition.wait(Lock, [this]() { return bStopping || !mDecodeQueue.Items.empty(); });
+            if (bStopping)
+                return;
+
+            Request = std::move(mDecodeQueue.Items.front());
+            mDecodeQueue.Items.pop_front();
+        }
+
+        LoadResult Result = Decode(Request);
+
+        std::lock_guard Lock(mResultMutex);
+        mResults.push_back(std::move(Result));
+    }
+}
+
+TextureStreamer::LoadResult TextureStreamer::Decode(LoadRequest& Request)
+{
+    LoadResult Result{};
+    Result.Id = Request.Id;
+    Result.Generation = Request.Generation;
+    Result.FileBytes = Request.FileData.size();
+
+    int32_t Width = 0, Height = 0, NumChannels = 0;
+    stbi_uc* Decoded = nullptr;
+    if (!Request.FileData.empty())
+        Decoded = stbi_load_from_memory(Request.FileData.data(), static_cast<int>(Request.FileData.size()), &Width, &Height, &NumChannels, 4);
+
+    if (!Decoded)
+        return Result;
+
+    // stb allocates on its own, it's only accounted for while alive
+    uint64_t DecodedBytes = static_cast<uint64_t>(Width) * Height * 4;
+    gMemory.TrackCpuAllocation(MemoryCategory::Textures, DecodedBytes);
+
+    Result.FullWidth = static_cast<uint32_t>(Width);
+    Result.FullHeight = static_cast<uint32_t>(Height);
+
+    uint32_t LowLevel = 0;
+    while (std::max(Result.FullWidth >> LowLevel, Result.FullHeight >> LowLevel) > Request.LowMipSize)
+        LowLevel++;
+    Result.LowLevel = LowLevel;
+    Result.Level = Request.Level == LOW_MIP ? LowLevel : std::min(Request.Level, LowLevel);
+
+    // Box filter down to the requested level, the full resolution image is never kept around
+    uint32_t LevelWidth = Result.FullWidth;
+    uint32_t LevelHeight = Result.FullHeight;
+    PixelBuffer Pixels(Decoded, Decoded + static_cast<size_t>(LevelWidth) * LevelHeight * 4);
+    stbi_image_free(Decoded);
+    gMemory.TrackCpuFree(MemoryCategory::Textures, DecodedBytes);
+
+    for (uint32_t Level = 0; Level < Result.Level; Level++)
+    {
+        uint32_t NextWidth = std::max(LevelWidth / 2, 1u);
+        uint32_t NextHeight = std::max(LevelHeight / 2, 1u);
+        PixelBuffer Next(static_cast<size_t>(NextWidth) * NextHeight * 4);
+
+        for (uint32_t Y = 0; Y < NextHeight; Y++)
+        {
+            uint32_t Y0 = std::min(Y * 2, LevelHeight - 1);
+            uint32_t Y1 = std::min(Y * 2 + 1, LevelHeight - 1);
+            for (uint32_t X = 0; X < NextWidth; X++)
+            {
+                uint32_t X0 = std::min(X * 2, LevelWidth - 1);
+                uint32_t X1 = std::min(X * 2 + 1, LevelWidth - 1);
+                for (uint32_t Channel = 0; Channel < 4; Channel++)
+                {
+                    uint32_t Sum = Pixels[(Y0 * LevelWidth + X0) * 4 + Channel] + Pixels[(Y0 * LevelWidth + X1) * 4 + Channel] +
+                        Pixels[(Y1 * LevelWidth + X0) * 4 + Channel] + Pixels[(Y1 * LevelWidth + X1) * 4 + Channel];
+                    Next[(Y * NextWidth + X) * 4 + Channel] = static_cast<uint8_t>((Sum + 2) / 4);
+                }
+            }
+        }
+
+        Pixels.swap(Next);
+        LevelWidth = NextWidth;
+        LevelHeight = NextHeight;
+    }
+
+    Result.Width = LevelWidth;
+    Result.Height = LevelHeight;
+    Result.Pixels = std::move(Pixels);
+    Result.bSucceeded = true;
+
+    return Result;
+}
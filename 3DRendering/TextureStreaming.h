@@ -0,0 +1,194 @@
+#pragma once
+
+#include "MemoryTracking.h"
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+using StreamedTextureId = uint32_t;
+constexpr StreamedTextureId INVALID_STREAMED_TEXTURE = ~0u;
+
+using PixelBuffer = TrackedVector<uint8_t, MemoryCategory::Textures>;
+
+struct TextureStreamingSettings
+{
+    // Everything resident, including the always resident low mips
+    uint64_t BudgetBytes = 256ull * 1024 * 1024;
+
+    // At load only the first mip at or below this size is made resident
+    uint32_t LowMipSize = 64;
+
+    // Texels wanted per screen pixel, above one trades memory for sharpness
+    float TexelsPerPixel = 1.0f;
+
+    // Frames a texture can go without being requested before it counts as unused
+    uint32_t UnusedFrames = 60;
+
+    uint32_t IOThreads = 1;
+    uint32_t DecodeThreads = 2;
+};
+
+// Keeps one mip level of every registered texture resident, picked from how many texels the meshes using it cover
+// on screen. Files are read on I/O threads, decoded and downsampled on decode threads, and uploaded by Update on the
+// calling thread, which owns every call into the hooks below.
+//
+// The forward pass doesn't sample these textures yet. Resource sets can only bind frame buffer attachments and mesh
+// vertices carry no UVs, so resident bytes, uploads and evictions show what streaming would cost, not memory that
+// affects the image.
+struct TextureStreamer
+{
+    TextureStreamingSettings mSettings;
+
+    // Creates a GPU texture from tightly packed RGBA8 pixels and returns an opaque handle to it. Path names the
+    // texture the pixels belong to.
+    std::function<uint64_t(const std::string& Path, uint32_t Width, uint32_t Height, const uint8_t* Pixels)> mCreateTexture;
+
+    // Releases a handle returned by mCreateTexture. Frames in flight may still use it, deferring is up to the hook.
+    std::function<void(uint64_t Handle)> mReleaseTexture;
+
+    // Stats
+    uint64_t mResidentBytes = 0;
+    uint32_t mPendingRequests = 0;
+    uint32_t mUploads = 0;
+    uint32_t mEvictions = 0;
+    uint32_t mFailedLoads = 0;
+    uint64_t mStreamedBytes = 0;
+
+    void Start();
+    void Stop();
+
+    // Queues the low mip of Path. Registering a path twice returns the same texture.
+    StreamedTextureId Register(std::string Path);
+
+    // Starts over from the low mip, for when the file changed on disk. The current level stays resident until the
+    // new low mip replaces it.
+    void Reload(StreamedTextureId Id);
+
+    // Called for every mesh using the texture, the largest request of a frame wins
+    void RequestResolution(StreamedTextureId Id, float TexelsAcross, uint64_t Frame);
+
+    // Uploads finished loads, evicts least recently used detail when over budget and issues new requests
+    void Update(uint64_t Frame);
+
+    // Handle of the currently resident level, 0 until the low mip arrived
+    uint64_t GetHandle(StreamedTextureId Id) const
+    {
+        return mTextures[Id].Handle;
+    }
+
+    uint32_t GetTextureCount() const
+    {
+        return static_cast<uint32_t>(mTextures.size());
+    }
+
+    const std::string& GetPath(StreamedTextureId Id) const
+    {
+        return mTextures[Id].Path;
+    }
+
+    ~TextureStreamer()
+    {
+        Stop();
+    }
+
+private:
+
+    static constexpr uint32_t LOW_MIP = ~0u;
+
+    struct StreamedTexture
+    {
+        std::string Path;
+
+        // Known once the first load finished
+        uint32_t Width = 0;
+        uint32_t Height = 0;
+        uint32_t LowLevel = 0;
+
+        uint64_t Handle = 0;
+        uint32_t ResidentLevel = LOW_MIP;
+        uint64_t ResidentBytes = 0;
+
+        // Kept on the CPU so detail can be evicted without going back to disk
+        PixelBuffer LowMipPixels;
+
+        uint32_t WantedLevel = LOW_MIP;
+        uint64_t RequestFrame = 0;
+        uint64_t LastUsedFrame = 0;
+        uint64_t ReservedBytes = 0;
+        bool bInFlight = false;
+        bool bFailed = false;
+
+        // Bumped on reload so loads of the old file are thrown away
+        uint32_t Generation = 0;
+        bool bReloadQueued = false;
+    };
+
+    struct LoadRequest
+    {
+        StreamedTextureId Id;
+        uint32_t Generation;
+        std::string Path;
+
+        // LOW_MIP until the texture's size is known
+        uint32_t Level;
+        uint32_t LowMipSize;
+        PixelBuffer FileData;
+    };
+
+    struct LoadResult
+    {
+        StreamedTextureId Id;
+        uint32_t Generation;
+        uint32_t Level;
+        uint32_t LowLevel;
+        uint32_t FullWidth;
+        uint32_t FullHeight;
+        uint32_t Width;
+        uint32_t Height;
+        PixelBuffer Pixels;
+        uint64_t FileBytes;
+        bool bSucceeded;
+    };
+
+    template<typename ItemType>
+    struct WorkQueue
+    {
+        std::mutex Mutex;
+        std::condition_variable Condition;
+        std::deque<ItemType> Items;
+    };
+
+    static uint64_t GetLevelBytes(uint32_t Width, uint32_t Height, uint32_t Level);
+    static LoadResult Decode(LoadRequest& Request);
+
+    void IOMain();
+    void DecodeMain();
+    void Issue(StreamedTextureId Id, uint32_t Level);
+    void Upload(LoadResult& Result);
+    void ReplaceResident(StreamedTexture& Texture, uint32_t Level, uint32_t Width, uint32_t Height, const uint8_t* Pixels);
+    bool EvictFor(uint64_t Bytes, uint64_t Frame, StreamedTextureId Requester, bool bForce = false);
+
+    // Bounds the number of loads in flight, so the most urgent requests aren't stuck behind a long queue
+    static constexpr uint32_t MAX_IN_FLIGHT = 8;
+
+    std::vector<StreamedTexture> mTextures;
+    std::unordered_map<std::string, StreamedTextureId> mPathToTexture;
+
+    // Budget set aside for loads in flight
+    uint64_t mReservedBytes = 0;
+
+    WorkQueue<LoadRequest> mIOQueue;
+    WorkQueue<LoadRequest> mDecodeQueue;
+
+    std::mutex mResultMutex;
+    std::vector<LoadResult> mResults;
+
+    std::vector<std::thread> mThreads;
+    bool bStopping = false;
+};
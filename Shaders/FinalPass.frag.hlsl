@@ -9,15 +9,42 @@ struct PSOut
     float4 Color       : SV_Target0;
 };
 
+// Must match FinalPassUniforms
+cbuffer FinalPassData : register(b1, space0)
+{
+    float2 SourceScale;
+};
+
 Texture2D<float4>  Tex : register(t0, space0);
 SamplerState      Samp : register(t0, space0);
 
+// Bilinear upscale that never reads outside the rendered region, the rest of the target holds stale pixels
+float4 SampleRenderedRegion(float2 UV)
+{
+    float Width, Height;
+    Tex.GetDimensions(Width, Height);
+
+    float2 RenderSize = max(float2(Width, Height) * SourceScale, 1.0);
+    float2 Texel = UV * RenderSize - 0.5;
+    float2 Base = floor(Texel);
+    float2 Frac = Texel - Base;
+
+    int2 Min = clamp(int2(Base), int2(0, 0), int2(RenderSize) - 1);
+    int2 Max = clamp(int2(Base) + 1, int2(0, 0), int2(RenderSize) - 1);
+
+    float4 C00 = Tex.Load(int3(Min.x, Min.y, 0));
+    float4 C10 = Tex.Load(int3(Max.x, Min.y, 0));
+    float4 C01 = Tex.Load(int3(Min.x, Max.y, 0));
+    float4 C11 = Tex.Load(int3(Max.x, Max.y, 0));
+
+    return lerp(lerp(C00, C10, Frac.x), lerp(C01, C11, Frac.x), Frac.y);
+}
+
 PSOut main(PSIn Input)
 {
     PSOut Output;
 
-    float4 Color = Tex.Sample(Samp, Input.UV);
-    Output.Color = Color;
+    Output.Color = SampleRenderedRegion(Input.UV);
 
     return Output;
 }
\ No newline at end of file
@@ -1,18 +1,71 @@
+// Must match ClusteredLighting.h
+#define MAX_CLUSTER_LIGHTS 1024
+#define MAX_CLUSTER_LIGHT_INDICES 16384
+#define CLUSTER_COUNT (16 * 9 * 24)
+
+// Must match CascadedShadows.h
+#define SHADOW_CASCADE_COUNT 4
+#define SHADOW_DEPTH_BIAS 0.0015
+
 struct DirectionalLight
 {
     float3 mDir;
 };
 
+struct ClusterParams
+{
+    uint4 Dims; // Tiles x, tiles y, slices, light count
+    float SliceScale;
+    float SliceBias;
+};
+
+struct LocalLight
+{
+    float4 PositionRadius;
+    float4 ColorInnerCone;
+    float4 DirectionOuterCone;
+};
+
 cbuffer FragmentData : register(b1, space0)
 {
     float3 mEye;
 	DirectionalLight mDirLight;
+    ClusterParams mClusters;
+    float4x4 mCascadeViewProjection[SHADOW_CASCADE_COUNT];
+    float4 mCascadeSplits;
+}
+
+cbuffer LightData : register(b2, space0)
+{
+    LocalLight mLights[MAX_CLUSTER_LIGHTS];
 }
 
+cbuffer ClusterGrid : register(b3, space0)
+{
+    uint4 mClusterRanges[CLUSTER_COUNT / 4];
+}
+
+cbuffer ClusterIndices : register(b4, space0)
+{
+    uint4 mLightIndices[MAX_CLUSTER_LIGHT_INDICES / 8];
+}
+
+Texture2D<float4>  ShadowCascade0 : register(t5, space0);
+SamplerState      ShadowSampler0 : register(t5, space0);
+Texture2D<float4>  ShadowCascade1 : register(t6, space0);
+SamplerState      ShadowSampler1 : register(t6, space0);
+Texture2D<float4>  ShadowCascade2 : register(t7, space0);
+SamplerState      ShadowSampler2 : register(t7, space0);
+Texture2D<float4>  ShadowCascade3 : register(t8, space0);
+SamplerState      ShadowSampler3 : register(t8, space0);
+
 struct PSIn
 {
     float4 Position : SV_Position;
     float3 Normal : NORMAL0;
+    float3 WorldPosition : TEXCOORD0;
+    float4 ClipPosition : TEXCOORD1;
+    float4 BakedLight : TEXCOORD2;
 };
 
 struct PSOut
@@ -20,12 +73,98 @@ struct PSOut
     float4 Color       : SV_Target0;
 };
 
+uint GetClusterIndex(float4 ClipPosition)
+{
+    // Clip space w is the linear view depth
+    float2 Tile = (ClipPosition.xy / ClipPosition.w * 0.5 + 0.5) * float2(mClusters.Dims.xy);
+    float Slice = log(ClipPosition.w) * mClusters.SliceScale + mClusters.SliceBias;
+
+    uint3 Cluster = uint3(clamp(float3(Tile, Slice), float3(0.0, 0.0, 0.0), float3(mClusters.Dims.xyz) - 1.0));
+    return Cluster.x + (Cluster.y + Cluster.z * mClusters.Dims.y) * mClusters.Dims.x;
+}
+
+float3 ShadeLocalLights(float3 WorldPosition, float3 Normal, float4 ClipPosition)
+{
+    uint Cluster = GetClusterIndex(ClipPosition);
+    uint Range = mClusterRanges[Cluster / 4][Cluster % 4];
+    uint Offset = Range >> 16;
+    uint Count = Range & 0xFFFF;
+
+    float3 Result = float3(0.0, 0.0, 0.0);
+    for (uint Local = 0; Local < Count; Local++)
+    {
+        uint Slot = Offset + Local;
+        uint LightIndex = (mLightIndices[Slot / 8][(Slot / 2) % 4] >> ((Slot & 1) * 16)) & 0xFFFF;
+        LocalLight Light = mLights[LightIndex];
+
+        float3 ToLight = Light.PositionRadius.xyz - WorldPosition;
+        float Distance = length(ToLight);
+        float3 L = ToLight / max(Distance, 0.0001);
+
+        float Falloff = saturate(1.0 - Distance / Light.PositionRadius.w);
+        float Cone = smoothstep(Light.DirectionOuterCone.w, Light.ColorInnerCone.w, dot(-L, Light.DirectionOuterCone.xyz));
+
+        Result += Light.ColorInnerCone.rgb * saturate(dot(Normal, L)) * Falloff * Falloff * Cone;
+    }
+
+    return Result;
+}
+
+float SampleShadowCascade(uint Cascade, float2 UV)
+{
+    if (Cascade == 0)
+        return ShadowCascade0.Sample(ShadowSampler0, UV).r;
+    if (Cascade == 1)
+        return ShadowCascade1.Sample(ShadowSampler1, UV).r;
+    if (Cascade == 2)
+        return ShadowCascade2.Sample(ShadowSampler2, UV).r;
+    return ShadowCascade3.Sample(ShadowSampler3, UV).r;
+}
+
+float ComputeShadow(float3 WorldPosition, float ViewDepth)
+{
+    uint Cascade = 0;
+    while (Cascade < SHADOW_CASCADE_COUNT && ViewDepth > mCascadeSplits[Cascade])
+        Cascade++;
+
+    // Past the shadow distance
+    if (Cascade == SHADOW_CASCADE_COUNT)
+        return 1.0;
+
+    float4 LightClip = mCascadeViewProjection[Cascade] * float4(WorldPosition, 1.0);
+    float3 LightNdc = LightClip.xyz / LightClip.w;
+    float2 UV = LightNdc.xy * 0.5 + 0.5;
+
+    uint Width, Height;
+    ShadowCascade0.GetDimensions(Width, Height);
+    float2 TexelSize = 1.0 / float2(Width, Height);
+
+    // 3x3 PCF
+    float Lit = 0.0;
+    for (int Y = -1; Y <= 1; Y++)
+    {
+        for (int X = -1; X <= 1; X++)
+        {
+            float Occluder = SampleShadowCascade(Cascade, UV + float2(X, Y) * TexelSize);
+            Lit += (LightNdc.z - SHADOW_DEPTH_BIAS <= Occluder) ? 1.0 : 0.0;
+        }
+    }
+
+    return Lit / 9.0;
+}
+
 PSOut main(PSIn Input)
 {
     PSOut Output;
 
-    float NdotL = dot(Input.Normal, mDirLight.mDir);
-    Output.Color = float4(float3(1.0f, 1.0f, 1.0f) * NdotL, 1.0f);
+    float3 Normal = normalize(Input.Normal);
+    float NdotL = dot(Normal, mDirLight.mDir);
+    float Shadow = ComputeShadow(Input.WorldPosition, Input.ClipPosition.w);
+    float3 Local = ShadeLocalLights(Input.WorldPosition, Normal, Input.ClipPosition);
+
+    // Bounced light, sky and ambient occlusion are baked offline, the sun stays dynamic
+    float3 Ambient = Input.BakedLight.rgb * Input.BakedLight.a;
+    Output.Color = float4(float3(1.0f, 1.0f, 1.0f) * NdotL * Shadow + Local + Ambient, 1.0f);
 
     return Output;
 }
\ No newline at end of file
@@ -7,20 +7,28 @@ struct VSIn
 {
     float3 Position : SV_Position;
     float3 Normal : NORMAL0;
+    float4 BakedLight : TEXCOORD0;
 };
 
 struct VSOut
 {
     float4 Position : SV_Position;
     float3 Normal : NORMAL0;
-};vv
+    float3 WorldPosition : TEXCOORD0;
+    float4 ClipPosition : TEXCOORD1;
+    float4 BakedLight : TEXCOORD2;
+};
 
 VSOut main(VSIn Input)
 {
     VSOut Output;
 
-    Output.Position = ViewProjection * float4(Input.Position.x, Input.Position.z, Input.Position.y, 1.0);
-    Output.Normal = Input.Normal;
+    float3 WorldPosition = float3(Input.Position.x, Input.Position.z, Input.Position.y);
+    Output.Position = ViewProjection * float4(WorldPosition, 1.0);
+    Output.Normal = float3(Input.Normal.x, Input.Normal.z, Input.Normal.y);
+    Output.WorldPosition = WorldPosition;
+    Output.ClipPosition = Output.Position;
+    Output.BakedLight = Input.BakedLight;
 
     return Output;
 }
\ No newline at end of file
@@ -0,0 +1,9 @@
+struct PSIn
+{
+    float4 Position : SV_Position;
+};
+
+// Depth only, nothing to output
+void main(PSIn Input)
+{
+}
\ No newline at end of file
@@ -0,0 +1,24 @@
+cbuffer ShadowData : register(b0, space0)
+{
+    float4x4 LightViewProjection;
+}
+
+struct VSIn
+{
+    float3 Position : SV_Position;
+    float3 Normal : NORMAL0;
+};
+
+struct VSOut
+{
+    float4 Position : SV_Position;
+};
+
+VSOut main(VSIn Input)
+{
+    VSOut Output;
+
+    Output.Position = LightViewProjection * float4(Input.Position.x, Input.Position.z, Input.Position.y, 1.0);
+
+    return Output;
+}
\ No newline at end of file